@@ -1,7 +1,23 @@
+#include <algorithm>
+#include <cstdlib>
 #include "Application.h"
 
-
-Application::Application() {
+// a slow frame (loading, debugger) must not be caught up with hundreds of ticks
+static constexpr const double MAX_FRAME_TIME = 0.25;
+
+
+Application::Application():
+	mJobSystem(std::make_unique<JobSystem>()),
+	mFixedTimeStep(1.0 / 60.0),
+	mAccumulator(0.0),
+	mInterpolation(0.f),
+	mPipelined(false),
+	mSimulationPending(false),
+	mStopSimulation(false),
+	mPendingFrameTime(0.0),
+	mSimulationCamera(std::make_unique<SnapshotCamera>()),
+	mReplayCamera(std::make_unique<SnapshotCamera>())
+{
 	mCollisionConfiguration = std::make_unique<btDefaultCollisionConfiguration>();
 	mDispatcher = std::make_unique<btCollisionDispatcher>(mCollisionConfiguration.get());
 	const btVector3 worldMin(-1000,-1000,-1000);
@@ -10,13 +26,138 @@ Application::Application() {
 	mConstraintSolver = std::make_unique<btSequentialImpulseConstraintSolver>();
 
 	mDynamicsWorld = std::make_shared<btDiscreteDynamicsWorld>(mDispatcher.get(), mOverlappingPairCache.get(), mConstraintSolver.get(), mCollisionConfiguration.get());
+
+	PROFILE_THREAD("main");
+	// the textures created from now on are decoded by the workers
+	TextureLoader::get().setJobSystem(mJobSystem.get());
+
+	mCommandMap["simrate"] = [this](const std::string& p){
+		setSimulationRate(static_cast<unsigned int>(std::max(1, ::atoi(p.c_str()))));
+		Log::info("Simulation rate: %.0f Hz", 1.0 / mFixedTimeStep);
+	};
+	mCommandMap["pipeline"] = [this](const std::string& p){
+		setPipelined(p != "0");
+		Log::info("Pipelined simulation: %s", mPipelined? "on" : "off");
+	};
+	mCommandMap["profile"] = [this](const std::string& p){
+		try {
+			Profiler::get().writeChromeTrace(p.empty()? "profile.json" : p);
+		} catch (const std::runtime_error& e) {
+			Log::error("%s", e.what());
+		}
+	};
+	mCommandMap["gpuprof"] = [this](const std::string& p){
+		if (!p.empty()) {
+			GpuProfiler::get().setEnabled(p != "0");
+			Log::info("GPU profiler: %s", GpuProfiler::get().isEnabled()? "on" : "off");
+			return;
+		}
+		for (const auto& time : GpuProfiler::get().getTimes())
+			Log::info("gpu %s: %.3f ms", time.name, time.ms);
+	};
+	mCommandMap["record"] = [this](const std::string& p){
+		try {
+			mInputReplay.startRecording(p, mGameState.mode);
+			resetScene();
+			resetSimulationClock();
+		} catch (const std::runtime_error& e) {
+			Log::error("%s", e.what());
+		}
+	};
+	mCommandMap["stoprecord"] = [this](const std::string& p){
+		try {
+			mInputReplay.stopRecording();
+		} catch (const std::runtime_error& e) {
+			Log::error("%s", e.what());
+		}
+	};
+	mCommandMap["replay"] = [this](const std::string& p){
+		try {
+			startReplay(p);
+		} catch (const std::runtime_error& e) {
+			Log::error("%s", e.what());
+		}
+	};
+	mCommandMap["shadowcascades"] = [this](const std::string& p){
+		if (mShadowMap) {
+			try {
+				mShadowMap->setCascadeCount(static_cast<unsigned int>(std::max(0, ::atoi(p.c_str()))));
+				Log::info("Shadow cascades: %u", mShadowMap->getCascadeCount());
+			} catch (const std::runtime_error& e) {
+				Log::error("%s", e.what());
+			}
+		}
+	};
+	mCommandMap["shadowsplit"] = [this](const std::string& p){
+		if (mShadowMap) {
+			const float lambda = btClamped((float) ::atof(p.c_str()), 0.f, 1.f);
+			mShadowMap->setSplitLambda(lambda);
+			Log::info("Shadow split lambda: %.2f", lambda);
+		}
+	};
+	mCommandMap["shadowdistance"] = [this](const std::string& p){
+		if (mShadowMap) {
+			const float distance = std::max(1.f, (float) ::atof(p.c_str()));
+			mShadowMap->setShadowDistance(distance);
+			Log::info("Shadow distance: %.2f", distance);
+		}
+	};
+	mCommandMap["shadowsoft"] = [this](const std::string& p){
+		if (mShadowMap) {
+			mShadowMap->setSoftShadows(p != "0");
+			Log::info("Soft shadows: %s", mShadowMap->hasSoftShadows()? "on" : "off");
+		}
+	};
+	mCommandMap["texturebudget"] = [](const std::string& p){
+		if (!p.empty())
+			TextureLoader::get().setBudget(std::max(0.f, (float) ::atof(p.c_str())));
+		Log::info("Texture upload budget: %.2f ms per frame, %u textures pending", TextureLoader::get().getBudget(), static_cast<unsigned int>(TextureLoader::get().getPendingCount()));
+	};
+	mCommandMap["texturecache"] = [](const std::string& p){
+		TextureCache::get().report();
+	};
+	mCommandMap["glstate"] = [](const std::string& p){
+		GLState::get().setValidating(p != "0");
+		Log::info("GL state validation: %s", GLState::get().isValidating()? "on" : "off");
+	};
+	mCommandMap["renderstats"] = [this](const std::string& p){
+		if (!p.empty()) {
+			try {
+				RenderStats::get().writeCsv(p);
+			} catch (const std::runtime_error& e) {
+				Log::error("%s", e.what());
+			}
+			return;
+		}
+		for (const RenderStats::Entry& entry : RenderStats::get().getPassTotals()) {
+			const RenderStats::Counters& c = entry.counters;
+			Log::info("%s: %u draw calls, %u triangles, %u instances, %u uploads (%lu bytes), %u texture binds, %u shader switches, %u skipped states",
+				entry.pass, c.drawCalls, c.triangles, c.instances, c.bufferUploads, c.uploadedBytes, c.textureBinds, c.shaderSwitches, c.skippedStates);
+		}
+
+		static const char* passNames[] = { "shadow", "reflection", "main" };
+		for (int i = 0; i < 3; i++) {
+			const RenderQueueStats& stats = mRenderStats[i];
+			Log::info("%s: %u packets, %u draw calls, %u shader changes, %u material changes, %u skipped, %u legacy",
+				passNames[i], stats.packets, stats.drawCalls, stats.shaderChanges, stats.materialChanges, stats.skippedChanges, stats.legacyPackets);
+		}
+		if (mShadowMap)
+			Log::info("static shadow cascades rendered: %.1f/s", mShadowMap->getStaticRendersPerSecond());
+	};
 }
 
 
 Application::~Application() {
 	Log::debug("Deleting Application");
+	stopSimulationThread();
+	// jobs may still reference scene objects
+	TextureLoader::get().setJobSystem(nullptr);
+	mJobSystem.reset();
+
 	// Clear vectors / force garbage collection before physics world is deleted
 	mSerializables.clear();
+	mSceneObjectsById.clear();
+	mSceneObjectsBySerializeID.clear();
 	mSceneObjects.clear();
 	mMouseListeners.clear();
 	mKeyboardListeners.clear();
@@ -31,28 +172,28 @@ Application::~Application() {
 
 
 std::shared_ptr<ISerializable> Application::getSerializable(const std::string& serializeID) const {
-	for (auto& sceneObject : mSceneObjects) {
-		if (serializeID == sceneObject->serializeID())
-			return sceneObject;
-	}
-	return nullptr;
+	auto found = mSceneObjectsBySerializeID.find(serializeID);
+	return found != mSceneObjectsBySerializeID.end()? found->second : nullptr;
 }
 
 
 std::shared_ptr<ISceneObject> Application::getByObjectId(unsigned long objectId) const {
-	for (auto& sceneObject : mSceneObjects) {
-		if (objectId == sceneObject->getObjectId())
-			return sceneObject;
-	}
-	return nullptr;
+	auto found = mSceneObjectsById.find(objectId);
+	return found != mSceneObjectsById.end()? found->second : nullptr;
 }
 
 
 void Application::addSceneObject(std::shared_ptr<ISceneObject> sceneObject) {
 	addSerializable(sceneObject);
 
-	mSceneObjects.push_front(sceneObject);
+	mSceneObjects.push_back(sceneObject);
+	mSceneObjectsById[sceneObject->getObjectId()] = sceneObject;
+	// the newest object wins, like the scan over the list used to do
+	mSceneObjectsBySerializeID[sceneObject->serializeID()] = sceneObject;
 	addCommands(sceneObject->getCommands());
+
+	if (mShadowMap && sceneObject->hasStaticShadow())
+		mShadowMap->invalidateStatic();
 }
 
 
@@ -66,61 +207,153 @@ void Application::addCommands(ISceneObject::CommandMap commands) {
 }
 
 
-void Application::renderScenePass(const ISurfaceReflection* surfaceReflection)
+void Application::addRenderStats(RenderPass pass, const RenderQueueStats& stats)
+{
+	RenderQueueStats& total = mRenderStats[static_cast<int>(pass)];
+	total.packets += stats.packets;
+	total.drawCalls += stats.drawCalls;
+	total.shaderChanges += stats.shaderChanges;
+	total.materialChanges += stats.materialChanges;
+	total.skippedChanges += stats.skippedChanges;
+	total.legacyPackets += stats.legacyPackets;
+}
+
+
+bool Application::isShadowCaster(const ISceneObject* sceneObject) const
+{
+	if (!sceneObject->castsShadow() || sceneObject->hasStaticShadow() != mShadowMap->isRenderingStatic())
+		return false;
+
+	btVector3 center;
+	float radius;
+	return !sceneObject->getBoundingSphere(center, radius) || mShadowMap->isCaster(center, radius);
+}
+
+
+bool Application::isReflected(const ISceneObject* sceneObject) const
+{
+	btVector3 center;
+	float radius;
+	return !sceneObject->getBoundingSphere(center, radius) || mSurfaceReflection->isReflected(center, radius, getActiveCamera());
+}
+
+
+bool Application::hasVisibleReflection(const ICamera* pCamera) const
 {
 	for (auto& sceneObject : mSceneObjects) {
-		sceneObject->renderOpaque(getActiveCamera(), mSky.get(), mShadowMap.get(), surfaceReflection, mGameState);
+		if (sceneObject->hasVisibleReflection(pCamera))
+			return true;
 	}
+	return false;
 }
 
 
-void Application::renderTranslucentPass(const ISurfaceReflection* surfaceReflection)
+void Application::renderScenePass(RenderPass pass, const ISurfaceReflection* surfaceReflection)
+{
+	ICamera* pCamera = getActiveCamera();
+	mRenderQueue.begin(pass, false);
+	for (auto it = mSceneObjects.rbegin(); it != mSceneObjects.rend(); ++it) {
+		if (pass == RenderPass::SHADOW && !isShadowCaster(it->get()))
+			continue;
+		if (pass == RenderPass::REFLECTION && !isReflected(it->get()))
+			continue;
+
+		PROFILE_SCOPE((*it)->serializeID().c_str());
+		(*it)->submitOpaque(&mRenderQueue, pCamera, mSky.get(), mShadowMap.get(), surfaceReflection, mGameState);
+	}
+	addRenderStats(pass, mRenderQueue.execute());
+}
+
+
+void Application::renderTranslucentPass(RenderPass pass, const ISurfaceReflection* surfaceReflection)
 {
 	// Make depth buffer read only
-	glDepthMask(GL_FALSE);
+	GLState::get().depthMask(GL_FALSE);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_CULL_FACE);
-	for (auto& sceneObject : mSceneObjects) {
-		sceneObject->renderTranslucent(getActiveCamera(), mSky.get(), mShadowMap.get(), surfaceReflection, mGameState);
+	GLState::get().enable(GL_BLEND);
+	GLState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::get().disable(GL_CULL_FACE);
+	ICamera* pCamera = getActiveCamera();
+	mRenderQueue.begin(pass, true);
+	for (auto it = mSceneObjects.rbegin(); it != mSceneObjects.rend(); ++it) {
+		if (pass == RenderPass::REFLECTION && !isReflected(it->get()))
+			continue;
+
+		PROFILE_SCOPE((*it)->serializeID().c_str());
+		(*it)->submitTranslucent(&mRenderQueue, pCamera, mSky.get(), mShadowMap.get(), surfaceReflection, mGameState);
 	}
-	glEnable(GL_CULL_FACE);
-	glDisable(GL_BLEND);
+	addRenderStats(pass, mRenderQueue.execute());
+	GLState::get().enable(GL_CULL_FACE);
+	GLState::get().disable(GL_BLEND);
 
 	// Make depth buffer read write
-	glDepthMask(GL_TRUE);
+	GLState::get().depthMask(GL_TRUE);
+}
+
+
+void Application::updateUniformBlocks(const ICamera* pCamera) const
+{
+	pCamera->updateUniformBlock();
+	if (mSky)
+		mSky->updateUniformBlock(pCamera);
+	if (mSurfaceReflection)
+		mSurfaceReflection->updateUniformBlock(pCamera);
 }
 
 
 void Application::renderScene(ICamera* pCamera)
 {
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_MULTISAMPLE);
-	glEnable(GL_CULL_FACE);
+	for (auto& stats : mRenderStats)
+		stats = RenderQueueStats();
+
+	GLState::get().enable(GL_DEPTH_TEST);
+	GLState::get().enable(GL_MULTISAMPLE);
+	GLState::get().enable(GL_CULL_FACE);
+
+	// the shadow map updates the view block for each cascade
+	updateUniformBlocks(pCamera);
 
 	bool isShadowEnabled = mGameState.debugCode != DebugCode::NO_SHADOW;
 	if (isShadowEnabled && mShadowMap)
 	{
-		const btVector3& vCameraDir1 = pCamera->getDirectionUnit();
-		const btVector3& vOriginToSun1 = - mSky->getSunPosition().normalized();
-		const btVector3& target = pCamera->getPosition() + vCameraDir1 * 200.f;
-		const btVector3& lightPosition = target - vOriginToSun1 * 500.f;
-
-		mShadowMap->start(lightPosition, target, vCameraDir1);
-		renderScenePass(nullptr);
-//		renderTranslucentPass(nullptr);
+		PROFILE_PASS("shadow");
+		GPU_PROFILE_SCOPE("shadow");
+		RENDER_STATS_PASS("shadow");
+		const btVector3& lightDirection = - mSky->getSunPosition().normalized();
+
+		// static geometry may be edited at any time in the editor
+		if (mGameState.mode == GameMode::EDITING)
+			mShadowMap->invalidateStatic();
+
+		mShadowMap->start(pCamera, lightDirection);
+		for (unsigned int cascade = 0; cascade < mShadowMap->getCascadeCount(); cascade++) {
+			if (mShadowMap->startStaticCascade(cascade))
+				renderScenePass(RenderPass::SHADOW, nullptr);
+		}
+		mShadowMap->startDynamic();
+		for (unsigned int cascade = 0; cascade < mShadowMap->getCascadeCount(); cascade++) {
+			mShadowMap->setCascade(cascade);
+			renderScenePass(RenderPass::SHADOW, nullptr);
+//			renderTranslucentPass(RenderPass::SHADOW, nullptr);
+		}
 		mShadowMap->end();
 
 		// restore viewport because the shadowMap has changed it (see Framebuffer.startDepth())
 		pCamera->setViewport();
 	}
 
-	if (mSurfaceReflection) {
-		mSurfaceReflection->begin();
+	if (mSurfaceReflection && !hasVisibleReflection(pCamera)) {
+		mSurfaceReflection->invalidate();
+	}
+	else if (mSurfaceReflection && mSurfaceReflection->needsUpdate()) {
+		PROFILE_PASS("reflection");
+		GPU_PROFILE_SCOPE("reflection");
+		RENDER_STATS_PASS("reflection");
 		pCamera->update();
-		renderScenePass(mSurfaceReflection.get());
-		renderTranslucentPass(mSurfaceReflection.get());
+		mSurfaceReflection->begin(pCamera);
+		updateUniformBlocks(pCamera);
+		renderScenePass(RenderPass::REFLECTION, mSurfaceReflection.get());
+		renderTranslucentPass(RenderPass::REFLECTION, mSurfaceReflection.get());
 		mSurfaceReflection->end();
 
 		// restore viewport because the shadowMap has changed it (see Framebuffer.startColorAndDepth())
@@ -130,11 +363,22 @@ void Application::renderScene(ICamera* pCamera)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	pCamera->update();
+	updateUniformBlocks(pCamera);
 
 	static int lastX, lastY;
 
-	renderScenePass(mSurfaceReflection.get());
-	renderTranslucentPass(mSurfaceReflection.get());
+	{
+		PROFILE_PASS("opaque");
+		GPU_PROFILE_SCOPE("opaque");
+		RENDER_STATS_PASS("opaque");
+		renderScenePass(RenderPass::MAIN, mSurfaceReflection.get());
+	}
+	{
+		PROFILE_PASS("translucent");
+		GPU_PROFILE_SCOPE("translucent");
+		RENDER_STATS_PASS("translucent");
+		renderTranslucentPass(RenderPass::MAIN, mSurfaceReflection.get());
+	}
 
 	// Capture the mouse position 3D after rendering the scene
 	// (we can't get the 3d point before rendering for obvious reasons)
@@ -146,16 +390,43 @@ void Application::renderScene(ICamera* pCamera)
 	}
 
 	if (mRenderer2d) {
+		PROFILE_PASS("2d");
+		GPU_PROFILE_SCOPE("2d");
+		RENDER_STATS_PASS("2d");
 		mRenderer2d->begin();
 
 		const static SDL_Color BLACK = { 0, 0, 0 };
 		const static SDL_Color WHITE = { 1, 1, 1 };
-		for (auto& object : mSceneObjects)
-			object->render2d(mRenderer2d.get());
+		for (auto it = mSceneObjects.rbegin(); it != mSceneObjects.rend(); ++it) {
+			RENDER_STATS_OBJECT((*it)->serializeID().c_str());
+			(*it)->render2d(mRenderer2d.get());
+		}
+		RENDER_STATS_OBJECT("overlay");
 
 //		if (mGameState.isDebugging) {
 			static FPSCounter fps;
 			mRenderer2d->renderText(10, std::to_string(fps.getFps()) + " FPS", BLACK, "left=5", "bottom=0", 14);
+
+			// ms per frame of each pass, empty when the profiler is compiled out
+			const auto& passTimes = Profiler::get().getPassTimes();
+			const auto& gpuTimes = GpuProfiler::get().getTimes();
+			for (unsigned int i = 0; i < passTimes.size() + gpuTimes.size(); i++) {
+				const bool isGpu = i >= passTimes.size();
+				const Profiler::PassTime& time = isGpu? gpuTimes[i - passTimes.size()] : passTimes[i];
+				char text[64];
+				snprintf(text, sizeof(text), "%s%s %.2f ms", isGpu? "gpu " : "", time.name, time.ms);
+				mRenderer2d->renderText(200 + i, text, BLACK, "left=5", "bottom=" + std::to_string(16 * (i + 1)), 14);
+			}
+
+			// GL work of the last frame per pass, empty when the profiler is compiled out
+			const auto& passStats = RenderStats::get().getPassTotals();
+			for (unsigned int i = 0; i < passStats.size(); i++) {
+				const RenderStats::Counters& c = passStats[i].counters;
+				char text[128];
+				snprintf(text, sizeof(text), "%s %u draws %u tris %u binds %u shaders", passStats[i].pass,
+						 c.drawCalls, c.triangles, c.textureBinds, c.shaderSwitches);
+				mRenderer2d->renderText(300 + i, text, BLACK, "right=330", "bottom=" + std::to_string(16 * i), 14);
+			}
 //		}
 
 		if (mGameState.mode == GameMode::EDITING) {
@@ -185,22 +456,217 @@ void Application::renderScene(ICamera* pCamera)
 }
 
 
-void Application::moveAndDisplay() {
-	ICamera* pCamera = getActiveCamera();
+void Application::storeTickTransforms() {
+	btCollisionObjectArray& objects = mDynamicsWorld->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++) {
+		btRigidBody* body = btRigidBody::upcast(objects[i]);
+		if (!body || body->isStaticObject())
+			continue;
+
+		InterpolatedMotionState* motionState = dynamic_cast<InterpolatedMotionState*>(body->getMotionState());
+		if (motionState)
+			motionState->storeTick(body->getWorldTransform());
+	}
+}
 
+
+void Application::simulationTick(ICamera* pCamera) {
 	for (auto& listener : mKeyboardListeners)
 		listener->update(pCamera);
 
 	if (mGameState.mode == GameMode::RUNNING) {
-		static constexpr const int maxSimSubSteps = 2;
-		double dt = getDeltaTimeMicroseconds() * 0.000001;
-		mDynamicsWorld->stepSimulation(dt, maxSimSubSteps);
+		PROFILE_SCOPE("physics");
+		// exactly one internal step of mFixedTimeStep
+		mDynamicsWorld->stepSimulation(mFixedTimeStep, 1, mFixedTimeStep);
 	}
+	// also when paused, so both ticks converge and the interpolation settles
+	storeTickTransforms();
 
 	for (auto& sceneObject : mSceneObjects)
 		sceneObject->updateSimulation();
+}
+
+
+void Application::simulateFrame(double frameTime, ICamera* pCamera) {
+	PROFILE_PASS("simulation");
+	mAccumulator += frameTime < MAX_FRAME_TIME? frameTime : MAX_FRAME_TIME;
+
+	while (mAccumulator >= mFixedTimeStep) {
+		simulationTick(pCamera);
+		mAccumulator -= mFixedTimeStep;
+	}
+}
+
+
+void Application::resetSimulationClock() noexcept {
+	mAccumulator = 0.0;
+	mInterpolation = 0.f;
+}
+
+
+void Application::captureFrame() {
+	for (auto& sceneObject : mSceneObjects)
+		sceneObject->captureState();
+
+	// render between the last two ticks
+	mInterpolation = static_cast<float>(mAccumulator / mFixedTimeStep);
+}
+
+
+void Application::simulationLoop() {
+	PROFILE_THREAD("simulation");
+	std::unique_lock<std::mutex> lock(mPipelineMutex);
+	while (true) {
+		mPipelineCondition.wait(lock, [this](){ return mSimulationPending || mStopSimulation; });
+		if (mStopSimulation)
+			break;
+
+		lock.unlock();
+		simulateFrame(mPendingFrameTime, mSimulationCamera.get());
+		lock.lock();
+
+		mSimulationPending = false;
+		mPipelineCondition.notify_all();
+	}
+}
+
+
+void Application::startSimulation(double frameTime) {
+	if (!mSimulationThread.joinable()) {
+		Log::debug("Starting simulation thread");
+		mSimulationThread = std::thread(&Application::simulationLoop, this);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mPipelineMutex);
+		mPendingFrameTime = frameTime;
+		mSimulationPending = true;
+	}
+	mPipelineCondition.notify_all();
+}
+
+
+void Application::waitForSimulation() {
+	std::unique_lock<std::mutex> lock(mPipelineMutex);
+	mPipelineCondition.wait(lock, [this](){ return !mSimulationPending; });
+}
+
+
+void Application::stopSimulationThread() {
+	if (!mSimulationThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mPipelineMutex);
+		mStopSimulation = true;
+	}
+	mPipelineCondition.notify_all();
+	mSimulationThread.join();
+}
+
+
+void Application::flushPendingInput() {
+	// an input may start a replay, which clears the queue: run them from a copy
+	std::vector<std::function<void()>> inputs;
+	inputs.swap(mPendingInput);
+	for (auto& input : inputs) {
+		input();
+		// the live input after the replay command is dropped, as startReplay() does
+		if (mInputReplay.isReplaying())
+			break;
+	}
+}
+
+
+void Application::startReplay(const std::string& fileName) {
+	// same starting point as the recording
+	mInputReplay.startReplay(fileName);
+	resetScene();
+	resetSimulationClock();
+	setGameMode(mInputReplay.getStartMode());
+	mPendingInput.clear();
+}
+
+
+void Application::replayFrame() {
+	mInputReplay.replayEvents([this](const InputReplay::Event& e){
+		switch (e.type) {
+			case InputReplay::EventType::KEY_DOWN: processKeyDown(e.code, e.shift, e.ctrl, e.alt); break;
+			case InputReplay::EventType::KEY_UP: processKeyUp(e.code, e.shift, e.ctrl, e.alt); break;
+			case InputReplay::EventType::MOUSE_DOWN: processMouseDown(static_cast<Uint8>(e.code), e.x, e.y); break;
+			case InputReplay::EventType::MOUSE_UP: processMouseUp(static_cast<Uint8>(e.code), e.x, e.y); break;
+			case InputReplay::EventType::MOUSE_MOVE: processMouseMove(e.x, e.y); break;
+		}
+	});
+}
+
+
+void Application::stopReplay() {
+	// the replay holds the active camera on its path
+	setGameMode(mGameState.mode);
+}
+
+
+void Application::setGameMode(GameMode mode) {
+	mGameState.mode = mode;
+	bool isPaused = mode != GameMode::RUNNING;
+	mGameCamera->setPause(isPaused);
+	mFlyCamera->setPause(isPaused);
+}
+
+
+void Application::moveAndDisplay() {
+	PROFILE_SCOPE("frame");
+	double frameTime = getDeltaTimeMicroseconds() * 0.000001;
+	const bool isReplaying = mInputReplay.isReplaying();
+
+	// the simulation thread is idle from here until startSimulation()
+	waitForSimulation();
+	if (isReplaying) {
+		// deterministic: the recorded events with a fixed frame time
+		mPendingInput.clear();
+		replayFrame();
+		frameTime = mInputReplay.getFrameTime();
+	}
+	flushPendingInput();
+	mJobSystem->runMainThreadJobs();
+	TextureLoader::get().update();
+
+	ICamera* pCamera = getActiveCamera();
+
+	if (mPipelined && mGameState.mode == GameMode::RUNNING) {
+		// render the frame simulated in the background, and start the next one
+		captureFrame();
+		mSimulationCamera->copyFrom(pCamera);
+		startSimulation(frameTime);
+	} else {
+		simulateFrame(frameTime, pCamera);
+		captureFrame();
+	}
+
+	for (auto& sceneObject : mSceneObjects)
+		sceneObject->interpolate(mInterpolation);
+
+	InputReplay::CameraPose pose;
+	if (mInputReplay.getCameraPose(pose)) {
+		mReplayCamera->setPosition(pose.position);
+		mReplayCamera->setTargetPosition(pose.target);
+		mReplayCamera->setUp(pose.up);
+		pCamera->copyFrom(mReplayCamera.get());
+		// the controls must not move it away from the path
+		pCamera->setPause(true);
+	}
 
 	renderScene(pCamera);
+
+	mInputReplay.recordCamera(pCamera);
+	mInputReplay.endFrame(frameTime);
+	if (isReplaying && !mInputReplay.isReplaying())
+		stopReplay();
+
+	PROFILE_END_FRAME();
+	GPU_PROFILE_END_FRAME();
+	RENDER_STATS_END_FRAME();
 }
 
 
@@ -220,7 +686,7 @@ void Application::handleCommand(SDL_Keycode key) {
 			parameters = mCommand.substr(posSpace+1);
 			commandName.erase(posSpace);
 		}
-		auto command = std::find_if(mCommandMap.begin(), mCommandMap.end(), [&commandName] (const auto& e) { return e.first == commandName; });
+		auto command = mCommandMap.find(commandName);
 		if (command != mCommandMap.end()) {
 			command->second(parameters);
 		} else
@@ -248,14 +714,11 @@ void Application::toggleFreeFly() {
 }
 
 
-void Application::keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt)
+void Application::processKeyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt)
 {
 	if (key == SDLK_BACKSLASH) {
 		mCommand.clear();
-		mGameState.mode = mGameState.mode == GameMode::RUNNING? GameMode::EDITING : GameMode::RUNNING;
-		bool isPaused = mGameState.mode != GameMode::RUNNING;
-		mGameCamera->setPause(isPaused);
-		mFlyCamera->setPause(isPaused);
+		setGameMode(mGameState.mode == GameMode::RUNNING? GameMode::EDITING : GameMode::RUNNING);
 	} else if (mGameState.mode == GameMode::EDITING) {
 		handleCommand(key);
 	} else {
@@ -289,7 +752,7 @@ void Application::keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt)
 }
 
 
-void Application::keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt)
+void Application::processKeyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt)
 {
 	for (auto& listener : mKeyboardListeners) {
 		listener->keyUp(key, shift, ctrl, alt);
@@ -297,7 +760,7 @@ void Application::keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt)
 }
 
 
-void Application::mouseDown(Uint8 button, int x, int y)
+void Application::processMouseDown(Uint8 button, int x, int y)
 {
 	mGameState.isLeftMouseDown = button == static_cast<int>(IMouseListener::ButtonCode::LEFT_BUTTON);
 	mGameState.isRightMouseDown = button == static_cast<int>(IMouseListener::ButtonCode::RIGHT_BUTTON);
@@ -307,7 +770,7 @@ void Application::mouseDown(Uint8 button, int x, int y)
 }
 
 
-void Application::mouseUp(Uint8 button, int x, int y)
+void Application::processMouseUp(Uint8 button, int x, int y)
 {
 	mGameState.isLeftMouseDown = button == static_cast<int>(IMouseListener::ButtonCode::LEFT_BUTTON) ? false : mGameState.isLeftMouseDown;
 	mGameState.isRightMouseDown = button == static_cast<int>(IMouseListener::ButtonCode::RIGHT_BUTTON) ? false : mGameState.isRightMouseDown;
@@ -317,7 +780,7 @@ void Application::mouseUp(Uint8 button, int x, int y)
 }
 
 
-void Application::mouseMove(int x, int y)
+void Application::processMouseMove(int x, int y)
 {
 	mGameState.mouseX = x;
 	mGameState.mouseY = y;
@@ -353,6 +816,8 @@ void Application::resetScene()
 			if (body->getMotionState()) {
 				btDefaultMotionState* myMotionState = (btDefaultMotionState*)body->getMotionState();
 				myMotionState->m_graphicsWorldTrans = myMotionState->m_startWorldTrans;
+				if (InterpolatedMotionState* interpolated = dynamic_cast<InterpolatedMotionState*>(myMotionState))
+					interpolated->teleport(myMotionState->m_startWorldTrans);
 				body->setCenterOfMassTransform( myMotionState->m_graphicsWorldTrans );
 				colObj->setInterpolationWorldTransform(myMotionState->m_startWorldTrans);
 				colObj->forceActivationState(ACTIVE_TAG);
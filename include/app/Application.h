@@ -4,6 +4,10 @@
 #include <vector>
 #include <list>
 #include <forward_list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
 #include "BulletDynamics/Dynamics/btDynamicsWorld.h"
 #include "BulletCollision/CollisionShapes/btCollisionShape.h"
 #include "BulletCollision/CollisionShapes/btBoxShape.h"
@@ -17,8 +21,18 @@
 
 #include "Interfaces.h"
 #include "../scene/SceneObject.h"
+#include "../scene/RenderQueue.h"
+#include "../util/InterpolatedMotionState.h"
+#include "../camera/SnapshotCamera.h"
+#include "../util/JobSystem.h"
+#include "../util/TextureLoader.h"
+#include "../util/TextureCache.h"
+#include "InputReplay.h"
 #include "../extra/FPSCounter.h"
 #include "../util/Log.h"
+#include "../util/Profiler.h"
+#include "../util/GpuProfiler.h"
+#include "../util/RenderStats.h"
 
 
 class Application: public IGameScene
@@ -31,7 +45,10 @@ private:
 	std::shared_ptr<IRenderer2d> mRenderer2d;
 	std::shared_ptr<ISurfaceReflection> mSurfaceReflection;
 
-	std::forward_list<std::shared_ptr<ISceneObject>> mSceneObjects;
+	// in insertion order, rendered from the newest to the oldest
+	std::vector<std::shared_ptr<ISceneObject>> mSceneObjects;
+	std::unordered_map<unsigned long, std::shared_ptr<ISceneObject>> mSceneObjectsById;
+	std::unordered_map<std::string, std::shared_ptr<ISceneObject>> mSceneObjectsBySerializeID;
 	std::forward_list<std::shared_ptr<IMouseListener>> mMouseListeners;
 	std::forward_list<std::shared_ptr<IKeyboardListener>> mKeyboardListeners;
 	std::list<std::shared_ptr<ISerializable>> mSerializables;
@@ -44,16 +61,73 @@ private:
 
 	GameState mGameState;
 
+	std::unique_ptr<JobSystem> mJobSystem;
+
 	btClock mClock;
 	unsigned long getDeltaTimeMicroseconds();
 
+	// fixed-step simulation, the frame time is accumulated and consumed in ticks
+	double mFixedTimeStep;
+	double mAccumulator;
+	float mInterpolation;
+	void simulationTick(ICamera* pCamera);
+	void simulateFrame(double frameTime, ICamera* pCamera);
+	void storeTickTransforms();
+	void captureFrame();
+	/** drops the accumulated time, the next frame starts from a whole tick */
+	void resetSimulationClock() noexcept;
+
+	// pipelined mode: the simulation thread computes frame N+1 while frame N is rendered.
+	// Both threads only meet in moveAndDisplay, between waitForSimulation() and startSimulation():
+	// there the input is applied and the scene objects capture their state for the renderer.
+	// Editing and pause always run serially.
+	bool mPipelined;
+	bool mSimulationPending;
+	bool mStopSimulation;
+	double mPendingFrameTime;
+	std::thread mSimulationThread;
+	std::mutex mPipelineMutex;
+	std::condition_variable mPipelineCondition;
+	std::unique_ptr<SnapshotCamera> mSimulationCamera;
+	void simulationLoop();
+	void startSimulation(double frameTime);
+	void waitForSimulation();
+	void stopSimulationThread();
+
+	// input is queued and applied when the simulation is idle
+	std::vector<std::function<void()>> mPendingInput;
+	void flushPendingInput();
+	void processKeyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt);
+	void processKeyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt);
+	void processMouseDown(Uint8 button, int x, int y);
+	void processMouseUp(Uint8 button, int x, int y);
+	void processMouseMove(int x, int y);
+
+	// while replaying, the live input is ignored and the camera follows the recorded path
+	InputReplay mInputReplay;
+	std::unique_ptr<SnapshotCamera> mReplayCamera;
+	void replayFrame();
+	void stopReplay();
+	void setGameMode(GameMode mode);
+
 	std::string mCommand;
 	ISceneObject::CommandMap mCommandMap;
 	void handleCommand(SDL_Keycode key);
 
+	// the passes submit their draws to the queue, sorted by shader and material (opaque) or depth (translucent)
+	RenderQueue mRenderQueue;
+	RenderQueueStats mRenderStats[3]; // of the last frame, per RenderPass
+	void addRenderStats(RenderPass pass, const RenderQueueStats& stats);
+
+	bool isShadowCaster(const ISceneObject* sceneObject) const;
+	// the reflection is skipped without water in view and only updated every few frames
+	bool isReflected(const ISceneObject* sceneObject) const;
+	bool hasVisibleReflection(const ICamera* pCamera) const;
 	void renderScene(ICamera* pCamera);
-	void renderScenePass(const ISurfaceReflection* surfaceReflection);
-	void renderTranslucentPass(const ISurfaceReflection* surfaceReflection);
+	// uploads the camera, sky and reflection blocks shared by the programs of a pass
+	void updateUniformBlocks(const ICamera* pCamera) const;
+	void renderScenePass(RenderPass pass, const ISurfaceReflection* surfaceReflection);
+	void renderTranslucentPass(RenderPass pass, const ISurfaceReflection* surfaceReflection);
 	void resetScene();
 	void toggleFreeFly();
 
@@ -78,6 +152,10 @@ public:
 	virtual void addKeyboardListener(std::shared_ptr<IKeyboardListener>) noexcept override;
 	virtual void addCommands(ISceneObject::CommandMap commands) override;
 	virtual ICamera* getActiveCamera() const noexcept override;
+	virtual IJobSystem* getJobSystem() const noexcept override;
+	virtual void setSimulationRate(unsigned int ticksPerSecond) override;
+	virtual void setPipelined(bool pipelined) noexcept override;
+	virtual void startReplay(const std::string& fileName) override;
 
 	virtual void keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt) override;
 	virtual void keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt) override;
@@ -95,6 +173,49 @@ inline unsigned long Application::getDeltaTimeMicroseconds() {
 	return dt;
 }
 
+inline void Application::setSimulationRate(unsigned int ticksPerSecond)
+{
+	if (ticksPerSecond == 0)
+		throw std::runtime_error("Invalid simulation rate: 0");
+	mFixedTimeStep = 1.0 / ticksPerSecond;
+}
+
+inline IJobSystem* Application::getJobSystem() const noexcept
+{ return mJobSystem.get(); }
+
+inline void Application::setPipelined(bool pipelined) noexcept
+{ mPipelined = pipelined; }
+
+inline void Application::keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt)
+{
+	mInputReplay.record(InputReplay::EventType::KEY_DOWN, key, 0, 0, shift, ctrl, alt);
+	mPendingInput.push_back([=](){ processKeyDown(key, shift, ctrl, alt); });
+}
+
+inline void Application::keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt)
+{
+	mInputReplay.record(InputReplay::EventType::KEY_UP, key, 0, 0, shift, ctrl, alt);
+	mPendingInput.push_back([=](){ processKeyUp(key, shift, ctrl, alt); });
+}
+
+inline void Application::mouseDown(Uint8 button, int x, int y)
+{
+	mInputReplay.record(InputReplay::EventType::MOUSE_DOWN, button, x, y);
+	mPendingInput.push_back([=](){ processMouseDown(button, x, y); });
+}
+
+inline void Application::mouseUp(Uint8 button, int x, int y)
+{
+	mInputReplay.record(InputReplay::EventType::MOUSE_UP, button, x, y);
+	mPendingInput.push_back([=](){ processMouseUp(button, x, y); });
+}
+
+inline void Application::mouseMove(int x, int y)
+{
+	mInputReplay.record(InputReplay::EventType::MOUSE_MOVE, 0, x, y);
+	mPendingInput.push_back([=](){ processMouseMove(x, y); });
+}
+
 inline std::shared_ptr<btDynamicsWorld> Application::getDynamicsWorld() const noexcept
 { return mDynamicsWorld; }
 
@@ -132,6 +253,7 @@ inline void Application::enableSerialization(std::shared_ptr<ISerializer> serial
 {
 	mCommandMap["save"] = [serializer, this](const std::string& p){
 		Log::info("Saving...");
+		PROFILE_SCOPE("save");
 		ISerializer* pSerializer = serializer.get();
 		pSerializer->open(true);
 		for (auto& o : mSerializables) {
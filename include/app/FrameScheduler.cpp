@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <thread>
+#include "FrameScheduler.h"
+
+// the OS scheduler may oversleep by about a millisecond, the last part of the wait is a spin
+static constexpr const std::chrono::microseconds SPIN_MARGIN(1500);
+
+
+FrameScheduler::FrameScheduler(unsigned int targetFrameRate):
+	mTargetFrameTime(Clock::duration::zero()),
+	mFrameStart(Clock::now()),
+	mStatsStart(mFrameStart),
+	mStatsFrames(0),
+	mStatsTotalMs(0.f),
+	mStatsMinMs(0.f),
+	mStatsMaxMs(0.f),
+	mStatsSleptMs(0.f)
+{
+	setTargetFrameRate(targetFrameRate);
+}
+
+
+void FrameScheduler::setTargetFrameRate(unsigned int targetFrameRate) {
+	if (targetFrameRate == 0)
+		mTargetFrameTime = Clock::duration::zero();
+	else
+		mTargetFrameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate));
+
+	mDeadline = mFrameStart + mTargetFrameTime;
+	mStats.targetMs = std::chrono::duration<float, std::milli>(mTargetFrameTime).count();
+	Log::info("Target frame rate: %s", targetFrameRate == 0? "uncapped" : std::to_string(targetFrameRate).c_str());
+}
+
+
+void FrameScheduler::pace() {
+	const Clock::time_point workEnd = Clock::now();
+
+	if (!isUncapped() && workEnd < mDeadline) {
+		if (mDeadline - workEnd > SPIN_MARGIN)
+			std::this_thread::sleep_until(mDeadline - SPIN_MARGIN);
+
+		while (Clock::now() < mDeadline)
+			std::this_thread::yield();
+	}
+
+	const Clock::time_point frameEnd = Clock::now();
+	const float frameMs = std::chrono::duration<float, std::milli>(frameEnd - mFrameStart).count();
+	const float sleptMs = std::chrono::duration<float, std::milli>(frameEnd - workEnd).count();
+
+	mFrameStart = frameEnd;
+	mDeadline += mTargetFrameTime;
+	// a frame late by more than a whole period restarts the schedule instead of rushing the next ones
+	if (mDeadline < frameEnd)
+		mDeadline = frameEnd + mTargetFrameTime;
+
+	updateStats(frameMs, sleptMs);
+}
+
+
+void FrameScheduler::updateStats(float frameMs, float sleptMs) {
+	if (mStatsFrames == 0) {
+		mStatsMinMs = frameMs;
+		mStatsMaxMs = frameMs;
+	} else {
+		mStatsMinMs = std::min(mStatsMinMs, frameMs);
+		mStatsMaxMs = std::max(mStatsMaxMs, frameMs);
+	}
+	mStatsTotalMs += frameMs;
+	mStatsSleptMs += sleptMs;
+	mStatsFrames++;
+
+	mStats.lastMs = frameMs;
+
+	if (mFrameStart - mStatsStart >= std::chrono::seconds(1)) {
+		mStats.averageMs = mStatsTotalMs / mStatsFrames;
+		mStats.minMs = mStatsMinMs;
+		mStats.maxMs = mStatsMaxMs;
+		mStats.sleptMs = mStatsSleptMs / mStatsFrames;
+		mStats.fps = static_cast<unsigned int>(1000.f / mStats.averageMs + .5f);
+
+		mStatsStart = mFrameStart;
+		mStatsFrames = 0;
+		mStatsTotalMs = 0.f;
+		mStatsSleptMs = 0.f;
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef GAMEDEV3D_FRAME_SCHEDULER_H
+#define GAMEDEV3D_FRAME_SCHEDULER_H
+
+#include <chrono>
+#include "Interfaces.h"
+
+/**
+ * Paces the main loop to a target frame time (or lets it run uncapped) and
+ * measures the frame times. Only sleeps when the frame finished early.
+ */
+
+class FrameScheduler {
+	using Clock = std::chrono::steady_clock;
+
+	Clock::duration mTargetFrameTime;
+	Clock::time_point mFrameStart;
+	Clock::time_point mDeadline;
+
+	// stats of the current window, published in mStats once a second
+	Clock::time_point mStatsStart;
+	unsigned int mStatsFrames;
+	float mStatsTotalMs;
+	float mStatsMinMs;
+	float mStatsMaxMs;
+	float mStatsSleptMs;
+	FrameStats mStats;
+
+	void updateStats(float frameMs, float sleptMs);
+public:
+	explicit FrameScheduler(unsigned int targetFrameRate = 0);
+
+	/** 0 means uncapped */
+	void setTargetFrameRate(unsigned int targetFrameRate);
+	bool isUncapped() const noexcept;
+
+	/** waits until the deadline of the current frame and starts the next one */
+	void pace();
+
+	const FrameStats& getStats() const noexcept;
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool FrameScheduler::isUncapped() const noexcept
+{ return mTargetFrameTime == Clock::duration::zero(); }
+
+inline const FrameStats& FrameScheduler::getStats() const noexcept
+{ return mStats; }
+
+#endif
@@ -0,0 +1,136 @@
+#include "../util/GLHeaders.h"
+#include <algorithm>
+#include <chrono>
+#include <SDL2/SDL.h>
+#include "HeadlessWindow.h"
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+
+static EGLDisplay getSurfacelessDisplay() {
+	// Mesa runs without any display server on the surfaceless platform
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != nullptr) {
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display != EGL_NO_DISPLAY)
+			return display;
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+
+HeadlessWindow::HeadlessWindow(unsigned int width, unsigned int height, unsigned int frameCount):
+	mWidth(width),
+	mHeight(height),
+	mFrameCount(frameCount),
+	mDisplay(EGL_NO_DISPLAY),
+	mSurface(EGL_NO_SURFACE),
+	mContext(EGL_NO_CONTEXT)
+{
+	// the animations and the shaders use the SDL clock
+	if (SDL_Init(SDL_INIT_TIMER) != 0)
+		throw std::runtime_error("SDL Init Failed");
+
+	mDisplay = getSurfacelessDisplay();
+	if (mDisplay == EGL_NO_DISPLAY || !eglInitialize(mDisplay, nullptr, nullptr))
+		throw std::runtime_error("Failed to initialize EGL");
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount;
+	if (!eglChooseConfig(mDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+		throw std::runtime_error("No EGL config for an offscreen OpenGL surface");
+
+	const EGLint surfaceAttributes[] = {
+		EGL_WIDTH, static_cast<EGLint>(mWidth),
+		EGL_HEIGHT, static_cast<EGLint>(mHeight),
+		EGL_NONE
+	};
+	mSurface = eglCreatePbufferSurface(mDisplay, config, surfaceAttributes);
+	if (mSurface == EGL_NO_SURFACE)
+		throw std::runtime_error("Failed to create offscreen surface");
+
+	// the GL 3.2 entry points of the window, but a compatibility profile: the shaders are
+	// GLSL 1.20 (attribute, varying, gl_FragColor), a core context rejects them
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+	mContext = eglCreateContext(mDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+	if (mContext == EGL_NO_CONTEXT) {
+		// drivers without a 3.x compatibility profile give their highest legacy version
+		mContext = eglCreateContext(mDisplay, config, EGL_NO_CONTEXT, nullptr);
+	}
+	if (mContext == EGL_NO_CONTEXT)
+		throw std::runtime_error("Failed to create GL context");
+
+	if (!eglMakeCurrent(mDisplay, mSurface, mSurface, mContext))
+		throw std::runtime_error("Failed to make the GL context current");
+	glViewport(0, 0, mWidth, mHeight);
+
+	Log::info("Headless %d x %d (%s) init() finished", mWidth, mHeight, glGetString(GL_RENDERER));
+}
+
+
+HeadlessWindow::~HeadlessWindow() {
+	eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(mDisplay, mContext);
+	eglDestroySurface(mDisplay, mSurface);
+	eglTerminate(mDisplay);
+	SDL_Quit();
+}
+
+
+void HeadlessWindow::loop() {
+	Log::debug("Starting headless loop of %d frames", mFrameCount);
+	using Clock = std::chrono::steady_clock;
+
+	mFrameTimes.clear();
+	mFrameTimes.reserve(mFrameCount);
+	for (unsigned int frame = 0; frame < mFrameCount; frame++) {
+		const Clock::time_point start = Clock::now();
+
+		mGameScene->moveAndDisplay();
+		// nothing is presented, wait for the GPU so the frame time includes it
+		glFinish();
+		mFrameScheduler.pace();
+
+		mFrameTimes.push_back(std::chrono::duration<float, std::milli>(Clock::now() - start).count());
+	}
+
+	logResults();
+}
+
+
+void HeadlessWindow::logResults() const {
+	if (mFrameTimes.empty())
+		return;
+
+	std::vector<float> sorted(mFrameTimes);
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](float p) {
+		return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+	};
+
+	float totalMs = 0.f;
+	for (float ms : sorted)
+		totalMs += ms;
+
+	Log::info("frames=%lu total=%.1fms avg=%.3fms min=%.3fms p50=%.3fms p95=%.3fms p99=%.3fms max=%.3fms",
+			  sorted.size(), totalMs, totalMs / sorted.size(), sorted.front(),
+			  percentile(0.5f), percentile(0.95f), percentile(0.99f), sorted.back());
+}
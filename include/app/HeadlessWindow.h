@@ -0,0 +1,92 @@
+#ifndef GAMEDEV3D_HEADLESS_WINDOW_H
+#define GAMEDEV3D_HEADLESS_WINDOW_H
+
+#include <vector>
+#include <forward_list>
+#include <EGL/egl.h>
+#include "Interfaces.h"
+#include "FrameScheduler.h"
+
+/**
+ * Window without a display for the automated performance runs: the scene is rendered
+ * in an offscreen EGL pbuffer of a fixed resolution (a software rasterizer is fine).
+ * loop() renders a fixed number of frames as fast as possible and logs the frame times.
+ */
+
+class HeadlessWindow: public IWindow {
+private:
+	unsigned int mWidth;
+	unsigned int mHeight;
+	unsigned int mFrameCount;
+	EGLDisplay mDisplay;
+	EGLSurface mSurface;
+	EGLContext mContext;
+
+	std::shared_ptr<IGameScene> mGameScene;
+
+	FrameScheduler mFrameScheduler;
+	std::vector<float> mFrameTimes; // ms, of the last run
+
+	void logResults() const;
+public:
+	HeadlessWindow(unsigned int width, unsigned int height, unsigned int frameCount);
+	virtual ~HeadlessWindow();
+
+	virtual unsigned int getWidth() const noexcept override;
+	virtual unsigned int getHeight() const noexcept override;
+	virtual float getAspectRatio() const noexcept override;
+	virtual void resize(unsigned int width, unsigned int height) override;
+	virtual void centerMouseCursor() const override;
+	virtual void setFullScreen() override;
+	virtual void setGameScene(std::shared_ptr<IGameScene>) override;
+	virtual std::shared_ptr<IGameScene> getGameScene() const override;
+	virtual void addResizeListener(std::function<void(int, int)>) override;
+	virtual void setTargetFrameRate(unsigned int fps) override;
+	virtual const FrameStats& getFrameStats() const noexcept override;
+
+	const std::vector<float>& getFrameTimes() const noexcept;
+
+	virtual void loop() override;
+};
+
+//-----------------------------------------------------------------------------
+
+inline unsigned int HeadlessWindow::getWidth() const noexcept
+{ return mWidth; }
+
+inline unsigned int HeadlessWindow::getHeight() const noexcept
+{ return mHeight; }
+
+inline float HeadlessWindow::getAspectRatio() const noexcept
+{ return mWidth / (float) mHeight; }
+
+// the framebuffer has a fixed resolution
+inline void HeadlessWindow::resize(unsigned int width, unsigned int height)
+{ Log::info("Headless window can't be resized"); }
+
+inline void HeadlessWindow::centerMouseCursor() const
+{}
+
+inline void HeadlessWindow::setFullScreen()
+{ Log::info("Headless window can't be fullscreen"); }
+
+inline void HeadlessWindow::setGameScene(std::shared_ptr<IGameScene> gameScene)
+{ mGameScene = gameScene; }
+
+inline std::shared_ptr<IGameScene> HeadlessWindow::getGameScene() const
+{ return mGameScene; }
+
+// never resized, the listeners are not needed
+inline void HeadlessWindow::addResizeListener(std::function<void(int, int)> listener)
+{}
+
+inline void HeadlessWindow::setTargetFrameRate(unsigned int fps)
+{ mFrameScheduler.setTargetFrameRate(fps); }
+
+inline const FrameStats& HeadlessWindow::getFrameStats() const noexcept
+{ return mFrameScheduler.getStats(); }
+
+inline const std::vector<float>& HeadlessWindow::getFrameTimes() const noexcept
+{ return mFrameTimes; }
+
+#endif
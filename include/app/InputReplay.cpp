@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <fstream>
+#include "InputReplay.h"
+
+static constexpr const char* FILE_HEADER = "gamedev3d-replay";
+static constexpr const int FILE_VERSION = 2;
+
+
+InputReplay::InputReplay():
+	mMode(Mode::NONE),
+	mFrame(0),
+	mNextEvent(0),
+	mFrameTime(1.0 / 60.0),
+	mStartMode(GameMode::RUNNING),
+	mRecordedTime(0.0)
+{}
+
+
+void InputReplay::startRecording(const std::string& fileName, GameMode startMode) {
+	// a path that can't be written fails now, not at the end of the session
+	if (!std::ofstream(fileName))
+		throw std::runtime_error("Can't write replay: " + fileName);
+	mMode = Mode::RECORDING;
+	mFileName = fileName;
+	mStartMode = startMode;
+	mFrame = 0;
+	mRecordedTime = 0.0;
+	mEvents.clear();
+	mCameraPath.clear();
+	Log::info("Recording input to %s", fileName.c_str());
+}
+
+
+void InputReplay::stopRecording() {
+	if (mMode != Mode::RECORDING)
+		return;
+
+	mMode = Mode::NONE;
+	// the replay runs at the average frame time of the session
+	if (mFrame > 0)
+		mFrameTime = mRecordedTime / mFrame;
+	save();
+	Log::info("Recorded %u frames, %lu events to %s", mFrame, mEvents.size(), mFileName.c_str());
+}
+
+
+void InputReplay::startReplay(const std::string& fileName) {
+	mFileName = fileName;
+	load();
+	mMode = Mode::REPLAYING;
+	mFrame = 0;
+	mNextEvent = 0;
+	mFrameTimes.clear();
+	mFrameTimes.reserve(mCameraPath.size());
+	mFrameStart = Clock::now();
+	Log::info("Replaying %lu frames of %.2fms from %s", mCameraPath.size(), mFrameTime * 1000.0, fileName.c_str());
+}
+
+
+void InputReplay::recordCamera(const ICamera* camera) {
+	if (mMode != Mode::RECORDING)
+		return;
+
+	const btVector3& position = camera->getPosition();
+	mCameraPath.push_back({ position, position + camera->getDirection(), camera->getUp() });
+}
+
+
+void InputReplay::endFrame(double frameTime) {
+	if (mMode == Mode::RECORDING) {
+		mRecordedTime += frameTime;
+		mFrame++;
+	} else if (mMode == Mode::REPLAYING) {
+		const Clock::time_point now = Clock::now();
+		mFrameTimes.push_back(std::chrono::duration<float, std::milli>(now - mFrameStart).count());
+		mFrameStart = now;
+
+		if (++mFrame >= mCameraPath.size()) {
+			mMode = Mode::NONE;
+			writeFrameTimes();
+		}
+	}
+}
+
+
+void InputReplay::save() const {
+	std::ofstream file(mFileName);
+	if (!file)
+		throw std::runtime_error("Can't write replay: " + mFileName);
+	file.precision(9);
+
+	file << FILE_HEADER << " " << FILE_VERSION << " " << mFrameTime << " " << static_cast<int>(mStartMode) << " " << mCameraPath.size() << " " << mEvents.size() << "\n";
+	for (const CameraPose& pose : mCameraPath) {
+		file << pose.position.x() << " " << pose.position.y() << " " << pose.position.z() << " "
+			 << pose.target.x() << " " << pose.target.y() << " " << pose.target.z() << " "
+			 << pose.up.x() << " " << pose.up.y() << " " << pose.up.z() << "\n";
+	}
+	for (const Event& e : mEvents) {
+		file << e.frame << " " << static_cast<int>(e.type) << " " << e.code << " " << e.x << " " << e.y << " "
+			 << e.shift << " " << e.ctrl << " " << e.alt << "\n";
+	}
+}
+
+
+void InputReplay::load() {
+	std::ifstream file(mFileName);
+	if (!file)
+		throw std::runtime_error("Can't read replay: " + mFileName);
+
+	std::string header;
+	int version;
+	double frameTime;
+	int startMode;
+	size_t frameCount, eventCount;
+	file >> header >> version >> frameTime >> startMode >> frameCount >> eventCount;
+	if (header != FILE_HEADER || version != FILE_VERSION || frameTime <= 0.0
+		|| startMode < static_cast<int>(GameMode::RUNNING) || startMode > static_cast<int>(GameMode::EDITING))
+		throw std::runtime_error("Invalid replay: " + mFileName);
+	mFrameTime = frameTime;
+	mStartMode = static_cast<GameMode>(startMode);
+
+	mCameraPath.resize(frameCount);
+	for (CameraPose& pose : mCameraPath) {
+		float px, py, pz, tx, ty, tz, ux, uy, uz;
+		file >> px >> py >> pz >> tx >> ty >> tz >> ux >> uy >> uz;
+		pose = { btVector3(px, py, pz), btVector3(tx, ty, tz), btVector3(ux, uy, uz) };
+	}
+
+	mEvents.resize(eventCount);
+	for (Event& e : mEvents) {
+		int type;
+		file >> e.frame >> type >> e.code >> e.x >> e.y >> e.shift >> e.ctrl >> e.alt;
+		e.type = static_cast<EventType>(type);
+	}
+
+	if (!file)
+		throw std::runtime_error("Truncated replay: " + mFileName);
+}
+
+
+void InputReplay::writeFrameTimes() const {
+	const std::string& fileName = mFileName + ".frames.csv";
+	std::ofstream file(fileName);
+	file << "frame,ms\n";
+	for (size_t i = 0; i < mFrameTimes.size(); i++)
+		file << i << "," << mFrameTimes[i] << "\n";
+
+	std::vector<float> sorted(mFrameTimes);
+	std::sort(sorted.begin(), sorted.end());
+	float totalMs = 0.f;
+	for (float ms : sorted)
+		totalMs += ms;
+
+	if (!sorted.empty())
+		Log::info("Replay finished: %lu frames, avg=%.3fms p50=%.3fms p95=%.3fms max=%.3fms, written to %s",
+				  sorted.size(), totalMs / sorted.size(), sorted[sorted.size() / 2],
+				  sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)], sorted.back(), fileName.c_str());
+}
@@ -0,0 +1,126 @@
+#ifndef GAMEDEV3D_INPUT_REPLAY_H
+#define GAMEDEV3D_INPUT_REPLAY_H
+
+#include <chrono>
+#include <vector>
+#include "Interfaces.h"
+
+/**
+ * Records the input events and the camera path of a session, frame by frame, and plays
+ * them back with a fixed frame time so two builds can be compared on the same workload.
+ * The game mode at the start of the recording is saved, the replay starts in the same one.
+ * The replay writes the measured frame times to <file>.frames.csv when it ends.
+ */
+
+class InputReplay {
+public:
+	enum class EventType {
+		KEY_DOWN,
+		KEY_UP,
+		MOUSE_DOWN,
+		MOUSE_UP,
+		MOUSE_MOVE
+	};
+
+	typedef struct {
+		unsigned int frame;
+		EventType type;
+		int code; // key or button
+		int x;
+		int y;
+		bool shift;
+		bool ctrl;
+		bool alt;
+	} Event;
+
+	typedef struct {
+		btVector3 position;
+		btVector3 target;
+		btVector3 up;
+	} CameraPose;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Mode {
+		NONE,
+		RECORDING,
+		REPLAYING
+	};
+
+	Mode mMode;
+	std::string mFileName;
+	unsigned int mFrame;
+	size_t mNextEvent;
+	double mFrameTime; // seconds, simulated per replayed frame
+	GameMode mStartMode;
+
+	std::vector<Event> mEvents;
+	std::vector<CameraPose> mCameraPath; // one per frame
+
+	Clock::time_point mFrameStart;
+	double mRecordedTime;
+	std::vector<float> mFrameTimes; // ms, measured while replaying
+
+	void save() const;
+	void load();
+	void writeFrameTimes() const;
+
+public:
+	InputReplay();
+
+	/** throw std::runtime_error if the file can't be written or read */
+	void startRecording(const std::string& fileName, GameMode startMode);
+	void stopRecording();
+	void startReplay(const std::string& fileName);
+
+	bool isRecording() const noexcept;
+	bool isReplaying() const noexcept;
+	double getFrameTime() const noexcept;
+	GameMode getStartMode() const noexcept;
+
+	void record(EventType type, int code, int x, int y, bool shift = false, bool ctrl = false, bool alt = false);
+	void recordCamera(const ICamera* camera);
+
+	/** events of the current frame, in the recorded order */
+	template<typename F> void replayEvents(F apply);
+	bool getCameraPose(CameraPose& pose) const;
+
+	/** the replay stops after its last frame */
+	void endFrame(double frameTime);
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool InputReplay::isRecording() const noexcept
+{ return mMode == Mode::RECORDING; }
+
+inline bool InputReplay::isReplaying() const noexcept
+{ return mMode == Mode::REPLAYING; }
+
+inline double InputReplay::getFrameTime() const noexcept
+{ return mFrameTime; }
+
+inline GameMode InputReplay::getStartMode() const noexcept
+{ return mStartMode; }
+
+inline void InputReplay::record(EventType type, int code, int x, int y, bool shift, bool ctrl, bool alt) {
+	if (mMode == Mode::RECORDING)
+		mEvents.push_back({ mFrame, type, code, x, y, shift, ctrl, alt });
+}
+
+template<typename F>
+inline void InputReplay::replayEvents(F apply) {
+	while (mNextEvent < mEvents.size() && mEvents[mNextEvent].frame == mFrame)
+		apply(mEvents[mNextEvent++]);
+}
+
+inline bool InputReplay::getCameraPose(CameraPose& pose) const {
+	if (mMode != Mode::REPLAYING || mFrame >= mCameraPath.size())
+		return false;
+
+	pose = mCameraPath[mFrame];
+	return true;
+}
+
+#endif
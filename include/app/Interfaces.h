@@ -2,21 +2,26 @@
 #define GAMEDEV3D_ISERIALIZATION_H
 
 #include <functional>
+#include <limits>
 #include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 #include "../util/Log.h"
 #include "../util/math/Matrix4x4.h"
+#include "../util/UniformBlock.h"
+#include "../util/GLState.h"
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_keycode.h>
 #include <unordered_map>
 #include <SDL2/SDL_pixels.h>
-#include <OpenGL/gl3.h>
+#include "../util/GLHeaders.h"
 #include <SDL2/SDL_surface.h>
 
 
 class Factory;
+class ICamera;
 class IWindow;
+struct JobState;
 
 
 enum class GameMode {
@@ -44,6 +49,17 @@ typedef struct {
 	DebugCode debugCode = DebugCode::NONE;
 } GameState;
 
+typedef struct {
+	float targetMs = 0.f; // 0 when uncapped
+	float lastMs = 0.f;
+	// averaged over the last second
+	float averageMs = 0.f;
+	float minMs = 0.f;
+	float maxMs = 0.f;
+	float sleptMs = 0.f;
+	unsigned int fps = 0;
+} FrameStats;
+
 //-----------------------------------------------------------------------------
 
 class ISerializer {
@@ -141,13 +157,71 @@ public:
 	virtual void setFromSurface(const SDL_Surface* img) = 0;
 
 	static void unbind() {
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glActiveTexture(GL_TEXTURE0);
+		GLState::get().unbindTexture();
 	}
 };
 
 //-----------------------------------------------------------------------------
 
+/**
+ * Location of a uniform resolved once with IShader::getUniform(), for the values set per
+ * object: the setters skip the lookup by name. The program must be running.
+ */
+class Uniform {
+	GLint mLocation;
+public:
+	explicit Uniform(GLint location = -1): mLocation(location) {}
+
+	bool isValid() const noexcept { return mLocation >= 0; }
+
+	void set(const ITexture* texture) const;
+	void set(const btVector3& vector) const;
+	void set(float value) const;
+	void set(int value) const;
+	void set(float v1, float v2) const;
+	void set(const Matrix4x4& matrix) const;
+	void set4f(const float* value) const;
+};
+
+inline void Uniform::set(const ITexture* texture) const {
+	if (mLocation >= 0) {
+		texture->bind();
+		glUniform1i(mLocation, texture->getSlot());
+	}
+}
+
+inline void Uniform::set(const btVector3& vector) const {
+	if (mLocation >= 0)
+		glUniform3f(mLocation, vector.x(), vector.y(), vector.z());
+}
+
+inline void Uniform::set(float value) const {
+	if (mLocation >= 0)
+		glUniform1f(mLocation, value);
+}
+
+inline void Uniform::set(int value) const {
+	if (mLocation >= 0)
+		glUniform1i(mLocation, value);
+}
+
+inline void Uniform::set(float v1, float v2) const {
+	if (mLocation >= 0)
+		glUniform2f(mLocation, v1, v2);
+}
+
+inline void Uniform::set(const Matrix4x4& matrix) const {
+	if (mLocation >= 0)
+		glUniformMatrix4fv(mLocation, 1 /*only setting 1 matrix*/, false /*transpose?*/, matrix.raw());
+}
+
+inline void Uniform::set4f(const float* value) const {
+	if (mLocation >= 0)
+		glUniform4f(mLocation, value[0], value[1], value[2], value[3]);
+}
+
+//-----------------------------------------------------------------------------
+
 class IShader {
 public:
 	virtual ~IShader(){};
@@ -155,6 +229,10 @@ public:
 	virtual void run() const = 0;
 	virtual void link() const = 0;
 	virtual void bindAttribute(GLuint index, const GLchar *name) const = 0;
+	/** resolves the location once, see Uniform. After link() */
+	virtual Uniform getUniform(const std::string& param) = 0;
+	/** false if the program declares plain uniforms instead of the block, see UniformBlock */
+	virtual bool hasUniformBlock(UniformBlock::Binding binding) const noexcept = 0;
 	virtual void set(const std::string& param, const ITexture* texture) = 0;
 	virtual void set(const std::string& param, const btVector3& vector) = 0;
 	virtual void set(const std::string& param, float value) = 0;
@@ -162,7 +240,8 @@ public:
 	virtual void set(const std::string& param, float v1, float v2) = 0;
 	virtual void set(const std::string& param, const Matrix4x4& matrix) = 0;
 	virtual void set4f(const std::string& param, float* value) = 0;
-	static void stop() { glUseProgram(0); }
+	/** the program stays bound for the next object, see GLState::releaseProgram() */
+	static void stop() { GLState::get().releaseProgram(); }
 };
 
 //-----------------------------------------------------------------------------
@@ -188,11 +267,36 @@ class IShadowMap: public ISerializable {
 public:
 	virtual ~IShadowMap(){}
 
-	virtual void start(const btVector3& lightPosition, const btVector3& targetPosition, const btVector3& up) = 0;
+	/**
+	 * Fits the cascades to the camera. The static casters are then rendered in the cascades
+	 * for which startStaticCascade() returns true, and after startDynamic() the dynamic
+	 * casters are rendered in every cascade selected with setCascade().
+	 */
+	virtual void start(const ICamera* camera, const btVector3& lightDirection) = 0;
+	virtual bool startStaticCascade(unsigned int cascade) = 0;
+	virtual void startDynamic() = 0;
+	virtual void setCascade(unsigned int cascade) = 0;
 	virtual void end() = 0;
 	virtual bool isRendering() const = 0;
+	virtual bool isRenderingStatic() const = 0;
+	/** the static casters have changed */
+	virtual void invalidateStatic() noexcept = 0;
+	virtual float getStaticRendersPerSecond() const noexcept = 0;
+	virtual unsigned int getCascadeCount() const noexcept = 0;
+	virtual void setCascadeCount(unsigned int cascadeCount) = 0;
+	virtual void setSplitLambda(float lambda) noexcept = 0;
+	virtual void setShadowDistance(float distance) noexcept = 0;
+	/** 3x3 filter (getShadow9) or a single lookup (getShadow1), for the shaders with variants */
+	virtual void setSoftShadows(bool soft) noexcept = 0;
+	virtual bool hasSoftShadows() const noexcept = 0;
+	/**
+	 * V and P of the cascade being rendered and the cascades to sample. With the uniform
+	 * blocks they are uploaded by startStaticCascade()/setCascade() and start().
+	 */
 	virtual void setMatrices(IShader* shader) const = 0;
 	virtual void setVars(IShader* shader) const = 0;
+	/** true if a sphere can cast a shadow into the map being rendered, i.e. it intersects the light's box */
+	virtual bool isCaster(const btVector3& center, float radius) const = 0;
 };
 
 //-----------------------------------------------------------------------------
@@ -207,6 +311,12 @@ public:
 	virtual btVector3 getRight() const noexcept = 0;
 	virtual btVector3 getDirection() const noexcept = 0;
 	virtual btVector3 getDirectionUnit() const noexcept = 0;
+	virtual float getFovY() const noexcept = 0;
+	virtual float getZnear() const noexcept = 0;
+	virtual float getZfar() const noexcept = 0;
+	virtual float getAspectRatio() const noexcept = 0;
+	virtual const Matrix4x4& getViewMatrix() const noexcept = 0;
+	virtual const Matrix4x4& getProjectionMatrix() const noexcept = 0;
 	virtual btVector3 getRayTo(int x, int y) const noexcept = 0;
 	virtual void setViewport() const = 0;
 	virtual bool isVisible(const btVector3& point) const noexcept = 0;
@@ -217,6 +327,8 @@ public:
 	virtual void setPause(bool) noexcept = 0;
 	virtual bool isInFront(const btVector3& point) const noexcept = 0;
 	virtual void setMatrices(IShader* shader) const = 0;
+	/** V and P of the pass, in UniformBlock::VIEW */
+	virtual void updateUniformBlock() const = 0;
 	virtual void copyFrom(const ICamera*) noexcept = 0;
 };
 
@@ -239,6 +351,8 @@ public:
 	virtual void setSunPosition(btVector3 sunPos) noexcept = 0;
 
 	virtual void setVars(IShader* shader, const ICamera* camera) const = 0;
+	/** once per pass, UniformBlock::SKY */
+	virtual void updateUniformBlock(const ICamera* camera) const = 0;
 
 	virtual void debug() const = 0;
 };
@@ -252,15 +366,50 @@ public:
 	virtual const ITexture* getColorTexture() const = 0;
 	virtual bool isRendering() const = 0;
 
-	virtual void begin() = 0;
+	/** called once per frame with water in view, false if the last reflection can be reused */
+	virtual bool needsUpdate() noexcept = 0;
+	/** there is no water in view, the next update can't reuse anything */
+	virtual void invalidate() noexcept = 0;
+	virtual void begin(const ICamera* camera) = 0;
 	virtual void end() = 0;
 
+	/** reflection cull list: small and far objects are skipped */
+	virtual float getMaxDistance() const noexcept = 0;
+	virtual bool isReflected(const btVector3& center, float radius, const ICamera* camera) const noexcept = 0;
+
 	virtual void setVars(IShader* shader, const ICamera* camera) const = 0;
+	/** once per pass, UniformBlock::REFLECTION */
+	virtual void updateUniformBlock(const ICamera* camera) const = 0;
 	virtual void setReflectionTexture(IShader* shader) const = 0;
 };
 
 //-----------------------------------------------------------------------------
 
+/**
+ * A draw submitted to the render queue. Consecutive packets with the same shader share one
+ * setup() call (camera, sky, shadows) and the same material one bindMaterial() call.
+ * A packet without shader draws by itself and the queue forgets the current state.
+ */
+struct RenderPacket {
+	IShader* shader = nullptr;
+	const void* material = nullptr;
+	float depth = 0.f; // distance to the camera
+	unsigned int drawCalls = 1;
+	std::function<void(IShader*)> setup;
+	std::function<void(IShader*)> bindMaterial;
+	std::function<void(IShader*)> draw;
+	const char* name = nullptr; // shown by the profiler
+};
+
+class IRenderQueue {
+public:
+	virtual ~IRenderQueue() {}
+
+	virtual void submit(RenderPacket&& packet) = 0;
+};
+
+//-----------------------------------------------------------------------------
+
 class ISceneObject: public ISerializable {
 public:
 	virtual ~ISceneObject(){}
@@ -274,8 +423,50 @@ public:
 	virtual void initPhysics(btTransform transform) {};
 	virtual void renderOpaque(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) = 0;
 	virtual void renderTranslucent(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {};
+
+	/** submits the draws of the object, by default a single packet calling renderOpaque() */
+	virtual void submitOpaque(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
+		RenderPacket packet;
+		packet.name = serializeID().c_str();
+		packet.draw = [=, &gameState](IShader*){ renderOpaque(camera, sky, shadowMap, surfaceReflection, gameState); };
+		queue->submit(std::move(packet));
+	}
+	/** submits the draws of the object, by default a single packet calling renderTranslucent() */
+	virtual void submitTranslucent(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
+		RenderPacket packet;
+		packet.name = serializeID().c_str();
+		packet.depth = getViewDepth(camera);
+		packet.draw = [=, &gameState](IShader*){ renderTranslucent(camera, sky, shadowMap, surfaceReflection, gameState); };
+		queue->submit(std::move(packet));
+	}
+
 	virtual void render2d(IRenderer2d* renderer2d) {};
+
+	/** objects that are never drawn in the shadow map are skipped in that pass */
+	virtual bool castsShadow() const { return true; }
+	/** static casters are cached by the shadow map, see IShadowMap::invalidateStatic() */
+	virtual bool hasStaticShadow() const { return false; }
+	/** true if a reflective surface (water) is in view of the camera */
+	virtual bool hasVisibleReflection(const ICamera* camera) { return false; }
+	/** world bounding sphere used to cull the shadow casters, false if the object has none */
+	virtual bool getBoundingSphere(btVector3& center, float& radius) const { return false; }
+	/** distance from the camera to the bounding sphere center, the farthest without a sphere (sky-wide objects) */
+	float getViewDepth(const ICamera* camera) const {
+		btVector3 center;
+		float radius;
+		if (!getBoundingSphere(center, radius))
+			return std::numeric_limits<float>::max();
+		return center.distance(camera->getPosition());
+	}
+	/**
+	 * Threading: updateSimulation() runs on the simulation thread and owns the physics state.
+	 * captureState() copies what the renderer needs while the simulation is idle, render*() and
+	 * interpolate() must only read that copy.
+	 */
 	virtual void updateSimulation() {}
+	virtual void captureState() {}
+	/** blends the last two simulation ticks before rendering, alpha goes from 0 (previous) to 1 (current) */
+	virtual void interpolate(float alpha) {}
 	virtual void reset() {};
 
 	// If a camera is focusing on this object, respect these numbers
@@ -284,6 +475,8 @@ public:
 	virtual float getMaxCameraDistance() const noexcept = 0;
 
 	virtual Matrix4x4 getMatrix4x4() const = 0;
+	/** the transform of the last simulation tick, for game logic running on the simulation thread */
+	virtual Matrix4x4 getSimulationMatrix4x4() const { return getMatrix4x4(); }
 };
 
 //-----------------------------------------------------------------------------
@@ -322,6 +515,32 @@ public:
 
 //-----------------------------------------------------------------------------
 
+using JobHandle = std::shared_ptr<JobState>;
+
+class IJobSystem {
+public:
+	using Job = std::function<void()>;
+	using RangeJob = std::function<void(unsigned int begin, unsigned int end)>;
+
+	virtual ~IJobSystem() {}
+
+	/** the job runs on a worker once all its dependencies are done (continuations) */
+	virtual JobHandle submit(Job job, const std::vector<JobHandle>& dependencies = {}) = 0;
+	/** runs other jobs while waiting, safe to call from a job */
+	virtual void wait(const JobHandle& handle) = 0;
+	virtual bool isDone(const JobHandle& handle) const = 0;
+	/** splits [begin, end) in chunks of grainSize and blocks until all of them are done */
+	virtual void parallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, const RangeJob& job) = 0;
+
+	/** GL calls are only allowed on the main thread, these jobs run there once per frame */
+	virtual void runOnMainThread(Job job) = 0;
+	virtual void runMainThreadJobs() = 0;
+
+	virtual unsigned int getWorkerCount() const noexcept = 0;
+};
+
+//-----------------------------------------------------------------------------
+
 class IGameScene {
 public:
 	virtual ~IGameScene(){}
@@ -342,6 +561,12 @@ public:
 	virtual void addKeyboardListener(std::shared_ptr<IKeyboardListener>) noexcept = 0;
 	virtual void addCommands(ISceneObject::CommandMap commands) = 0;
 	virtual ICamera* getActiveCamera() const noexcept = 0;
+	virtual IJobSystem* getJobSystem() const noexcept = 0;
+	virtual void setSimulationRate(unsigned int ticksPerSecond) = 0;
+	/** simulates the next frame on a second thread while the current one is rendered */
+	virtual void setPipelined(bool pipelined) noexcept = 0;
+	/** plays back a session recorded with the "record" command, see InputReplay */
+	virtual void startReplay(const std::string& fileName) = 0;
 
 	virtual void keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt) = 0;
 	virtual void keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt) = 0;
@@ -365,6 +590,8 @@ public:
 	virtual void centerMouseCursor() const = 0;
 	virtual void setFullScreen() = 0;
 	virtual void addResizeListener(std::function<void(int, int)>) = 0;
+	virtual void setTargetFrameRate(unsigned int fps) = 0;
+	virtual const FrameStats& getFrameStats() const noexcept = 0;
 
 	virtual void setGameScene(std::shared_ptr<IGameScene>) = 0;
 	virtual std::shared_ptr<IGameScene> getGameScene() const = 0;
@@ -1,4 +1,4 @@
-#include <OpenGL/gl3.h>
+#include "../util/GLHeaders.h"
 #include <future>
 #include <SDL2/SDL_video.h>
 #include "Window.h"
@@ -75,8 +75,8 @@ void Window::resize(unsigned int width, unsigned int height) {
 }
 
 
-void Window::swap() const {
-	SDL_Delay(10);
+void Window::swap() {
+	mFrameScheduler.pace();
 	SDL_GL_SwapWindow(mWindow);
 }
 
@@ -131,15 +131,12 @@ void Window::loop() {
 	};
 
 	SDL_Event e;
-	unsigned int c = 0;
 
 	// start main loop
 	while (!quit) {
-		// optimization: we don't have to poll events every frame
-		if (c++ % 2 == 0) {
-			while (SDL_PollEvent(&e))
-				handleEvent(e);
-		}
+		while (SDL_PollEvent(&e))
+			handleEvent(e);
+
 		mGameScene->moveAndDisplay();
 		swap();
 	}
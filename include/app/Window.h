@@ -5,6 +5,7 @@
 #include <forward_list>
 #include <SDL2/SDL.h>
 #include "Interfaces.h"
+#include "FrameScheduler.h"
 
 
 class Window: public IWindow {
@@ -18,7 +19,9 @@ private:
 
 	std::forward_list<std::function<void(int w, int h)>> mWindowResizeListeners;
 
-	void swap() const;
+	FrameScheduler mFrameScheduler;
+
+	void swap();
 public:
 	Window(const char* title, unsigned int width, unsigned int height, Uint32 flags);
 	virtual ~Window();
@@ -32,6 +35,8 @@ public:
 	virtual void setGameScene(std::shared_ptr<IGameScene>) override;
 	virtual std::shared_ptr<IGameScene> getGameScene() const override;
 	virtual void addResizeListener(std::function<void(int, int)>) override;
+	virtual void setTargetFrameRate(unsigned int fps) override;
+	virtual const FrameStats& getFrameStats() const noexcept override;
 
 	virtual void keyDown(SDL_Keycode key, bool shift, bool ctrl, bool alt);
 	virtual void keyUp(SDL_Keycode key, bool shift, bool ctrl, bool alt);
@@ -59,6 +64,12 @@ inline void Window::setGameScene(std::shared_ptr<IGameScene> gameScene)
 inline std::shared_ptr<IGameScene> Window::getGameScene() const
 { return mGameScene; }
 
+inline void Window::setTargetFrameRate(unsigned int fps)
+{ mFrameScheduler.setTargetFrameRate(fps); }
+
+inline const FrameStats& Window::getFrameStats() const noexcept
+{ return mFrameScheduler.getStats(); }
+
 inline void Window::centerMouseCursor() const
 { SDL_WarpMouseInWindow(mWindow, mWidth/2, mHeight/2); }
 
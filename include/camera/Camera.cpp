@@ -1,3 +1,4 @@
+#include <cstring>
 #include "Camera.h"
 #include "../util/GLUtils.h"
 
@@ -99,10 +100,20 @@ void Camera::readVars(ISerializer* serializer) {
 
 
 void Camera::setMatrices(IShader* shader) const {
+	if (shader->hasUniformBlock(UniformBlock::VIEW))
+		return;
 	shader->set("V", mViewMatrix);
 	shader->set("P", mProjectionMatrix);
 }
 
+
+void Camera::updateUniformBlock() const {
+	UniformBlock::ViewData data;
+	std::memcpy(data.V, mViewMatrix.raw(), sizeof(data.V));
+	std::memcpy(data.P, mProjectionMatrix.raw(), sizeof(data.P));
+	UniformBlock::get(UniformBlock::VIEW).update(data);
+}
+
 void Camera::copyFrom(const ICamera* camera) noexcept {
 	mPosition = camera->getPosition();
 	mTargetPosition = mPosition + camera->getDirection();
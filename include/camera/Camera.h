@@ -48,13 +48,18 @@ public:
 	virtual btVector3 getDirectionUnit() const noexcept override;
 
 	void setFovY(float v) noexcept;
-	float getFovY() const noexcept;
+	virtual float getFovY() const noexcept override;
 
 	void setZnear(float v) noexcept;
-	float getZnear() const noexcept;
+	virtual float getZnear() const noexcept override;
 
 	void setZfar(float v) noexcept;
-	float getZfar() const noexcept;
+	virtual float getZfar() const noexcept override;
+
+	virtual float getAspectRatio() const noexcept override;
+
+	virtual const Matrix4x4& getViewMatrix() const noexcept override;
+	virtual const Matrix4x4& getProjectionMatrix() const noexcept override;
 
 	virtual bool isPaused() const noexcept override;
 	virtual void setPause(bool) noexcept override;
@@ -71,6 +76,7 @@ public:
 	virtual void setViewport() const override;
 
 	virtual void setMatrices(IShader* shader) const override;
+	virtual void updateUniformBlock() const override;
 	virtual void copyFrom(const ICamera*) noexcept override;
 };
 
@@ -124,6 +130,18 @@ inline void Camera::setZfar(float v) noexcept
 inline float Camera::getZfar() const noexcept
 { return mZfar; }
 
+inline float Camera::getAspectRatio() const noexcept
+{
+	auto window = mWindow.lock();
+	return window? window->getAspectRatio() : 1.f;
+}
+
+inline const Matrix4x4& Camera::getViewMatrix() const noexcept
+{ return mViewMatrix; }
+
+inline const Matrix4x4& Camera::getProjectionMatrix() const noexcept
+{ return mProjectionMatrix; }
+
 inline bool Camera::isPaused() const noexcept
 { return mPaused; }
 
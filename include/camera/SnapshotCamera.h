@@ -0,0 +1,29 @@
+#ifndef GAMEDEV3D_SNAPSHOT_CAMERA_H
+#define GAMEDEV3D_SNAPSHOT_CAMERA_H
+
+#include "Camera.h"
+
+/**
+ * Camera without a window or controls, only set with copyFrom() or the setters.
+ * Used for the copy handed to the simulation thread and for the replayed camera path.
+ */
+
+class SnapshotCamera: public Camera {
+public:
+	SnapshotCamera():
+		Camera(std::weak_ptr<IWindow>())
+	{}
+
+	// never serialized
+	virtual void write(ISerializer* serializer) const override {}
+	virtual const std::string& serializeID() const noexcept override;
+};
+
+//-----------------------------------------------------------------------------
+
+inline const std::string& SnapshotCamera::serializeID() const noexcept {
+	static const std::string& SERIALIZE_ID = "SnapshotCamera";
+	return SERIALIZE_ID;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include "RenderQueue.h"
+#include "../util/Profiler.h"
+#include "../util/RenderStats.h"
+
+static constexpr const uint64_t SHADER_BITS = 12;
+static constexpr const uint64_t MATERIAL_BITS = 16;
+
+
+RenderQueue::RenderQueue():
+	mPass(RenderPass::MAIN),
+	mTranslucent(false)
+{}
+
+
+// positive floats keep their order when their bits are compared as integers
+static uint64_t depthBits(float depth) {
+	depth = std::max(depth, 0.f);
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
+
+
+uint64_t RenderQueue::getShaderId(const IShader* shader) {
+	if (!shader)
+		return 0;
+
+	auto found = mShaderIds.find(shader);
+	if (found != mShaderIds.end())
+		return found->second;
+
+	// 0 is for the packets without shader
+	uint64_t id = (mShaderIds.size() + 1) & ((1ull << SHADER_BITS) - 1);
+	mShaderIds[shader] = id;
+	return id;
+}
+
+
+uint64_t RenderQueue::getMaterialId(const void* material) {
+	if (!material)
+		return 0;
+
+	auto found = mMaterialIds.find(material);
+	if (found != mMaterialIds.end())
+		return found->second;
+
+	uint64_t id = (mMaterialIds.size() + 1) & ((1ull << MATERIAL_BITS) - 1);
+	mMaterialIds[material] = id;
+	return id;
+}
+
+
+uint64_t RenderQueue::makeKey(const RenderPacket& packet) {
+	const uint64_t pass = static_cast<uint64_t>(mPass) << 60;
+	const uint64_t shader = getShaderId(packet.shader);
+	const uint64_t material = getMaterialId(packet.material);
+
+	if (mTranslucent) {
+		// the packets without shader too, shader 0 is drawn by itself
+		const uint64_t farDepth = 0xFFFFFFFFull - depthBits(packet.depth);
+		return pass | (farDepth << 28) | (shader << 16) | material;
+	}
+
+	if (!packet.shader)
+		return pass; // first, in submission order
+	return pass | (shader << 48) | (material << 32) | depthBits(packet.depth);
+}
+
+
+void RenderQueue::begin(RenderPass pass, bool translucent) {
+	mPass = pass;
+	mTranslucent = translucent;
+	mEntries.clear();
+}
+
+
+void RenderQueue::submit(RenderPacket&& packet) {
+	uint64_t key = makeKey(packet);
+	mEntries.push_back({ key, std::move(packet) });
+}
+
+
+RenderQueueStats RenderQueue::execute() {
+	PROFILE_SCOPE("execute");
+	std::stable_sort(mEntries.begin(), mEntries.end(), [](const Entry& a, const Entry& b){ return a.key < b.key; });
+
+	RenderQueueStats stats;
+	IShader* currentShader = nullptr;
+	const void* currentMaterial = nullptr;
+
+	for (auto& entry : mEntries) {
+		RenderPacket& packet = entry.packet;
+		RENDER_STATS_OBJECT(packet.name? packet.name : "packet");
+		stats.packets++;
+		stats.drawCalls += packet.drawCalls;
+
+		if (!packet.shader) {
+			// unknown state afterwards
+			PROFILE_SCOPE(packet.name? packet.name : "packet");
+			packet.draw(nullptr);
+			currentShader = nullptr;
+			currentMaterial = nullptr;
+			stats.legacyPackets++;
+			continue;
+		}
+
+		if (packet.shader != currentShader) {
+			packet.shader->run();
+			if (packet.setup)
+				packet.setup(packet.shader);
+			currentShader = packet.shader;
+			currentMaterial = nullptr;
+			stats.shaderChanges++;
+		} else
+			stats.skippedChanges++;
+
+		if (packet.bindMaterial) {
+			if (packet.material != currentMaterial || !packet.material) {
+				packet.bindMaterial(packet.shader);
+				currentMaterial = packet.material;
+				stats.materialChanges++;
+			} else
+				stats.skippedChanges++;
+		}
+
+		packet.draw(packet.shader);
+	}
+
+	if (currentShader)
+		IShader::stop();
+
+	mEntries.clear();
+	return stats;
+}
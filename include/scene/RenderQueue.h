@@ -0,0 +1,62 @@
+#ifndef GAMEDEV3D_RENDER_QUEUE_H
+#define GAMEDEV3D_RENDER_QUEUE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "../app/Interfaces.h"
+
+
+enum class RenderPass {
+	SHADOW,
+	REFLECTION,
+	MAIN
+};
+
+typedef struct {
+	unsigned int packets = 0;
+	unsigned int drawCalls = 0;
+	unsigned int shaderChanges = 0;
+	unsigned int materialChanges = 0;
+	unsigned int skippedChanges = 0; // setup or material binds avoided
+	unsigned int legacyPackets = 0; // packets without shader
+} RenderQueueStats;
+
+/**
+ * Collects the packets of one pass, sorts them by a 64-bit key and executes them.
+ *
+ * opaque:      pass(4) | shader(12) | material(16) | depth(32), front to back
+ * translucent: pass(4) | far depth(32) | shader(12) | material(16), back to front
+ *
+ * Opaque packets without shader keep their submission order and go first (they used to
+ * draw in object order). Translucent ones are sorted by depth like the others, the
+ * default packet of an object takes the distance to its bounding sphere, the farthest
+ * without one: the sky-wide objects (planet water and grass, clouds) go first.
+ */
+
+class RenderQueue: public IRenderQueue {
+	struct Entry {
+		uint64_t key;
+		RenderPacket packet;
+	};
+
+	RenderPass mPass;
+	bool mTranslucent;
+	std::vector<Entry> mEntries;
+
+	// compact ids for the keys, assigned the first time a shader or material is seen
+	std::unordered_map<const IShader*, uint64_t> mShaderIds;
+	std::unordered_map<const void*, uint64_t> mMaterialIds;
+
+	uint64_t getShaderId(const IShader* shader);
+	uint64_t getMaterialId(const void* material);
+	uint64_t makeKey(const RenderPacket& packet);
+public:
+	RenderQueue();
+
+	void begin(RenderPass pass, bool translucent);
+	virtual void submit(RenderPacket&& packet) override;
+	RenderQueueStats execute();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "../util/IoUtils.h"
 #include "../util/Shader.h"
 #include "../util/Texture.h"
+#include "../util/RenderStats.h"
 
 const static std::string DEFAULT_FONT { "/font/SourceSansPro-Regular.ttf" };
 const static GLuint gSlot = 0;
@@ -156,17 +157,17 @@ const TTF_Font* Renderer2d::getFont(const std::string& fontFile, unsigned int fo
 
 void Renderer2d::begin() {
 	// unbind buffer data, if any
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::get().disable(GL_DEPTH_TEST);
+	GLState::get().enable(GL_BLEND);
+	GLState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Renderer2d::end() {
-	glDisable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
+	GLState::get().disable(GL_BLEND);
+	GLState::get().enable(GL_DEPTH_TEST);
 }
 
 
@@ -230,6 +231,7 @@ void Renderer2d::renderImage(const ITexture* img, float x, float y, bool flipX,
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Point2d), flipX && flipY? &texCoord_flipXY[0] : flipX? &texCoord_flipX[0] : flipY? &texCoord_flipY[0] : &texCoord[0]);
 
 	glDrawElements(GL_QUADS, 4, GL_UNSIGNED_INT, &indices[0]);
+	RENDER_STATS_DRAW(GL_QUADS, 4, 1);
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
@@ -1,7 +1,11 @@
 #ifndef RENDERER2D_H
 #define RENDERER2D_H
 
+#if defined(__APPLE__)
 #include <SDL2_ttf/SDL_ttf.h>
+#else
+#include <SDL2/SDL_ttf.h>
+#endif
 #include <unordered_map>
 #include <map>
 #include "../app/Interfaces.h"
@@ -16,7 +16,7 @@ SceneObject::~SceneObject()
 
 Matrix4x4 SceneObject::getMatrix4x4() const
 {
-	static float m16[16];
+	float m16[16];
 	btDefaultMotionState* myMotionState = dynamic_cast<btDefaultMotionState*>(mPhysicsBody->getRigidBody()->getMotionState());
 	if (myMotionState)
 		myMotionState->m_graphicsWorldTrans.getOpenGLMatrix(m16);
@@ -27,8 +27,49 @@ Matrix4x4 SceneObject::getMatrix4x4() const
 }
 
 
-Matrix4x4 SceneObject::getMatrix4x4(btTransform& transform) const {
-	static float m16[16];
+Matrix4x4 SceneObject::getSimulationMatrix4x4() const
+{
+	return getMatrix4x4(mPhysicsBody->getRigidBody()->getWorldTransform());
+}
+
+
+void SceneObject::captureState()
+{
+	if (!mPhysicsBody)
+		return;
+
+	InterpolatedMotionState* motionState = dynamic_cast<InterpolatedMotionState*>(mPhysicsBody->getMotionState());
+	if (motionState)
+		motionState->capture();
+}
+
+
+void SceneObject::interpolate(float alpha)
+{
+	if (!mPhysicsBody)
+		return;
+
+	InterpolatedMotionState* motionState = dynamic_cast<InterpolatedMotionState*>(mPhysicsBody->getMotionState());
+	if (motionState)
+		motionState->interpolate(alpha);
+}
+
+
+bool SceneObject::getBoundingSphere(btVector3& center, float& radius) const
+{
+	if (!mPhysicsBody)
+		return false;
+
+	btTransform transform;
+	mPhysicsBody->getMotionState()->getWorldTransform(transform);
+	mPhysicsBody->getCollisionShape()->getBoundingSphere(center, radius);
+	center = transform(center);
+	return true;
+}
+
+
+Matrix4x4 SceneObject::getMatrix4x4(const btTransform& transform) const {
+	float m16[16];
 	transform.getOpenGLMatrix(m16);
 	return Matrix4x4(m16);
 }
@@ -41,7 +82,7 @@ void SceneObject::createPhysicsBody(float mass, const btTransform& startTransfor
 	if (mass != 0.f)
 		shape->calculateLocalInertia(mass, localInertia);
 
-	std::unique_ptr<btMotionState> puMotionState = std::make_unique<btDefaultMotionState>(startTransform);
+	std::unique_ptr<btMotionState> puMotionState = std::make_unique<InterpolatedMotionState>(startTransform);
 
 	mPhysicsBody = std::make_unique<PhysicsBody>(mass, std::move(shape), std::move(puMotionState), localInertia);
 	mPhysicsBody->getCollisionShape()->setMargin(.2f);
@@ -5,6 +5,7 @@
 #include "btBulletDynamicsCommon.h"
 #include "../app/Interfaces.h"
 #include "../util/PhysicsBody.h"
+#include "../util/InterpolatedMotionState.h"
 
 
 class SceneObject: public ISceneObject
@@ -23,8 +24,12 @@ public:
 	SceneObject(std::weak_ptr<btDynamicsWorld>);
 	virtual ~SceneObject();
 
-	Matrix4x4 getMatrix4x4(btTransform& transform) const;
+	Matrix4x4 getMatrix4x4(const btTransform& transform) const;
 	virtual Matrix4x4 getMatrix4x4() const override;
+	virtual Matrix4x4 getSimulationMatrix4x4() const override;
+	virtual void captureState() override;
+	virtual void interpolate(float alpha) override;
+	virtual bool getBoundingSphere(btVector3& center, float& radius) const override;
 
 	virtual float getCameraHeight() const noexcept override;
 	void setCameraHeight(float height) noexcept;
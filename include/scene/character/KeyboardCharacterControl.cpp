@@ -50,7 +50,7 @@ void KeyboardCharacterControl::update(const ICamera* camera) {
 		}
 	} else {
 		// The vehicle is carrying the character, so we have to update the position of the character.
-		const btVector3& vehiclePosition = mVehicles[mCurrentVehicleIndex]->getMatrix4x4().getOrigin();
+		const btVector3& vehiclePosition = mVehicles[mCurrentVehicleIndex]->getSimulationMatrix4x4().getOrigin();
 		mCharacter->setPosition(vehiclePosition);
 	}
 
@@ -134,7 +134,7 @@ void KeyboardCharacterControl::keyUp(SDL_Keycode key, bool shift, bool ctrl, boo
 void KeyboardCharacterControl::findVehicleNearby() {
 	int i = 0;
 	for (const auto& v : mVehicles) {
-		float distance = mCharacter->getMatrix4x4().getOrigin().distance(v->getMatrix4x4().getOrigin());
+		float distance = mCharacter->getSimulationMatrix4x4().getOrigin().distance(v->getSimulationMatrix4x4().getOrigin());
 		if (distance < mVehicleMinDistance) {
 			mCurrentVehicleIndex = i;
 			mCharacter->setVisible(false);
@@ -148,7 +148,7 @@ void KeyboardCharacterControl::findVehicleNearby() {
 
 void KeyboardCharacterControl::leaveVehicle() {
 	// Move the character to the side of the vehicle
-	const Matrix4x4& vehicleMatrix4x4 = mVehicles[mCurrentVehicleIndex]->getMatrix4x4();
+	const Matrix4x4& vehicleMatrix4x4 = mVehicles[mCurrentVehicleIndex]->getSimulationMatrix4x4();
 	const btVector3& toTheLeft = vehicleMatrix4x4.getRow(0);
 	const btVector3& leftSide = vehicleMatrix4x4.getOrigin() + 2.0f * toTheLeft;
 	mCharacter->setPosition(leftSide);
@@ -6,6 +6,11 @@ const std::string& OBJCharacter::SERIALIZE_ID = "OBJCharacter";
 //-----------------------------------------------------------------------------
 
 Matrix4x4 OBJCharacter::getMatrix4x4() const {
+	return mRenderMatrix;
+}
+
+
+Matrix4x4 OBJCharacter::getSimulationMatrix4x4() const {
 	return mMatrix;
 }
 
@@ -35,9 +40,26 @@ void OBJCharacter::moveTo(const btVector3& direction, float speed) {
 }
 
 
+void OBJCharacter::updateSimulation() {
+	mPreviousMatrix = mTickMatrix;
+	mTickMatrix = mMatrix;
+}
+
+
+void OBJCharacter::captureState() {
+	mCapturedPreviousMatrix = mPreviousMatrix;
+	mCapturedTickMatrix = mTickMatrix;
+}
+
+
+void OBJCharacter::interpolate(float alpha) {
+	mRenderMatrix = InterpolatedMotionState::interpolate(mCapturedPreviousMatrix.getTransform(), mCapturedTickMatrix.getTransform(), alpha);
+}
+
+
 void OBJCharacter::renderOpaque(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
 	if (mIsVisible)
-		mAnimations[currentAnimationIndex]->render(camera, sky, shadowMap, mMatrix, true);
+		mAnimations[currentAnimationIndex]->render(camera, sky, shadowMap, mRenderMatrix, true);
 }
 
 
@@ -11,6 +11,12 @@ class OBJCharacter: public SceneObject {
 
 	bool mIsVisible;
 	Matrix4x4 mMatrix;
+	// last two simulation ticks, their copy for the renderer and the blend of both that is rendered
+	Matrix4x4 mPreviousMatrix;
+	Matrix4x4 mTickMatrix;
+	Matrix4x4 mCapturedPreviousMatrix;
+	Matrix4x4 mCapturedTickMatrix;
+	Matrix4x4 mRenderMatrix;
 	std::shared_ptr<Planet> mPlanet;
 	unsigned int currentAnimationIndex;
 
@@ -30,11 +36,17 @@ public:
 		mIsInVehicle(false),
 		mPlanet(planet),
 		mMatrix(transform),
+		mPreviousMatrix(transform),
+		mTickMatrix(transform),
+		mCapturedPreviousMatrix(transform),
+		mCapturedTickMatrix(transform),
+		mRenderMatrix(transform),
 		currentAnimationIndex(0)
 	{}
 
 	void setVisible(bool visible) noexcept;
 	virtual Matrix4x4 getMatrix4x4() const override;
+	virtual Matrix4x4 getSimulationMatrix4x4() const override;
 	void setPosition(const btVector3& position);
 
 	void addAnimation(std::unique_ptr<OBJAnimation>&& animation);
@@ -49,6 +61,9 @@ public:
 	virtual float getMinCameraDistance() const noexcept override;
 	virtual float getMaxCameraDistance() const noexcept override;
 
+	virtual void updateSimulation() override;
+	virtual void captureState() override;
+	virtual void interpolate(float alpha) override;
 	void renderOpaque(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 
 	virtual void write(ISerializer *serializer) const override;
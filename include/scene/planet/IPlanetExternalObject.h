@@ -8,6 +8,9 @@ class IPlanetExternalObject: public ISerializable {
 public:
 	virtual ~IPlanetExternalObject(){}
 
+	/** false for the small objects (grass, plants) that are not worth rendering in the water reflection */
+	virtual bool isReflected() const { return true; }
+
 	virtual void renderOpaque(const std::unordered_map<unsigned int,float>& pageIds, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const GameState& gameState) {};
 	virtual void renderTranslucent(const std::unordered_map<unsigned int,float>& pageIds, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const GameState& gameState) {};
 };
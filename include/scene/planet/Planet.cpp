@@ -1,13 +1,27 @@
 #include <chrono>
 #include "Planet.h"
 #include "../../util/Shader.h"
+#include "../../util/ShaderVariants.h"
 #include "../../util/ShadowMap.h"
 #include "../../util/Texture.h"
 #include "SurfaceReflection.h"
 #include "../../util/ShaderUtils.h"
 #include "../../util/ShaderNoise.h"
 #include "../sky/SkyShader.h"
-
+#include "../../util/Profiler.h"
+#include "../../util/GpuProfiler.h"
+#include "../../util/RenderStats.h"
+#include "../../util/VertexArray.h"
+
+
+// #define flags of the terrain variants, in the order of Planet::TerrainFeature
+static constexpr const char* _terrainFeatures[] = {
+	"REFLECTION",
+	"EDITING",
+	"SHADOW",
+	"SOFT_SHADOW",
+	"HAZE"
+};
 
 static const char* _vs[] = {
 	"attribute vec4 position;"
@@ -15,9 +29,9 @@ static const char* _vs[] = {
 	"attribute vec4 material;"
 	"attribute vec2 uv;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
-	"uniform vec3 sunPosition;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 
 	"varying vec3 worldV;"
 	"varying vec4 eyeV;"
@@ -27,8 +41,7 @@ static const char* _vs[] = {
 	"varying vec4 _material;"
 
 	,ShadowMap::getVertexShaderCode(),
-
-	"uniform vec3 cameraPosition;"
+	" "
 	,SurfaceReflection::getVertexShaderCode(),
 	" "
 	,ShaderUtils::TO_MAT3,
@@ -36,7 +49,11 @@ static const char* _vs[] = {
 	"void main() {"
 		"setShadowMap(position);"
 
+		"\n#ifdef REFLECTION\n"
 		"vec3 position0 = planetSurfaceReflection(position.xyz);"
+		"\n#else\n"
+		"vec3 position0 = position.xyz;"
+		"\n#endif\n"
 		"_uv = vec3(uv.xy, waterLevel - length(position.xyz));"
 		"_material = material;"
 		"worldV = position.xyz;"
@@ -61,12 +78,16 @@ static constexpr const char* _fs[] = {
 	"uniform sampler2D material3;"
 	"uniform float material3_scale;"
 
+	,UniformBlock::SKY_CODE,
+	" "
 	,SkyShader::SHARED_FRAGMENT_CODE,
 	" "
 	,ShadowMap::getFragmentShaderCode(),
 
+	"\n#ifdef EDITING\n"
 	"uniform vec3 mousePosition;"
 	"uniform float brushSize;"
+	"\n#endif\n"
 
 	"varying vec3 worldV;"
 	"varying vec4 eyeV;"
@@ -76,9 +97,7 @@ static constexpr const char* _fs[] = {
 	"varying vec3 _uv;"
 
 	// PlanetSurfaceReflection
-	"uniform bool isRenderingReflection;"
-	"uniform float waterLevel;"
-	"uniform float distanceToHorizon;"
+	,UniformBlock::REFLECTION_CODE,
 
 	"const float MAX_DEPTH = 30.0;"
 	"const vec4 WATER_SHALLOW_COLOR = vec4(124, 183, 160, 255) / 255.0;"
@@ -111,36 +130,40 @@ static constexpr const char* _fs[] = {
 				"matColor = mix(matColor, waterColor, depth);"
 			"}"
 
-			"if (!isRenderingReflection)"
-				"shadow = getShadow9(worldV);"
+			"\n#if defined(SHADOW) && defined(SOFT_SHADOW)\n"
+			"shadow = getShadow9(worldV);"
+			"\n#elif defined(SHADOW)\n"
+			"shadow = getShadow1(worldV);"
+			"\n#endif\n"
 		"}"
 		"return sky_lighting(matColor, eyeV, eyeN, eyeL, shadow);"
 	"}"
 
 	"void main() {"
-		"if (isRenderingReflection) {"
-			// if the point is under water, discard it
-			"float height = length(worldV);"
-			"if (height <= waterLevel)"
+		"\n#ifdef REFLECTION\n"
+		// if the point is under water, discard it
+		"float height = length(worldV);"
+		"if (height <= waterLevel)"
+			"discard;"
+		// If the point is beyond the horizon and behind the planet, discard it
+		"if (-eyeV.z > distanceToHorizon) {"
+			"float dotOriginToPoint = sky_dotOriginToPoint(worldV.xyz);"
+			"if (dotOriginToPoint > dotOriginToHorizon)"
 				"discard;"
-			// If the point is beyond the horizon and behind the planet, discard it
-			"if (-eyeV.z > distanceToHorizon) {"
-				"float dotOriginToPoint = sky_dotOriginToPoint(worldV.xyz);"
-				"if (dotOriginToPoint > dotOriginToHorizon)"
-					"discard;"
-			"}"
 		"}"
+		"\n#endif\n"
 
 		"gl_FragColor = color(eyeV.xyz, eyeN, eyeL.xyz);"
 
-		"if (!isRenderingReflection) {"
-			"float d = distance(mousePosition, worldV);"
-			"if (d <= brushSize)"
-				"gl_FragColor *= vec4(0.8, 0.8, 0.8, 0.2);"
+		"\n#ifdef EDITING\n"
+		"float d = distance(mousePosition, worldV);"
+		"if (d <= brushSize)"
+			"gl_FragColor *= vec4(0.8, 0.8, 0.8, 0.2);"
+		"\n#endif\n"
 
-			// apply haze
-			"gl_FragColor = sky_mixHaze(gl_FragColor, -eyeV.z, worldV);"
-		"}"
+		"\n#ifdef HAZE\n"
+		"gl_FragColor = sky_mixHaze(gl_FragColor, -eyeV.z, worldV);"
+		"\n#endif\n"
 		"gl_FragColor.a = 1.0;"
 	"}"
 };
@@ -149,13 +172,12 @@ static constexpr const char* _vsWater[] = {
 	"attribute vec4 position;"
 	"attribute vec2 uv;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 	"uniform float waterLevel;"
-	"uniform vec3 sunPosition;"
 
 	"varying vec3 worldV;"
-	"varying vec4 projectedV;"
 	"varying vec4 eyeV;"
 	"varying vec3 eyeN;"
 	"varying vec4 eyeL;"
@@ -178,23 +200,24 @@ static constexpr const char* _vsWater[] = {
 		"eyeV = V * p4;"
 		"eyeN = toMat3(V) * up1;"
 		"eyeL = V * vec4(sunPosition, 1.0);"
-		"projectedV = P * V * p4;"
-		"gl_Position = projectedV;"
+		"gl_Position = P * V * p4;"
 	"}"
 };
 
 static constexpr const char* _fsWater[] = {
 	"varying vec3 worldV;"
-	"varying vec4 projectedV;"
 	"varying vec4 eyeV;"
 	"varying vec3 eyeN;"
 	"varying vec4 eyeL;"
 	"varying vec3 _uv;"
 
 	"uniform sampler2D reflectionTexture;"
+	"uniform mat4 reflectionVP;"
 
 	"uniform sampler2D waterNormalTexture;"
 
+	,UniformBlock::SKY_CODE,
+	" "
 	,SkyShader::SHARED_FRAGMENT_CODE,
 	" "
 	,ShaderNoise::SHADER_CODE,
@@ -206,7 +229,9 @@ static constexpr const char* _fsWater[] = {
 	,ShaderUtils::TO_PLANET_SURFACE,
 
 	"vec2 texCoord(vec2 shift) {"
-		"vec2 c = (vec2(projectedV) + shift) / projectedV.w;"
+		// the reflection may be a few frames old, project with the camera it was rendered with
+		"vec4 r = reflectionVP * vec4(worldV, 1.0);"
+		"vec2 c = (vec2(r) + shift) / r.w;"
 		"c = (c + 1.0) * 0.5;"
 		"return clamp(c, 0.0, 1.0);"
 	"}"
@@ -318,17 +343,20 @@ void Planet::moveTo(Matrix4x4& matrix, const btVector3& direction, float speed)
 
 
 void Planet::initPhysics(btTransform transform) {
-	mShader = std::make_unique<Shader>(_vs, _fs);
-	mShader->bindAttribute(0, "position");
-	mShader->bindAttribute(1, "normal");
-	mShader->bindAttribute(2, "material");
-	mShader->bindAttribute(3, "uv");
-	mShader->link();
+	mTerrainShaders = std::make_unique<ShaderVariants>(_vs, _fs, _terrainFeatures);
+	mTerrainShaders->bindAttribute(0, "position");
+	mTerrainShaders->bindAttribute(1, "normal");
+	mTerrainShaders->bindAttribute(2, "material");
+	mTerrainShaders->bindAttribute(3, "uv");
+	// the variants of a game without editing, the others are linked when first needed
+	getTerrainProgram(TERRAIN_SHADOW | TERRAIN_SOFT_SHADOW | TERRAIN_HAZE);
+	getTerrainProgram(TERRAIN_REFLECTION);
 
 	mWaterShader = std::make_unique<Shader>(_vsWater, _fsWater);
 	mWaterShader->bindAttribute(0, "position");
 	mWaterShader->bindAttribute(1, "uv");
 	mWaterShader->link();
+	mWaterLevelUniform = mWaterShader->getUniform("waterLevel");
 
 	std::shared_ptr<btDynamicsWorld> dynamicsWorld = mDynamicsWorld.lock();
 	btDynamicsWorld* pDynamicsWorld = dynamicsWorld.get();
@@ -397,6 +425,12 @@ void Planet::runAction(const GameState& gameState, const ICamera* camera) {
 
 
 void Planet::collectVisiblePageIds(const ICamera* camera) {
+	const auto& cameraVersion = std::make_pair(camera, camera->getVersion());
+	if (mVisiblePagesCamera == cameraVersion)
+		return;
+
+	PROFILE_SCOPE("planet culling");
+	mVisiblePagesCamera = cameraVersion;
 	mVisiblePages.clear();
 	mHasVisibleWater = false;
 	const btVector3& innerPoint = PlanetPage::getInnerPoint(camera, mRadius);
@@ -406,62 +440,126 @@ void Planet::collectVisiblePageIds(const ICamera* camera) {
 }
 
 
+void Planet::collectReflectionPageIds(const ISurfaceReflection* surfaceReflection) {
+	mReflectionPages.clear();
+	for (const auto& page : mVisiblePages) {
+		if (page.second <= surfaceReflection->getMaxDistance())
+			mReflectionPages.insert(page);
+	}
+}
+
+
+bool Planet::hasVisibleReflection(const ICamera* camera) {
+	collectVisiblePageIds(camera);
+	return mHasVisibleWater;
+}
+
+
+unsigned int Planet::getTerrainFeatures(const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
+	// the reflection has no shadows, haze or brush
+	if (surfaceReflection->isRendering())
+		return TERRAIN_REFLECTION;
+
+	unsigned int features = TERRAIN_HAZE;
+	if (gameState.mode == GameMode::EDITING)
+		features |= TERRAIN_EDITING;
+	if (gameState.debugCode != DebugCode::NO_SHADOW) {
+		features |= TERRAIN_SHADOW;
+		if (shadowMap->hasSoftShadows())
+			features |= TERRAIN_SOFT_SHADOW;
+	}
+	return features;
+}
+
+
+const Planet::TerrainProgram& Planet::getTerrainProgram(unsigned int features) {
+	auto it = mTerrainPrograms.find(features);
+	if (it != mTerrainPrograms.end())
+		return it->second;
+
+	TerrainProgram program;
+	program.shader = mTerrainShaders->get(features);
+	for (unsigned int i = 0; i < program.materials.size(); i++) {
+		const std::string& mat = "material" + std::to_string(i);
+		program.materials[i] = program.shader->getUniform(mat);
+		program.materialScales[i] = program.shader->getUniform(mat + "_scale");
+	}
+	program.brushSize = program.shader->getUniform("brushSize");
+	program.mousePosition = program.shader->getUniform("mousePosition");
+	return mTerrainPrograms.emplace(features, program).first->second;
+}
+
+
+void Planet::collectShadowPageIds(const ICamera* camera, const IShadowMap* shadowMap) {
+	PROFILE_SCOPE("planet shadow culling");
+	mShadowPages.clear();
+	for (auto& face : mFaces) {
+		face->getShadowCasterPageIds(shadowMap, camera->getPosition(), mShadowPages);
+	}
+}
+
+
 void Planet::renderOpaque(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
 	// No need to paint anything if the shadowmap is being created
-	// The terrain doesn't cast shadows
+	// The terrain doesn't cast shadows, only the external objects inside the light's box do
 	if (shadowMap->isRendering()) {
-		collectVisiblePageIds(camera);
+		collectShadowPageIds(camera, shadowMap);
 		for (auto& o : mExternalObjects) {
-			o->renderOpaque(mVisiblePages, camera, sky, shadowMap, gameState);
+			o->renderOpaque(mShadowPages, camera, sky, shadowMap, gameState);
 		}
 		return;
 	}
 
-	IShader* pShader = mShader.get();
+	collectVisiblePageIds(camera);
 
-	mShader->run();
+	const TerrainProgram& program = getTerrainProgram(getTerrainFeatures(shadowMap, surfaceReflection, gameState));
+	IShader* pShader = program.shader;
+
+	pShader->run();
 	camera->setMatrices(pShader);
 	sky->setVars(pShader, camera);
 	shadowMap->setVars(pShader);
 	surfaceReflection->setVars(pShader, camera);
-	mShader->set("brushSize", mBrushSize);
 
 	// set materials
-	for (int i = 0; i < mTextureArray.size(); i++) {
-		std::string mat = "material" + std::to_string(i);
+	for (unsigned int i = 0; i < mTextureArray.size(); i++) {
 		ITexture* tex = mTextureArray[i].get();
-		mShader->set(mat, tex);
-		mShader->set(mat + "_scale", tex->getScaleFactor());
+		program.materials[i].set(tex);
+		program.materialScales[i].set(tex->getScaleFactor());
 	}
 
 	if (gameState.mode == GameMode::EDITING) {
-		mShader->set("mousePosition", gameState.mouse3d);
-		if (gameState.isLeftMouseDown || gameState.isRightMouseDown)
+		program.brushSize.set(mBrushSize);
+		program.mousePosition.set(gameState.mouse3d);
+		if (gameState.isLeftMouseDown || gameState.isRightMouseDown) {
 			runAction(gameState, camera);
-	} else {
-		const static btVector3 farAway(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
-		mShader->set("mousePosition", farAway);
+			mVisiblePagesCamera = std::make_pair(nullptr, -1); // water may have changed
+		}
 	}
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
-
-	for (auto& face : mFaces)
-		face->renderOpaque(mVisiblePages, camera, gameState);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	{
+		// CPU side of the page draws (one vertex array bind and draw per page)
+		PROFILE_SCOPE("terrain draw");
+		GPU_PROFILE_SCOPE("terrain");
+		RENDER_STATS_OBJECT("terrain");
+		for (auto& face : mFaces)
+			face->renderOpaque(mVisiblePages, camera, gameState);
+	}
+	VertexArray::unbind();
 
 	IShader::stop();
 	ITexture::unbind();
 
+	// the reflection only shows the big objects close to the camera
+	if (surfaceReflection->isRendering()) {
+		collectReflectionPageIds(surfaceReflection);
+		for (auto& o : mExternalObjects) {
+			if (o->isReflected())
+				o->renderOpaque(mReflectionPages, camera, sky, shadowMap, gameState);
+		}
+		return;
+	}
+
 	for (auto& o : mExternalObjects) {
 		o->renderOpaque(mVisiblePages, camera, sky, shadowMap, gameState);
 	}
@@ -471,16 +569,17 @@ void Planet::renderOpaque(const ICamera* camera, const ISky *sky, const IShadowM
 void Planet::renderTranslucent(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState &gameState) {
 	if (shadowMap->isRendering()) {
 		for (auto& o : mExternalObjects) {
-			o->renderTranslucent(mVisiblePages, camera, sky, shadowMap, gameState);
+			o->renderTranslucent(mShadowPages, camera, sky, shadowMap, gameState);
 		}
 		return;
 	} else if (surfaceReflection->isRendering())
 		return;
 
 	if (mHasVisibleWater) {
+		GPU_PROFILE_SCOPE("water");
+		RENDER_STATS_OBJECT("water");
 		mWaterShader->run();
-		mWaterShader->set("waterLevel", mWaterLevel);
-		mWaterShader->set("sunPosition", sky->getSunPosition());
+		mWaterLevelUniform.set(mWaterLevel);
 
 		IShader* pWaterShader = mWaterShader.get();
 		camera->setMatrices(pWaterShader);
@@ -488,17 +587,9 @@ void Planet::renderTranslucent(const ICamera *camera, const ISky *sky, const ISh
 		ShaderNoise::setVars(pWaterShader);
 		surfaceReflection->setReflectionTexture(pWaterShader);
 
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-
 		for (auto& face : mFaces)
 			face->renderTranslucent(mVisiblePages, camera, gameState);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		VertexArray::unbind();
 
 		IShader::stop();
 	}
@@ -648,22 +739,22 @@ std::pair<std::string, Factory> Planet::factory() {
 
 		serializer->readBegin(name, oId);
 		std::shared_ptr<ISerializable> m0 = textureFactory.create(objectId, serializer, window);
-		o->mTextureArray[0] = std::dynamic_pointer_cast<Texture>(m0);
+		o->mTextureArray[0] = std::dynamic_pointer_cast<ITexture>(m0);
 		o->mTextureArray[0]->mipmap()->repeat();
 
 		serializer->readBegin(name, oId);
 		std::shared_ptr<ISerializable> m1 = textureFactory.create(objectId, serializer, window);
-		o->mTextureArray[1] = std::dynamic_pointer_cast<Texture>(m1);
+		o->mTextureArray[1] = std::dynamic_pointer_cast<ITexture>(m1);
 		o->mTextureArray[1]->mipmap()->repeat();
 
 		serializer->readBegin(name, oId);
 		std::shared_ptr<ISerializable> m2 = textureFactory.create(objectId, serializer, window);
-		o->mTextureArray[2] = std::dynamic_pointer_cast<Texture>(m2);
+		o->mTextureArray[2] = std::dynamic_pointer_cast<ITexture>(m2);
 		o->mTextureArray[2]->mipmap()->repeat();
 
 		serializer->readBegin(name, oId);
 		std::shared_ptr<ISerializable> m3 = textureFactory.create(objectId, serializer, window);
-		o->mTextureArray[3] = std::dynamic_pointer_cast<Texture>(m3);
+		o->mTextureArray[3] = std::dynamic_pointer_cast<ITexture>(m3);
 		o->mTextureArray[3]->mipmap()->repeat();
 
 		// Faces
@@ -6,6 +6,7 @@
 #include "../SceneObject.h"
 #include "PlanetFace.h"
 
+class ShaderVariants;
 
 class Planet: public SceneObject
 {
@@ -18,17 +19,47 @@ class Planet: public SceneObject
 	std::forward_list<std::shared_ptr<btRigidBody>> mInteractiveBodies;
 	std::forward_list<std::shared_ptr<IPlanetExternalObject>> mExternalObjects;
 
-	std::unique_ptr<IShader> mShader;
+	// bits of a terrain variant, each pass only compiles in the code it needs
+	enum TerrainFeature: unsigned int {
+		TERRAIN_REFLECTION = 1,
+		TERRAIN_EDITING = 2, // brush highlight
+		TERRAIN_SHADOW = 4,
+		TERRAIN_SOFT_SHADOW = 8,
+		TERRAIN_HAZE = 16
+	};
+
+	// a terrain variant and its uniforms, resolved after linking
+	typedef struct {
+		IShader* shader;
+		std::array<Uniform,4> materials;
+		std::array<Uniform,4> materialScales;
+		Uniform brushSize;
+		Uniform mousePosition;
+	} TerrainProgram;
+
+	std::unique_ptr<ShaderVariants> mTerrainShaders;
+	std::unordered_map<unsigned int, TerrainProgram> mTerrainPrograms;
 	std::unique_ptr<IShader> mWaterShader;
 
 	std::array<std::shared_ptr<ITexture>,4> mTextureArray;
+	Uniform mWaterLevelUniform; // mWaterShader
 
 	bool mHasVisibleWater;
 	std::unordered_map<unsigned int,float> mVisiblePages;
+	// camera and camera version of mVisiblePages, the reflection and main passes share them
+	std::pair<const ICamera*, unsigned long> mVisiblePagesCamera {nullptr, -1};
+	// pages inside the light's box, for the vegetation shadows
+	std::unordered_map<unsigned int,float> mShadowPages;
+	// visible pages close enough to be reflected on the water
+	std::unordered_map<unsigned int,float> mReflectionPages;
 
 	void fixBorderNormals(const btVector3& mouse3d, float brushSize, const ICamera *camera, const btVector3& innerPoint);
 	void runAction(const GameState& gameState, const ICamera* camera);
 	void collectVisiblePageIds(const ICamera*);
+	void collectShadowPageIds(const ICamera*, const IShadowMap*);
+	void collectReflectionPageIds(const ISurfaceReflection*);
+	static unsigned int getTerrainFeatures(const IShadowMap*, const ISurfaceReflection*, const GameState&);
+	const TerrainProgram& getTerrainProgram(unsigned int features);
 protected:
 	virtual ISceneObject::CommandMap getCommands() override;
 
@@ -53,6 +84,8 @@ public:
 	void interactWith(std::shared_ptr<btRigidBody> rigidBody) noexcept;
 	void addExternalObject(std::shared_ptr<IPlanetExternalObject> externalObject);
 
+	virtual bool hasStaticShadow() const override { return true; }
+	virtual bool hasVisibleReflection(const ICamera* camera) override;
 	virtual void updateSimulation() override;
 	virtual void renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 	virtual void renderTranslucent(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
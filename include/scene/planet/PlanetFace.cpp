@@ -105,6 +105,13 @@ void PlanetFace::getVisiblePageIds(const ICamera* camera, const btVector3& inner
 }
 
 
+void PlanetFace::getShadowCasterPageIds(const IShadowMap* shadowMap, const btVector3& cameraPosition, std::unordered_map<unsigned int,float>& pageIds) const {
+	for (auto& page : mPages) {
+		if (page->isShadowCaster(shadowMap))
+			pageIds[page->getPageId()] = page->arcDistanceTo(cameraPosition);
+	}
+}
+
 
 void PlanetFace::enablePhysics(btDynamicsWorld *dynamicsWorld, const std::forward_list<std::shared_ptr<btRigidBody>>& rigidBodies) {
 	for (auto& page : mPages) {
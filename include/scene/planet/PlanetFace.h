@@ -32,6 +32,7 @@ public:
 	unsigned int getPageId(const btVector3&) const;
 	size_t getPageCount() const noexcept;
 	void getVisiblePageIds(const ICamera*, const btVector3& innerPoint, std::unordered_map<unsigned int,float>&, bool& hasVisibleWater) const;
+	void getShadowCasterPageIds(const IShadowMap*, const btVector3& cameraPosition, std::unordered_map<unsigned int,float>&) const;
 
 	void initPhysics(btDynamicsWorld* dynamicsWorld);
 	void renderOpaque(const std::unordered_map<unsigned int,float>& visiblePages, const ICamera* camera, const GameState& gameState);
@@ -1,8 +1,11 @@
 #include <btBulletDynamicsCommon.h>
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <chrono>
 #include "PlanetPage.h"
 #include "../../util/math/Plane.h"
+#include "../../util/RenderStats.h"
 
 
 const static btVector3 PLANET_CENTER(0.f, 0.f, 0.f);
@@ -10,7 +13,10 @@ const static btVector3 PLANET_CENTER(0.f, 0.f, 0.f);
 
 /* private constructor */
 PlanetPage::PlanetPage(unsigned int pageId):
-	mPageId(pageId)
+	mPageId(pageId),
+	mVbo(0),
+	mIboDetailed(0),
+	mIboSimplified(0)
 {}
 
 
@@ -19,7 +25,10 @@ PlanetPage::PlanetPage(unsigned int pageId, const std::string& plane, float radi
 	mPlanetRadius(radius),
 	mWaterLevel(waterLevel),
 	mHasWater(false),
-	mIsActive(false)
+	mIsActive(false),
+	mVbo(0),
+	mIboDetailed(0),
+	mIboSimplified(0)
 {
 	if (pageDivisions % 2 == 1)
 		throw std::runtime_error("pageDivisions must be even, but it is " + std::to_string(pageDivisions));
@@ -27,13 +36,18 @@ PlanetPage::PlanetPage(unsigned int pageId, const std::string& plane, float radi
 	buildDetailedMesh(plane, radius, d1, d2, size, face, pageDivisions);
 	buildSimplifiedMesh(plane, pageDivisions);
 	setFieldOfView();
+	updateBoundingRadius();
 }
 
 
 PlanetPage::~PlanetPage() {
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mIboDetailed);
-	glDeleteBuffers(1, &mIboSimplified);
+	// pages that were never bound have no GL buffers (and may have no GL context)
+	if (mVbo == 0)
+		return;
+
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mIboDetailed);
+	GLState::get().deleteBuffers(1, &mIboSimplified);
 }
 
 
@@ -261,6 +275,15 @@ void PlanetPage::setFieldOfView() {
 }
 
 
+void PlanetPage::updateBoundingRadius() {
+	const btVector3& center = mVertices[mCenterIndex].position;
+	float radius2 = 0.f;
+	for (const auto& vertex : mVertices)
+		radius2 = std::max(radius2, center.distance2(vertex.position));
+	mBoundingRadius = std::sqrt(radius2);
+}
+
+
 void PlanetPage::initPhysics(btDynamicsWorld* dynamicsWorld) {
 	bind();
 
@@ -298,52 +321,58 @@ void PlanetPage::bind() {
 	glGenBuffers(1, &mIboDetailed);
 	glGenBuffers(1, &mIboSimplified);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, mVerticeCount * sizeof(PlanetPageVertex), &mVertices[0].position, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboDetailed);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboDetailed);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndicesDetailed.size() * sizeof(unsigned int), &mIndicesDetailed[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboSimplified);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboSimplified);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndicesSimplified.size() * sizeof(unsigned int), &mIndicesSimplified[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// the vertex buffer is uploaded again when edited, the arrays keep pointing to it
+	const GLuint ibos[2] = { mIboDetailed, mIboSimplified };
+	for (int i = 0; i < 2; i++) {
+		mOpaqueArrays[i].begin();
+		VertexArray::attribute(0, mVbo, 3, sizeof(PlanetPageVertex), 0);
+		VertexArray::attribute(1, mVbo, 3, sizeof(PlanetPageVertex), offsetof(PlanetPageVertex, normal));
+		VertexArray::attribute(2, mVbo, 4, sizeof(PlanetPageVertex), offsetof(PlanetPageVertex, material));
+		VertexArray::attribute(3, mVbo, 2, sizeof(PlanetPageVertex), offsetof(PlanetPageVertex, uv));
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibos[i]);
+		VertexArray::end();
+
+		mWaterArrays[i].begin();
+		VertexArray::attribute(0, mVbo, 3, sizeof(PlanetPageVertex), 0);
+		VertexArray::attribute(1, mVbo, 2, sizeof(PlanetPageVertex), offsetof(PlanetPageVertex, uv));
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibos[i]);
+		VertexArray::end();
+	}
 }
 
 
 static constexpr const float SIMPLIFIED_DISTANCE = 1000.0f;
 
 void PlanetPage::renderOpaque(float distanceToCamera, const GameState& gameState) {
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), 0);
-
 	bool isSimplified = distanceToCamera > SIMPLIFIED_DISTANCE || gameState.debugCode == DebugCode::SIMPLIFIED;
-	GLuint ibo = isSimplified? mIboSimplified : mIboDetailed;
 	const size_t indiceCount = isSimplified? mIndicesSimplified.size() : mIndicesDetailed.size();
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), (GLvoid*) offsetof(PlanetPageVertex, normal));
-	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), (GLvoid*) offsetof(PlanetPageVertex, material));
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), (GLvoid*) offsetof(PlanetPageVertex, uv));
-
+	mOpaqueArrays[isSimplified? 1 : 0].bind();
 	glDrawElements(GL_TRIANGLES, static_cast<GLsizei> (indiceCount), GL_UNSIGNED_INT, 0);
+	RENDER_STATS_DRAW(GL_TRIANGLES, indiceCount, 1);
 }
 
 
 void PlanetPage::renderTranslucent(float distanceToCamera, const GameState& gameState) {
 	if (mHasWater) {
-		glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), 0);
-
 		bool isSimplified = distanceToCamera > SIMPLIFIED_DISTANCE || gameState.debugCode == DebugCode::SIMPLIFIED;
-		GLuint ibo = isSimplified? mIboSimplified : mIboDetailed;
 		const size_t indiceCount = isSimplified? mIndicesSimplified.size() : mIndicesDetailed.size();
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PlanetPageVertex), (GLvoid*) offsetof(PlanetPageVertex, uv));
-
+		mWaterArrays[isSimplified? 1 : 0].bind();
 		glDrawElements(GL_TRIANGLES, static_cast<GLsizei> (indiceCount), GL_UNSIGNED_INT, 0);
+		RENDER_STATS_DRAW(GL_TRIANGLES, indiceCount, 1);
 	}
 }
 
@@ -384,6 +413,11 @@ bool PlanetPage::isVisible(const ICamera* camera, const btVector3& innerPoint) c
 }
 
 
+bool PlanetPage::isShadowCaster(const IShadowMap* shadowMap) const {
+	return shadowMap->isCaster(mVertices[mCenterIndex].position, mBoundingRadius);
+}
+
+
 bool PlanetPage::isCloseTo(const btVector3& point) const {
 	float dotPointToCenter = point.normalized().dot(mCenterDirection1);
 	return dotPointToCenter > mDotToCenterLimit;
@@ -438,6 +472,7 @@ void PlanetPage::editVertices(const std::string& command, float value, const btV
 		}
 		if (isModified) {
 			calculateNormals(true);
+			updateBoundingRadius();
 		}
 	} else if (command == "mat0" || command == "mat1" || command == "mat2" || command == "mat3") {
 		int index = command == "mat0"? 0 : command == "mat1"? 1 : command == "mat2"? 2 : 3;
@@ -452,9 +487,10 @@ void PlanetPage::editVertices(const std::string& command, float value, const btV
 		}
 	}
 	if (isModified) {
-		glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 		glBufferData(GL_ARRAY_BUFFER, mVerticeCount * sizeof(PlanetPageVertex), &mVertices[0].position, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		RENDER_STATS_UPLOAD(mVerticeCount * sizeof(PlanetPageVertex));
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
 
@@ -475,9 +511,10 @@ void PlanetPage::autoPaintVertices(const std::string& param, const btVector3& po
 		}
 	}
 	if (isModified) {
-		glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 		glBufferData(GL_ARRAY_BUFFER, mVerticeCount * sizeof(PlanetPageVertex), &mVertices[0].position, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		RENDER_STATS_UPLOAD(mVerticeCount * sizeof(PlanetPageVertex));
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
 
@@ -521,9 +558,10 @@ void PlanetPage::fixBorderNormals(const std::function<void(const btVector3&,btVe
 				v.normal = normal.normalized();
 			}
 		}
-		glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 		glBufferData(GL_ARRAY_BUFFER, mVerticeCount * sizeof(PlanetPageVertex), &mVertices[0].position, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		RENDER_STATS_UPLOAD(mVerticeCount * sizeof(PlanetPageVertex));
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
 
@@ -614,6 +652,7 @@ std::unique_ptr<PlanetPage> PlanetPage::create(ISerializer *serializer, std::wea
 
 	o->calculateNormals(false);
 	o->setFieldOfView();
+	o->updateBoundingRadius();
 
 	return o;
 }
@@ -11,6 +11,7 @@
 #include "IPlanetExternalObject.h"
 #include "../../util/math/FieldOfView.h"
 #include "../../util/PhysicsBody.h"
+#include "../../util/VertexArray.h"
 
 
 class PlanetPage {
@@ -68,15 +69,19 @@ class PlanetPage {
 	unsigned long mCornerIndex[4];
 	btVector3 mCenterDirection1;
 	float mDotToCenterLimit;
+	float mBoundingRadius; // around the center vertex
 
 	std::unique_ptr<PhysicsBody> mPhysicsBody;
 
 	GLuint mVbo;
 	GLuint mIboDetailed;
 	GLuint mIboSimplified;
+	// [0] detailed, [1] simplified
+	VertexArray mOpaqueArrays[2]; // position, normal, material, uv
+	VertexArray mWaterArrays[2]; // position, uv
 
 	void setFieldOfView();
-	void calculateNormals(bool reset);
+	void updateBoundingRadius();
 	void setVertex(const std::string& plane, float radius, float d1, float d2, float face, PlanetPageVertex& vertex);
 	void buildDetailedMesh(const std::string& plane, float radius, float d1, float d2, float size, float face, unsigned int pageDivisions);
 	void buildSimplifiedMesh(const std::string& plane, unsigned int pageDivisions);
@@ -90,6 +95,7 @@ public:
 	static btVector3 getInnerPoint(const ICamera*, float planetRadius);
 	btVector3 getCorner(unsigned int index) const noexcept;
 	float getHeightAt(const btVector3& direction) const;
+	void calculateNormals(bool reset);
 	void getNormalAt(const btVector3& point, btVector3& normal) const;
 	float arcDistanceTo(const btVector3& point) const;
 	bool isCloseTo(const btVector3& point) const;
@@ -102,6 +108,7 @@ public:
 	void autoPaintVertices(const std::string& param, const btVector3& point3D, float brushSize);
 
 	bool isVisible(const ICamera* camera, const btVector3& innerPoint) const;
+	bool isShadowCaster(const IShadowMap* shadowMap) const;
 	bool hasWater() const noexcept;
 	void initPhysics(btDynamicsWorld* dynamicsWorld);
 	void renderOpaque(float distanceToCamera, const GameState& gameState);
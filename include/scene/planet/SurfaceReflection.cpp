@@ -2,14 +2,12 @@
 #include "../../util/Texture.h"
 #include "../../util/ShaderUtils.h"
 
+// cameraPosition and dotOriginToHorizon come from UniformBlock::SKY_CODE, declared before
 const char* SurfaceReflection::getVertexShaderCode() {
 	static const std::string gVertexShaderCode =
-		"uniform bool isRenderingReflection;"
-		"uniform float waterLevel;"
-		"uniform float distanceToHorizon;"
-		"uniform float dotOriginToHorizon;"
+		std::string(UniformBlock::REFLECTION_CODE)
 
-		+ std::string(ShaderUtils::ROTATION_MATRIX) +
+		+ ShaderUtils::ROTATION_MATRIX +
 
 		"vec3 planetSurfaceReflection(vec3 p) {"
 			"if (!isRenderingReflection)"
@@ -43,15 +41,20 @@ const std::string& SurfaceReflection::SERIALIZE_ID = "SurfaceReflection";
 
 //-----------------------------------------------------------------------------
 
-SurfaceReflection::SurfaceReflection(float planetRadius, float waterLevel, unsigned int textureWidth, unsigned int textureHeight):
+SurfaceReflection::SurfaceReflection(float planetRadius, float waterLevel, unsigned int textureWidth, unsigned int textureHeight, float resolutionScale):
 	mPlanetRadius(planetRadius),
-	mWaterLevel(waterLevel)
+	mWaterLevel(waterLevel),
+	mWidth(textureWidth),
+	mHeight(textureHeight),
+	mResolutionScale(resolutionScale),
+	mIsRendering(false),
+	mUpdateInterval(1),
+	mFramesSinceUpdate(0),
+	mIsValid(false),
+	mMaxDistance(3000.f),
+	mMinObjectRadius(1.f)
 {
-	mColorTexture = std::make_unique<Texture>(0, GL_RGB, GL_RGB, textureWidth, textureHeight, std::vector<Uint32>());
-	mColorTexture->mipmap()->repeat()->unbind();
-
-	mDepthTexture = std::make_unique<Texture>(1, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, textureWidth, textureHeight, std::vector<Uint32>());
-	mDepthTexture->mipmap()->repeat()->unbind();
+	createTextures();
 
 	mBuffer = std::make_unique<FrameBuffer>();
 	mBuffer->end();
@@ -63,8 +66,45 @@ SurfaceReflection::~SurfaceReflection() {
 }
 
 
-void SurfaceReflection::begin() {
+void SurfaceReflection::createTextures() {
+	const unsigned int width = std::max(1u, static_cast<unsigned int>(mWidth * mResolutionScale));
+	const unsigned int height = std::max(1u, static_cast<unsigned int>(mHeight * mResolutionScale));
+
+	mColorTexture = std::make_unique<Texture>(0, GL_RGB, GL_RGB, width, height, std::vector<Uint32>());
+	mColorTexture->mipmap()->repeat()->unbind();
+
+	mDepthTexture = std::make_unique<Texture>(1, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, width, height, std::vector<Uint32>());
+	mDepthTexture->mipmap()->repeat()->unbind();
+	mIsValid = false;
+}
+
+
+void SurfaceReflection::setResolutionScale(float scale) {
+	if (scale <= 0.f || scale > 1.f)
+		throw std::runtime_error("Invalid reflection scale: " + std::to_string(scale));
+
+	mResolutionScale = scale;
+	createTextures();
+}
+
+
+bool SurfaceReflection::needsUpdate() noexcept {
+	if (!mIsValid || ++mFramesSinceUpdate >= mUpdateInterval) {
+		mFramesSinceUpdate = 0;
+		return true;
+	}
+	return false;
+}
+
+
+void SurfaceReflection::invalidate() noexcept {
+	mIsValid = false;
+}
+
+
+void SurfaceReflection::begin(const ICamera* camera) {
 	mIsRendering = true;
+	mReflectionVP = Matrix4x4(camera->getProjectionMatrix()).multiplyRight(camera->getViewMatrix());
 	mBuffer->startColorAndDepth(mColorTexture.get(), mDepthTexture.get());
 }
 
@@ -73,26 +113,78 @@ void SurfaceReflection::end() {
 	mBuffer->end();
 	mColorTexture->linear(); // build image
 	mIsRendering = false;
+	mIsValid = true;
 }
 
-void SurfaceReflection::setVars(IShader *shader, const ICamera *camera) const {
+
+bool SurfaceReflection::isReflected(const btVector3& center, float radius, const ICamera* camera) const noexcept {
+	return radius >= mMinObjectRadius && camera->getPosition().distance(center) - radius <= mMaxDistance;
+}
+
+
+float SurfaceReflection::getDistanceToHorizon(const ICamera* camera) const {
 	float d = camera->getPosition().length();
-	shader->set("cameraPosition", camera->getPosition());
+	return (float) sqrt(d * d - mPlanetRadius * mPlanetRadius); // pitagoras
+}
+
+
+void SurfaceReflection::setVars(IShader *shader, const ICamera *camera) const {
+	if (!shader->hasUniformBlock(UniformBlock::SKY))
+		shader->set("cameraPosition", camera->getPosition());
+	if (shader->hasUniformBlock(UniformBlock::REFLECTION))
+		return;
 	shader->set("isRenderingReflection", mIsRendering);
 	shader->set("waterLevel", mWaterLevel);
-	shader->set("distanceToHorizon", (float) sqrt(d * d - mPlanetRadius * mPlanetRadius)); // pitagoras
+	shader->set("distanceToHorizon", getDistanceToHorizon(camera));
+}
+
+
+void SurfaceReflection::updateUniformBlock(const ICamera* camera) const {
+	UniformBlock::ReflectionData data;
+	data.isRenderingReflection = mIsRendering? 1 : 0;
+	data.waterLevel = mWaterLevel;
+	data.distanceToHorizon = getDistanceToHorizon(camera);
+	data.padding = 0.f;
+	UniformBlock::get(UniformBlock::REFLECTION).update(data);
 }
 
 void SurfaceReflection::setReflectionTexture(IShader *shader) const {
 	shader->set("reflectionTexture", mColorTexture.get());
+	shader->set("reflectionVP", mReflectionVP);
+}
+
+
+ISceneObject::CommandMap SurfaceReflection::getCommands() {
+	ISceneObject::CommandMap map;
+
+	map["reflectscale"] = [this](const std::string& param) {
+		try {
+			setResolutionScale((float) ::atof(param.c_str()));
+			Log::info("Reflection scale set to %.2f", mResolutionScale);
+		} catch (const std::runtime_error& e) {
+			Log::error("%s", e.what());
+		}
+	};
+
+	map["reflectrate"] = [this](const std::string& param) {
+		setUpdateInterval(static_cast<unsigned int>(::atoi(param.c_str())));
+		Log::info("Reflection updated every %u frames", mUpdateInterval);
+	};
+
+	map["reflectdistance"] = [this](const std::string& param) {
+		setMaxDistance((float) ::atof(param.c_str()));
+		Log::info("Reflection distance set to %.2f", mMaxDistance);
+	};
+
+	return map;
 }
 
 void SurfaceReflection::write(ISerializer *serializer) const {
 	serializer->writeBegin(serializeID(), getObjectId());
 	serializer->write(mPlanetRadius);
 	serializer->write(mWaterLevel);
-	serializer->write(mColorTexture->getWidth());
-	serializer->write(mColorTexture->getHeight());
+	serializer->write(mWidth);
+	serializer->write(mHeight);
 }
 
 std::pair<std::string,Factory> SurfaceReflection::factory() {
@@ -110,6 +202,7 @@ std::pair<std::string,Factory> SurfaceReflection::factory() {
 		IGameScene* gameScene = window->getGameScene().get();
 		gameScene->setSurfaceReflection(o);
 		gameScene->addSerializable(o);
+		gameScene->addCommands(o->getCommands());
 		return o;
 	};
 	return std::make_pair(SERIALIZE_ID, Factory(factory));
@@ -1,34 +1,67 @@
 #ifndef GAMEDEV3D_WATERREFLECTION_H
 #define GAMEDEV3D_WATERREFLECTION_H
 
+#include <algorithm>
 #include "../../app/Interfaces.h"
 #include "../../util/FrameBuffer.h"
 
 
+/**
+ * Reflection of the scene on the water. It can be rendered at a fraction of the window
+ * resolution and only every N frames: the water samples it with the camera matrices of
+ * the frame it was rendered in (reprojection). Small and far objects are not reflected.
+ */
+
 class SurfaceReflection: public ISurfaceReflection {
 
 	float mPlanetRadius;
 	float mWaterLevel;
+	unsigned int mWidth; // window resolution, the textures are scaled
+	unsigned int mHeight;
+	float mResolutionScale;
 	std::unique_ptr<ITexture> mColorTexture;
 	std::unique_ptr<ITexture> mDepthTexture;
 	std::unique_ptr<FrameBuffer> mBuffer;
 	bool mIsRendering;
 
+	unsigned int mUpdateInterval; // in frames
+	unsigned int mFramesSinceUpdate;
+	bool mIsValid;
+	Matrix4x4 mReflectionVP; // camera of the last update
+
+	float mMaxDistance;
+	float mMinObjectRadius;
+
+	void createTextures();
+	float getDistanceToHorizon(const ICamera* camera) const;
+
 public:
 	static const std::string& SERIALIZE_ID;
 
-	SurfaceReflection(float planetRadius, float waterLevel, unsigned int textureWidth, unsigned int textureHeight);
+	SurfaceReflection(float planetRadius, float waterLevel, unsigned int textureWidth, unsigned int textureHeight, float resolutionScale = 0.5f);
 	virtual ~SurfaceReflection();
 
 	virtual const ITexture* getColorTexture() const override;
 	virtual bool isRendering() const override;
 
-	virtual void begin() override;
+	virtual bool needsUpdate() noexcept override;
+	virtual void invalidate() noexcept override;
+	virtual void begin(const ICamera* camera) override;
 	virtual void end() override;
 
+	virtual float getMaxDistance() const noexcept override;
+	virtual bool isReflected(const btVector3& center, float radius, const ICamera* camera) const noexcept override;
+
 	virtual void setVars(IShader* shader, const ICamera* camera) const override;
+	virtual void updateUniformBlock(const ICamera* camera) const override;
 	virtual void setReflectionTexture(IShader* shader) const override;
 
+	void setResolutionScale(float scale);
+	void setUpdateInterval(unsigned int frames) noexcept;
+	void setMaxDistance(float distance) noexcept;
+	void setMinObjectRadius(float radius) noexcept;
+	ISceneObject::CommandMap getCommands();
+
 	static const char* getVertexShaderCode();
 
 	virtual void write(ISerializer *serializer) const override;
@@ -44,4 +77,16 @@ inline const ITexture* SurfaceReflection::getColorTexture() const
 inline bool SurfaceReflection::isRendering() const
 { return mIsRendering; }
 
+inline float SurfaceReflection::getMaxDistance() const noexcept
+{ return mMaxDistance; }
+
+inline void SurfaceReflection::setUpdateInterval(unsigned int frames) noexcept
+{ mUpdateInterval = std::max(frames, 1u); }
+
+inline void SurfaceReflection::setMaxDistance(float distance) noexcept
+{ mMaxDistance = distance; }
+
+inline void SurfaceReflection::setMinObjectRadius(float radius) noexcept
+{ mMinObjectRadius = radius; }
+
 #endif
@@ -10,8 +10,7 @@ static const char* vs[] = {
 	"attribute vec4 normal;"
 	"attribute vec2 uv;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"uniform vec3 lightPosition;"
 
@@ -105,8 +104,9 @@ void CityBlock::cleanup() {
 	if (!mVertices.empty()) {
 		mIndices.clear();
 		mVertices.clear();
-		glDeleteBuffers(1, &mVbo);
-		glDeleteBuffers(1, &mIbo);
+		GLState::get().deleteBuffers(1, &mVbo);
+		GLState::get().deleteBuffers(1, &mIbo);
+		mVertexArray.reset();
 	}
 }
 
@@ -215,13 +215,20 @@ void CityBlock::bind() {
 	glGenBuffers(1, &mVbo);
 	glGenBuffers(1, &mIbo);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(CityBlockVertex), &mVertices[0].position, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned int), &mIndices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	mVertexArray.begin();
+	VertexArray::attribute(0, mVbo, 3, sizeof(CityBlockVertex), 0);
+	VertexArray::attribute(1, mVbo, 3, sizeof(CityBlockVertex), offsetof(CityBlockVertex, normal));
+	VertexArray::attribute(2, mVbo, 2, sizeof(CityBlockVertex), offsetof(CityBlockVertex, uv));
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	VertexArray::end();
 }
 
 
@@ -270,27 +277,9 @@ void CityBlock::render(const ICamera* camera, const ISky* sky, const IShadowMap*
 	pShader->set("material0", mTexture.get());
 	pShader->set("material0_scale", mTexture->getScaleFactor());
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CityBlockVertex), 0);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CityBlockVertex), (GLvoid*) offsetof(CityBlockVertex, normal));
-
-	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(CityBlockVertex), (GLvoid*) offsetof(CityBlockVertex, uv));
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	mVertexArray.bind();
 	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mIndices.size()), GL_UNSIGNED_INT, 0);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	VertexArray::unbind();
 
 	IShader::stop();
 }
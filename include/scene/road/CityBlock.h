@@ -5,6 +5,7 @@
 #include <vector>
 #include "../planet/Planet.h"
 #include "../../util/PhysicsBody.h"
+#include "../../util/VertexArray.h"
 
 
 class CityBlock: public ISerializable {
@@ -38,6 +39,7 @@ class CityBlock: public ISerializable {
 
 	GLuint mVbo;
 	GLuint mIbo;
+	VertexArray mVertexArray;
 	std::unique_ptr<IShader> mShader;
 	std::shared_ptr<ITexture> mTexture;
 
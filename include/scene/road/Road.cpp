@@ -9,8 +9,7 @@ static constexpr const char* vs[] = {
 	"attribute vec2 uv;"
 	"attribute float border;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"varying vec3 worldV;"
 	"varying vec2 _uv;"
@@ -92,8 +91,9 @@ void Road::cleanup() {
 	if (!mVertices.empty()) {
 		mIndices.clear();
 		mVertices.clear();
-		glDeleteBuffers(1, &mVbo);
-		glDeleteBuffers(1, &mIbo);
+		GLState::get().deleteBuffers(1, &mVbo);
+		GLState::get().deleteBuffers(1, &mIbo);
+		mVertexArray.reset();
 	}
 }
 
@@ -127,13 +127,20 @@ void Road::bind() {
 	glGenBuffers(1, &mVbo);
 	glGenBuffers(1, &mIbo);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(RoadVertex), &mVertices[0].position, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned int), &mIndices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	mVertexArray.begin();
+	VertexArray::attribute(0, mVbo, 3, sizeof(RoadVertex), 0);
+	VertexArray::attribute(1, mVbo, 2, sizeof(RoadVertex), offsetof(RoadVertex, uv));
+	VertexArray::attribute(2, mVbo, 1, sizeof(RoadVertex), offsetof(RoadVertex, border));
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	VertexArray::end();
 }
 
 
@@ -154,27 +161,9 @@ void Road::renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap
 		pShader->set("material0", mTexture.get());
 		pShader->set("material0_scale", mTexture->getScaleFactor());
 
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), (GLvoid*) offsetof(RoadVertex, uv));
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
-		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), (GLvoid*) offsetof(RoadVertex, border));
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+		mVertexArray.bind();
 		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mIndices.size()), GL_UNSIGNED_INT, 0);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		VertexArray::unbind();
 
 		IShader::stop();
 	}
@@ -973,7 +962,7 @@ std::pair<std::string, Factory> Road::factory() {
 		unsigned long oId;
 		serializer->readBegin(name, oId);
 		std::shared_ptr<ISerializable> tex = textureFactory.create(oId, serializer, window);
-		o->mTexture = std::dynamic_pointer_cast<Texture>(tex);
+		o->mTexture = std::dynamic_pointer_cast<ITexture>(tex);
 		o->mTexture->mipmap()->repeat();
 
 		serializer->readBegin(name, oId);
@@ -6,6 +6,7 @@
 #include "../SceneObject.h"
 #include "../planet/Planet.h"
 #include "../../util/Pin.h"
+#include "../../util/VertexArray.h"
 #include "CityBlock.h"
 
 
@@ -83,6 +84,7 @@ class Road: public SceneObject {
 
 	GLuint mVbo;
 	GLuint mIbo;
+	VertexArray mVertexArray;
 	std::unique_ptr<IShader> mShader;
 	std::shared_ptr<ITexture> mTexture;
 
@@ -105,6 +107,7 @@ public:
 	virtual ISceneObject::CommandMap getCommands() override;
 
 	virtual void initPhysics(btTransform transform) override;
+	virtual bool castsShadow() const override { return false; }
 	virtual void renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState &gameState) override;
 
 	virtual void write(ISerializer *serializer) const override;
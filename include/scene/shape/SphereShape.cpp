@@ -21,13 +21,12 @@ void SphereShape::updateSimulation() {
 
 void SphereShape::renderOpaque(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState)
 {
-	btVector3 center = mPhysicsBody->getRigidBody()->getCenterOfMassPosition();
-	if (!camera->isVisible(center))
-		return;
-
 	static Matrix4x4 m4x4;
 	m4x4 = getMatrix4x4();
 
+	if (!camera->isVisible(m4x4.getOrigin()))
+		return;
+
 	if (gameState.debugCode == DebugCode::COLLISION_SHAPE)
 		mShapeRenderer->render(camera, sky, mPhysicsBody->getCollisionShape(), m4x4, true);
 	else
@@ -35,6 +34,19 @@ void SphereShape::renderOpaque(const ICamera* camera, const ISky* sky, const ISh
 }
 
 
+void SphereShape::submitOpaque(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState)
+{
+	if (gameState.debugCode == DebugCode::COLLISION_SHAPE) {
+		SceneObject::submitOpaque(queue, camera, sky, shadowMap, surfaceReflection, gameState);
+		return;
+	}
+
+	const Matrix4x4& m4x4 = getMatrix4x4();
+	if (camera->isVisible(m4x4.getOrigin()))
+		mSphereModel->submit(queue, camera, sky, shadowMap, m4x4, true);
+}
+
+
 void SphereShape::write(ISerializer *serializer) const {
 	serializer->writeBegin(serializeID(), getObjectId());
 	serializer->write(mMass);
@@ -38,6 +38,7 @@ public:
 	virtual void initPhysics(btTransform transform) override;
 	virtual void updateSimulation() override;
 	virtual void renderOpaque(const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
+	virtual void submitOpaque(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 
 	virtual void write(ISerializer *serializer) const override;
 	virtual const std::string& serializeID() const noexcept override;
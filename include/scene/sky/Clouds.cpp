@@ -1,18 +1,20 @@
 #include "Clouds.h"
 #include "../../util/Shader.h"
-#include "../../util/Texture.h"
+#include "../../util/TextureCache.h"
 #include "../planet/SurfaceReflection.h"
 #include "SkyShader.h"
 #include "../../util/IoUtils.h"
+#include "../../util/GpuProfiler.h"
+#include "../../util/RenderStats.h"
 
 static const char* vs[] = {
 	"attribute vec4 vertex;"
 	"attribute vec4 position;"
 	"attribute vec3 dimension;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
-	"uniform vec3 cameraPosition;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 
 	"varying vec3 worldV;"
 	"varying vec3 centerV;"
@@ -54,8 +56,10 @@ static constexpr const char* fs[] = {
 	"varying vec4 uv;"
 
 	// PlanetSurfaceReflection
-	"uniform bool isRenderingReflection;"
-
+	,UniformBlock::REFLECTION_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
+	" "
 	,SkyShader::SHARED_FRAGMENT_CODE,
 
 	"vec4 color() {"
@@ -115,14 +119,10 @@ const std::string& Clouds::SERIALIZE_ID = "Clouds";
 Clouds::Clouds(const std::pair<float,float>& altitudeRange):
 	mAltitudeRange(altitudeRange)
 {
-	mTexture[0] = std::make_unique<Texture>(1, IoUtils::resource("/texture/cloudA.png"));
-	mTexture[1] = std::make_unique<Texture>(2, IoUtils::resource("/texture/cloudB.png"));
-	mTexture[2] = std::make_unique<Texture>(3, IoUtils::resource("/texture/cloudC.png"));
-	mTexture[3] = std::make_unique<Texture>(4, IoUtils::resource("/texture/cloudD.png"));
-	mTexture[0]->mipmap()->repeat();
-	mTexture[1]->mipmap()->repeat();
-	mTexture[2]->mipmap()->repeat();
-	mTexture[3]->mipmap()->repeat();
+	mTexture[0] = TextureCache::get().load(1, IoUtils::resource("/texture/cloudA.png"));
+	mTexture[1] = TextureCache::get().load(2, IoUtils::resource("/texture/cloudB.png"));
+	mTexture[2] = TextureCache::get().load(3, IoUtils::resource("/texture/cloudC.png"));
+	mTexture[3] = TextureCache::get().load(4, IoUtils::resource("/texture/cloudD.png"));
 
 	mShader = std::make_unique<Shader>(vs, fs);
 	mShader->bindAttribute(0, "vertex");
@@ -135,8 +135,8 @@ Clouds::Clouds(const std::pair<float,float>& altitudeRange):
 Clouds::~Clouds() {
 	Log::debug("Deleting clouds");
 	mParticles.clear();
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mPbo);
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mPbo);
 }
 
 
@@ -144,13 +144,20 @@ void Clouds::bind() {
 	// The VBO containing the 4 vertices of the particles.
 	// Thanks to instancing, they will be shared by all particles.
 	glGenBuffers(1, &mVbo);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(gVertexBuffer), &gVertexBuffer[0], GL_STATIC_DRAW);
 
 	// The VBO containing the positions of the particles
 	glGenBuffers(1, &mPbo);
-	glBindBuffer(GL_ARRAY_BUFFER, mPbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mPbo);
 	glBufferData(GL_ARRAY_BUFFER, mParticles.size() * sizeof(Particle), &mParticles[0].position, GL_STREAM_DRAW);
+
+	mVertexArray.begin();
+	VertexArray::attribute(0, mVbo, 3, 0, 0);
+	// positions and dimensions: one per quad (its center)
+	VertexArray::attribute(1, mPbo, 3, sizeof(Particle), 0, 1);
+	VertexArray::attribute(2, mPbo, 3, sizeof(Particle), offsetof(Particle, dimension), 1);
+	VertexArray::end();
 }
 
 
@@ -202,6 +209,10 @@ void Clouds::renderTranslucent(const ICamera *camera, const ISky *sky, const ISh
 	if (shadowMap->isRendering())
 		return;
 
+	PROFILE_SCOPE("clouds");
+	GPU_PROFILE_SCOPE("clouds");
+	RENDER_STATS_OBJECT("clouds");
+
 	// Sort particles so that we can render them back to front
 	// Without this step clouds don't look so realistic when we fly through them
 	for (Particle& particle : mParticles) {
@@ -220,33 +231,16 @@ void Clouds::renderTranslucent(const ICamera *camera, const ISky *sky, const ISh
 	mShader->set("material2", mTexture[2].get());
 	mShader->set("material3", mTexture[3].get());
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, mPbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mPbo);
 	glBufferData(GL_ARRAY_BUFFER, mParticles.size() * sizeof(Particle), &mParticles[0].position, GL_STREAM_DRAW);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+	RENDER_STATS_UPLOAD(mParticles.size() * sizeof(Particle));
 
-	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ARRAY_BUFFER, mPbo);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*) offsetof(Particle, dimension));
-
-	glVertexAttribDivisor(0, 0); // particles vertices : always reuse the same 4 vertices -> 0
-	glVertexAttribDivisor(1, 1); // positions : one per quad (its center)                 -> 1
-	glVertexAttribDivisor(2, 1); // dimensions : one per quad (its center)                -> 1
-
+	mVertexArray.bind();
 	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, mParticles.size());
+	RENDER_STATS_DRAW(GL_TRIANGLE_STRIP, 4, mParticles.size());
+	VertexArray::unbind();
 
-	glVertexAttribDivisor(1, 0); // disable
-	glVertexAttribDivisor(2, 0); // disable
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	IShader::stop();
 }
 
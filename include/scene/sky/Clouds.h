@@ -2,6 +2,7 @@
 #define GAMEDEV3D_CLOUDS_H
 
 #include "../SceneObject.h"
+#include "../../util/VertexArray.h"
 
 
 class Clouds: public SceneObject {
@@ -44,6 +45,7 @@ class Clouds: public SceneObject {
 	std::unique_ptr<IShader> mShader;
 	GLuint mVbo; // vertex buffer object
 	GLuint mPbo; // position buffer object
+	VertexArray mVertexArray;
 
 	void addCloud(float, const btVector3&, int, float, float);
 public:
@@ -54,6 +56,7 @@ public:
 
 	void bind();
 	virtual void createClouds(float, float, float, unsigned int);
+	virtual bool castsShadow() const override { return false; }
 	virtual void renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState &gameState) override;
 	virtual void renderTranslucent(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 
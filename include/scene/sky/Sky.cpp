@@ -7,8 +7,7 @@
 static constexpr const char* vs[] = {
 	"attribute vec4 vertex;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 	"uniform vec3 cameraUp;"
 	"uniform vec3 cameraRight;"
 	"uniform vec3 centerPoint;"
@@ -30,10 +29,14 @@ static constexpr const char* fs[] = {
 	"varying vec3 worldV;"
 	"varying vec4 projectedV;"
 
+	,UniformBlock::SKY_CODE,
+	" "
 	,SkyShader::SHARED_FRAGMENT_CODE,
 
 	// PlanetSurfaceReflection
-	"uniform bool isRenderingReflection;"
+	" "
+	,UniformBlock::REFLECTION_CODE,
+	" "
 
 	,ShaderUtils::IN_FRUSTUM,
 
@@ -113,25 +116,30 @@ Sky::Sky(float planetRadius, float waterLevel, const btVector3& sunPosition):
 
 
 Sky::~Sky() {
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mIbo);
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mIbo);
 }
 
 
 void Sky::bind() {
 	glGenBuffers(1, &mVbo);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(btVector3), &gVertexBuffer[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
 	glGenBuffers(1, &mIbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(unsigned int), &gIndices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	mVertexArray.begin();
+	VertexArray::attribute(0, mVbo, 3, sizeof(btVector3), 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	VertexArray::end();
 }
 
 
-void Sky::setVars(IShader* shader, const ICamera* camera) const {
+UniformBlock::SkyData Sky::getBlockData(const ICamera* camera) const {
 	// Calculate the angle between vectors vCameraToOrigin and vCameraToHorizon
 	// Since we don't have a horizon point, the vCameraToHorizon vector is unknown.
 	// But we know this is a rectangle triangle and we also have two distances
@@ -159,17 +167,45 @@ void Sky::setVars(IShader* shader, const ICamera* camera) const {
 	const btVector3& vCameraToSun1 = (mSunPosition - camera->getPosition()).normalized();
 	float dotOriginToSun = vCameraToOrigin1.dot(vCameraToSun1);
 
+	const btVector3& cameraPosition = camera->getPosition();
+	UniformBlock::SkyData data;
+	data.cameraPosition[0] = cameraPosition.x();
+	data.cameraPosition[1] = cameraPosition.y();
+	data.cameraPosition[2] = cameraPosition.z();
+	data.planetRadius = mPlanetRadius;
+	data.sunPosition[0] = mSunPosition.x();
+	data.sunPosition[1] = mSunPosition.y();
+	data.sunPosition[2] = mSunPosition.z();
+	data.dotOriginToSun = dotOriginToSun;
+	data.dotOriginToHorizon = dotOriginToHorizon;
+	data.dotOriginToWaterLevel = dotOriginToWaterLevel;
+	data.ambientLight = mAmbient;
+	data.diffuseLight = mDiffuse;
+	return data;
+}
+
+
+void Sky::setVars(IShader* shader, const ICamera* camera) const {
+	if (shader->hasUniformBlock(UniformBlock::SKY))
+		return;
+
+	const UniformBlock::SkyData& data = getBlockData(camera);
 	shader->set("cameraPosition", camera->getPosition());
 	shader->set("sunPosition", mSunPosition);
 	shader->set("planetRadius", mPlanetRadius);
-	shader->set("dotOriginToSun", dotOriginToSun);
-	shader->set("dotOriginToHorizon", dotOriginToHorizon);
-	shader->set("dotOriginToWaterLevel", dotOriginToWaterLevel);
+	shader->set("dotOriginToSun", data.dotOriginToSun);
+	shader->set("dotOriginToHorizon", data.dotOriginToHorizon);
+	shader->set("dotOriginToWaterLevel", data.dotOriginToWaterLevel);
 	shader->set("ambientLight", mAmbient);
 	shader->set("diffuseLight", mDiffuse);
 }
 
 
+void Sky::updateUniformBlock(const ICamera* camera) const {
+	UniformBlock::get(UniformBlock::SKY).update(getBlockData(camera));
+}
+
+
 void Sky::renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState &gameState) {
 	if (shadowMap->isRendering())
 		return;
@@ -184,16 +220,9 @@ void Sky::renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap
 	mShader->set("cameraRight", camera->getRight());
 	mShader->set("centerPoint", camera->getPosition() + 25000.0 * camera->getDirectionUnit());
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	mVertexArray.bind();
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	VertexArray::unbind();
 
 	IShader::stop();
 }
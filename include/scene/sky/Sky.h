@@ -2,6 +2,7 @@
 #define GAMEDEV3D_SKY_H
 
 #include "../SceneObject.h"
+#include "../../util/VertexArray.h"
 
 
 class Sky: public ISky, public SceneObject {
@@ -20,8 +21,10 @@ class Sky: public ISky, public SceneObject {
 	std::unique_ptr<IShader> mShader;
 	GLuint mIbo;
 	GLuint mVbo;
+	VertexArray mVertexArray;
 
 	void bind();
+	UniformBlock::SkyData getBlockData(const ICamera* camera) const;
 public:
 	static const std::string& SERIALIZE_ID;
 
@@ -41,9 +44,11 @@ public:
 	virtual const btVector3& getSunPosition() const noexcept override;
 
 	virtual void setVars(IShader* shader, const ICamera* camera) const override;
+	virtual void updateUniformBlock(const ICamera* camera) const override;
 
 	virtual void debug() const override;
 
+	virtual bool castsShadow() const override { return false; }
 	virtual void renderOpaque(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const ISurfaceReflection* surfaceReflection, const GameState &gameState) override;
 
 	virtual void write(ISerializer *serializer) const override;
@@ -3,14 +3,8 @@
 
 class SkyShader {
 public:
+	// the uniforms are declared by UniformBlock::SKY_CODE, it must come first
 	static constexpr const char* SHARED_FRAGMENT_CODE =
-		"uniform vec3 cameraPosition;"
-		"uniform vec3 sunPosition;"
-		"uniform float planetRadius;"
-		"uniform float dotOriginToSun;"
-		"uniform float dotOriginToHorizon;"
-		"uniform float dotOriginToWaterLevel;"
-
 		"const float hazeDotLimit = 0.25;" // ~15 degrees (cosine)
 		"const float dayLimit = 0.15;" // degrees with the horizon (cosine)
 		"const float sunSize = 0.999;" // dot(vCameraToSun, vCameraToPoint)
@@ -131,9 +125,6 @@ public:
 			"return mix(color, c, factor);"
 		"}"
 
-		"uniform float ambientLight;"
-		"uniform float diffuseLight;"
-
 		"vec4 sky_lighting(vec4 material, vec3 eyeV, vec3 eyeN, vec3 eyeL, float shadow) {"
 			"vec3 n = normalize(eyeN);"
 			"vec3 s = normalize(eyeL - eyeV);"
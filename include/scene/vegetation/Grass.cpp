@@ -3,8 +3,9 @@
 #include "../../util/IoUtils.h"
 #include "../../util/ShaderNoise.h"
 #include "../../util/ShadowMap.h"
-#include "../../util/Texture.h"
+#include "../../util/TextureCache.h"
 #include "../../util/ShaderUtils.h"
+#include "../../util/GpuProfiler.h"
 
 
 static constexpr const char* vs[] = {
@@ -13,9 +14,9 @@ static constexpr const char* vs[] = {
 	"attribute vec3 position;"
 	"attribute float rotation;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
-	"uniform vec3 cameraPosition;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 
 	"varying vec3 worldV;"
 	"varying vec2 _uv;"
@@ -103,8 +104,7 @@ Grass::Grass(std::weak_ptr<Planet> planet, const std::string& filename):
 	}
 
 	auto texturePath = IoUtils::resource("/model/vegetation/" + mModel->getMesh(0).pMaterial->colorMapFilename);
-	mTexture = std::make_unique<Texture>(1, texturePath);
-	mTexture->mipmap()->bind();
+	mTexture = TextureCache::get().load(1, texturePath, TextureCache::MIPMAP);
 
 	mPin = std::make_unique<Pin>();
 
@@ -118,26 +118,39 @@ Grass::Grass(std::weak_ptr<Planet> planet, const std::string& filename):
 	// The VBO containing the shared vertices.
 	// Thanks to instancing, they will be shared by all instances.
 	glGenBuffers(1, &mVbo);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, mModel->getNumberOfVertices() * mModel->getVertexSize(), &mModel->getVertexBuffer()->position[0], GL_STATIC_DRAW);
 
 	glGenBuffers(1, &mIboSimple);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboSimple);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboSimple);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * mModel->getMesh(1).triangleCount * mModel->getIndexSize(), mModel->getIndexBuffer() + mModel->getMesh(1).startIndex, GL_STATIC_DRAW);
 
 	glGenBuffers(1, &mIboDetailed);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboDetailed);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboDetailed);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * mModel->getMesh(0).triangleCount * mModel->getIndexSize(), mModel->getIndexBuffer() + mModel->getMesh(0).startIndex, GL_STATIC_DRAW);
 
 	glGenBuffers(1, &mPboTemp);
+	recordVertexArray(mDetailedArray, mIboDetailed, mPboTemp);
+}
+
+
+void Grass::recordVertexArray(VertexArray& vertexArray, GLuint ibo, GLuint pbo) const {
+	vertexArray.begin();
+	// shared vertices and uv, then the position and rotation of each instance
+	VertexArray::attribute(0, mVbo, 3, mModel->getVertexSize(), 0);
+	VertexArray::attribute(1, mVbo, 2, mModel->getVertexSize(), offsetof(ModelOBJ::Vertex, texCoord));
+	VertexArray::attribute(2, pbo, 3, sizeof(GrassData), 0, 1);
+	VertexArray::attribute(3, pbo, 1, sizeof(GrassData), offsetof(GrassData, rotation), 1);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	VertexArray::end();
 }
 
 Grass::~Grass() {
 	Log::debug("Deleting Grass");
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mIboSimple);
-	glDeleteBuffers(1, &mIboDetailed);
-	glDeleteBuffers(1, &mPboTemp);
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mIboSimple);
+	GLState::get().deleteBuffers(1, &mIboDetailed);
+	GLState::get().deleteBuffers(1, &mPboTemp);
 }
 
 
@@ -265,40 +278,46 @@ void Grass::renderTranslucent(const std::unordered_map<unsigned int,float>& page
 		closePoints.clear();
 
 		const btVector3& cameraPosition = camera->getPosition();
-		for (auto& pIt : pageIds) {
-			if (pIt.second > 1000.0f)
-				continue;
-			auto it = mPagePoints.find(pIt.first);
-			if (it != mPagePoints.end()) {
-				visiblePageData.push_back(it->second.get());
-
-				for (auto& v : it->second->points) {
-					float d = cameraPosition.distance(v.position);
-					// check minimum distance to camera
-					if (d <= 100.0f) {
-						// If distance is too close or if point is visible to the camera,
-						// then render it with details.
-						if (d <= 30.0f || camera->isVisible(v.position))
-							closePoints.push_back(v);
+		{
+			PROFILE_SCOPE("grass collection");
+			for (auto& pIt : pageIds) {
+				if (pIt.second > 1000.0f)
+					continue;
+				auto it = mPagePoints.find(pIt.first);
+				if (it != mPagePoints.end()) {
+					visiblePageData.push_back(it->second.get());
+
+					for (auto& v : it->second->points) {
+						float d = cameraPosition.distance(v.position);
+						// check minimum distance to camera
+						if (d <= 100.0f) {
+							// If distance is too close or if point is visible to the camera,
+							// then render it with details.
+							if (d <= 30.0f || camera->isVisible(v.position))
+								closePoints.push_back(v);
+						}
 					}
 				}
 			}
 		}
 
 		if (visiblePageData.size() > 0) {
-			glDisable(GL_CULL_FACE);
-			glDepthMask(GL_TRUE); // Make depth buffer read write
+			GLState::get().disable(GL_CULL_FACE);
+			GLState::get().depthMask(GL_TRUE); // Make depth buffer read write
 
 			render(visiblePageData, closePoints, camera, sky, shadowMap);
 
-			glDepthMask(GL_FALSE); // Make depth buffer read only
-			glEnable(GL_CULL_FACE);
+			GLState::get().depthMask(GL_FALSE); // Make depth buffer read only
+			GLState::get().enable(GL_CULL_FACE);
 		}
 	}
 }
 
 
 void Grass::render(const std::vector<GrassPageData*>& visiblePageData, const std::vector<GrassData>& closePoints, const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap) {
+	PROFILE_SCOPE("grass");
+	GPU_PROFILE_SCOPE("grass");
+	RENDER_STATS_OBJECT("grass");
 	IShader* pShader = mShader.get();
 
 	pShader->run();
@@ -309,54 +328,32 @@ void Grass::render(const std::vector<GrassPageData*>& visiblePageData, const std
 	shadowMap->setVars(pShader);
 	pShader->set("texture", mTexture.get());
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
-
-	glVertexAttribDivisor(0, 0); // vertices : always reuse the same vertices	-> 0
-	glVertexAttribDivisor(1, 0); // uv : always reuse the same uv 				-> 0
-	glVertexAttribDivisor(2, 1); // positions : one per quad (its center)		-> 1
-	glVertexAttribDivisor(3, 1); // rotation : one per quad 					-> 1
-
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), 0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), (GLvoid*) offsetof(ModelOBJ::Vertex, texCoord));
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboSimple);
-
 	const unsigned int simple_IndexCount = 3 * mModel->getMesh(1).triangleCount;
 
 	// Render simplified mesh in all visible points
 	for (auto& data : visiblePageData) {
-		glBindBuffer(GL_ARRAY_BUFFER, data->pbo);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GrassData), 0);
-		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GrassData), (GLvoid*) offsetof(GrassData, rotation));
+		if (!data->vertexArray.isCreated())
+			recordVertexArray(data->vertexArray, mIboSimple, data->pbo);
+		data->vertexArray.bind();
 		glDrawElementsInstanced(GL_TRIANGLES, simple_IndexCount, GL_UNSIGNED_INT, 0, data->points.size());
+		RENDER_STATS_DRAW(GL_TRIANGLES, simple_IndexCount, data->points.size());
 	}
 
 	// Render second mesh for points close to the camera
 	if (closePoints.size() > 0) {
 		const unsigned int detailed_IndexCount = 3 * mModel->getMesh(0).triangleCount;
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIboDetailed);
-
-		glBindBuffer(GL_ARRAY_BUFFER, mPboTemp);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, mPboTemp);
 		glBufferData(GL_ARRAY_BUFFER, closePoints.size() * sizeof(GrassData), &closePoints[0].position, GL_STREAM_DRAW);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GrassData), 0);
-		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GrassData), (GLvoid*) offsetof(GrassData, rotation));
+		RENDER_STATS_UPLOAD(closePoints.size() * sizeof(GrassData));
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
+		mDetailedArray.bind();
 		glDrawElementsInstanced(GL_TRIANGLES, detailed_IndexCount, GL_UNSIGNED_INT, 0, closePoints.size());
+		RENDER_STATS_DRAW(GL_TRIANGLES, detailed_IndexCount, closePoints.size());
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glVertexAttribDivisor(2, 0); // disable
-	glVertexAttribDivisor(3, 0); // disable
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
+	VertexArray::unbind();
 
 	IShader::stop();
 }
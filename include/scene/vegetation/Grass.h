@@ -4,7 +4,9 @@
 #include "../planet/IPlanetExternalObject.h"
 #include "../planet/Planet.h"
 #include "../../util/Pin.h"
+#include "../../util/RenderStats.h"
 #include "../../util/ModelOBJ.h"
+#include "../../util/VertexArray.h"
 
 
 class Grass: public IPlanetExternalObject {
@@ -13,6 +15,7 @@ class Grass: public IPlanetExternalObject {
 	std::weak_ptr<Planet> mPlanet;
 	bool mGrassMode;
 	GLuint mVbo, mIboSimple, mIboDetailed, mPboTemp;
+	VertexArray mDetailedArray; // detailed mesh, instances in mPboTemp
 
 	std::unique_ptr<Pin> mPin;
 	std::unique_ptr<IShader> mShader;
@@ -43,17 +46,19 @@ class Grass: public IPlanetExternalObject {
 		std::vector<GrassData> points;
 		btVector3 middlePoint;
 		GLuint pbo {0}; // position buffer object
+		VertexArray vertexArray; // simplified mesh, instances in pbo. Recorded on the first draw
 
 		~GrassPageData() {
-			glDeleteBuffers(1, &pbo);
+			GLState::get().deleteBuffers(1, &pbo);
 		}
 
 		void bind() {
 			if (pbo == 0) {
 				glGenBuffers(1, &pbo);
 			}
-			glBindBuffer(GL_ARRAY_BUFFER, pbo);
+			GLState::get().bindBuffer(GL_ARRAY_BUFFER, pbo);
 			glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(GrassData), &points[0].position, GL_STREAM_DRAW);
+			RENDER_STATS_UPLOAD(points.size() * sizeof(GrassData));
 		}
 
 		void update() {
@@ -91,6 +96,7 @@ class Grass: public IPlanetExternalObject {
 
 	void addGrass(const btVector3& point);
 	void removeGrass(const btVector3& point);
+	void recordVertexArray(VertexArray& vertexArray, GLuint ibo, GLuint pbo) const;
 	void render(const std::vector<GrassPageData*>& visiblePageData, const std::vector<GrassData>& closePoints, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap);
 public:
 	static const std::string& SERIALIZE_ID;
@@ -102,6 +108,7 @@ public:
 
 	virtual void renderOpaque(const std::unordered_map<unsigned int,float>& pageIds, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const GameState& gameState) override;
 	virtual void renderTranslucent(const std::unordered_map<unsigned int,float>& pageIds, const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const GameState &gameState) override;
+	virtual bool isReflected() const override { return false; }
 
 	virtual void write(ISerializer *serializer) const override;
 	virtual const std::string& serializeID() const noexcept override;
@@ -1,19 +1,20 @@
 #include "Plant.h"
-#include "../../util/Texture.h"
+#include "../../util/TextureCache.h"
 #include "../sky/SkyShader.h"
 #include "../../util/ShadowMap.h"
 #include "../../util/ShaderNoise.h"
 #include "../../util/ShaderUtils.h"
 #include "../../util/IoUtils.h"
+#include "../../util/Profiler.h"
 
 static constexpr const char* vs[] = {
 	"attribute vec4 vertex;"
 	"attribute vec3 position;"
 	"attribute vec3 info;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
-	"uniform vec3 cameraPosition;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 
 	"varying vec3 worldV;"
 	"varying vec3 uv;"
@@ -71,6 +72,8 @@ static constexpr const char* fs[] = {
 
 	,ShadowMap::getFragmentShaderCode(),
 	""
+	,UniformBlock::SKY_CODE,
+	""
 	,SkyShader::SHARED_FRAGMENT_CODE,
 
 	"float occlusion() {"
@@ -173,17 +176,13 @@ Plant::Plant(std::weak_ptr<Planet> planet):
 {
 	mPin = std::make_unique<Pin>();
 
-	mTextures[0] = std::make_unique<Texture>(1, IoUtils::resource("/texture/plant/plant1.png"));
-	mTextures[0]->mipmap()->bind();
+	mTextures[0] = TextureCache::get().load(1, IoUtils::resource("/texture/plant/plant1.png"), TextureCache::MIPMAP);
 
-	mTextures[1] = std::make_unique<Texture>(2, IoUtils::resource("/texture/plant/plant2.png"));
-	mTextures[1]->mipmap()->bind();
+	mTextures[1] = TextureCache::get().load(2, IoUtils::resource("/texture/plant/plant2.png"), TextureCache::MIPMAP);
 
-	mTextures[2] = std::make_unique<Texture>(3, IoUtils::resource("/texture/plant/plant3.png"));
-	mTextures[2]->mipmap()->bind();
+	mTextures[2] = TextureCache::get().load(3, IoUtils::resource("/texture/plant/plant3.png"), TextureCache::MIPMAP);
 
-	mTextures[3] = std::make_unique<Texture>(4, IoUtils::resource("/texture/plant/plant4.png"));
-	mTextures[3]->mipmap()->bind();
+	mTextures[3] = TextureCache::get().load(4, IoUtils::resource("/texture/plant/plant4.png"), TextureCache::MIPMAP);
 
 	mShader = std::make_unique<Shader>(vs, fs);
 	mShader->bindAttribute(0, "vertex");
@@ -200,13 +199,13 @@ Plant::Plant(std::weak_ptr<Planet> planet):
 	// The VBO containing the shared vertices.
 	// Thanks to instancing, they will be shared by all instances.
 	glGenBuffers(1, &mVbo);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(gVertexBuffer_Bush), &gVertexBuffer_Bush[0], GL_STATIC_DRAW);
 }
 
 
 Plant::~Plant() {
-	glDeleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mVbo);
 
 	std::for_each(mPagePoints.begin(), mPagePoints.end(), [](auto& iterator){
 		iterator.second.deleteBuffers();
@@ -325,9 +324,9 @@ void Plant::renderOpaque(const std::unordered_map<unsigned int,float>& pageIds,
 			}
 		}
 	} else if (shadowMap->isRendering()) {
-		glDisable(GL_CULL_FACE);
+		GLState::get().disable(GL_CULL_FACE);
 		render(pageIds, camera, sky, shadowMap);
-		glEnable(GL_CULL_FACE);
+		GLState::get().enable(GL_CULL_FACE);
 	}
 }
 
@@ -340,6 +339,8 @@ void Plant::renderTranslucent(const std::unordered_map<unsigned int,float>& page
 
 
 void Plant::render(const std::unordered_map<unsigned int,float>& pageIds, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap) {
+	PROFILE_SCOPE("plants");
+	RENDER_STATS_OBJECT("plants");
 	bool isShadowRendering = shadowMap->isRendering();
 	IShader* pShader = isShadowRendering? mShadowShader.get() : mShader.get();
 
@@ -359,35 +360,24 @@ void Plant::render(const std::unordered_map<unsigned int,float>& pageIds, const
 	pShader->set("texture2", mTextures[2].get());
 	pShader->set("texture3", mTextures[3].get());
 
-	// shared vertices
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribDivisor(0, 0); // vertices : always reuse the same vertices	-> 0
-	glVertexAttribDivisor(1, 1); // positions : one per quad (its center)		-> 1
-	glVertexAttribDivisor(2, 1); // info : one per quad 						-> 1
-
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
 	for (auto& pIt : pageIds) {
 		auto it = mPagePoints.find(pIt.first);
 		if (it != mPagePoints.end()) {
-			glBindBuffer(GL_ARRAY_BUFFER, it->second.pbo);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PlantData), 0);
-			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(PlantData), (GLvoid*) offsetof(PlantData, info));
-			glDrawArraysInstanced(GL_TRIANGLES, 0, gVertexBuffer_Bush_Size /* N vertices*/, it->second.points.size());
+			PlantPageData& page = it->second;
+			if (!page.vertexArray.isCreated()) {
+				page.vertexArray.begin();
+				// vertices: always reuse the same vertices, positions and info: one per quad
+				VertexArray::attribute(0, mVbo, 4, 0, 0);
+				VertexArray::attribute(1, page.pbo, 3, sizeof(PlantData), 0, 1);
+				VertexArray::attribute(2, page.pbo, 3, sizeof(PlantData), offsetof(PlantData, info), 1);
+				VertexArray::end();
+			}
+			page.vertexArray.bind();
+			glDrawArraysInstanced(GL_TRIANGLES, 0, gVertexBuffer_Bush_Size /* N vertices*/, page.points.size());
+			RENDER_STATS_DRAW(GL_TRIANGLES, gVertexBuffer_Bush_Size, page.points.size());
 		}
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glVertexAttribDivisor(1, 0); // disable
-	glVertexAttribDivisor(2, 0); // disable
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
+	VertexArray::unbind();
 
 	IShader::stop();
 }
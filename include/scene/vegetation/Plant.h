@@ -5,6 +5,8 @@
 #include "../planet/Planet.h"
 #include "../planet/IPlanetExternalObject.h"
 #include "../../util/Pin.h"
+#include "../../util/RenderStats.h"
+#include "../../util/VertexArray.h"
 
 
 class Plant: public IPlanetExternalObject {
@@ -43,17 +45,20 @@ class Plant: public IPlanetExternalObject {
 	struct PlantPageData {
 		std::vector<PlantData> points;
 		GLuint pbo {0}; // position buffer object
+		VertexArray vertexArray; // recorded by the first render of the page
 
 		void bind() {
 			if (pbo == 0) {
 				glGenBuffers(1, &pbo);
 			}
-			glBindBuffer(GL_ARRAY_BUFFER, pbo);
+			GLState::get().bindBuffer(GL_ARRAY_BUFFER, pbo);
 			glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(PlantData), &points[0].position, GL_STREAM_DRAW);
+			RENDER_STATS_UPLOAD(points.size() * sizeof(PlantData));
 		}
 
 		void deleteBuffers() {
-			glDeleteBuffers(1, &pbo);
+			GLState::get().deleteBuffers(1, &pbo);
+			vertexArray.reset();
 		}
 
 		void write(ISerializer* serializer) const {
@@ -90,6 +95,7 @@ public:
 
 	virtual void renderOpaque(const std::unordered_map<unsigned int,float>& pageIds, const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const GameState &gameState) override;
 	virtual void renderTranslucent(const std::unordered_map<unsigned int,float>& pageIds, const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const GameState &gameState) override;
+	virtual bool isReflected() const override { return false; }
 
 	virtual void write(ISerializer *serializer) const override;
 	virtual const std::string& serializeID() const noexcept override;
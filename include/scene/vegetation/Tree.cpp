@@ -2,9 +2,10 @@
 #include "../../util/IoUtils.h"
 #include "../sky/SkyShader.h"
 #include "../../util/ShadowMap.h"
-#include "../../util/Texture.h"
+#include "../../util/TextureCache.h"
 #include "../../util/ShaderNoise.h"
 #include "../../util/ShaderUtils.h"
+#include "../../util/GpuProfiler.h"
 
 
 static constexpr const char* vs[] = {
@@ -13,9 +14,9 @@ static constexpr const char* vs[] = {
 	"attribute vec3 position;"
 	"attribute vec3 info;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
-	"uniform vec3 cameraPosition;"
+	,UniformBlock::VIEW_CODE,
+	" "
+	,UniformBlock::SKY_CODE,
 	"uniform bool hasWind;"
 
 	"varying vec3 worldV;"
@@ -64,6 +65,8 @@ static constexpr const char* fs[] = {
 
 	,ShadowMap::getFragmentShaderCode(),
 	""
+	,UniformBlock::SKY_CODE,
+	""
 	,SkyShader::SHARED_FRAGMENT_CODE,
 
 	"vec4 color() {"
@@ -229,6 +232,9 @@ void Tree::removeTrees(const btVector3& point) {
 
 
 void Tree::render(const std::unordered_map<unsigned int,float>& pageIds, const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap) {
+	PROFILE_SCOPE("trees");
+	GPU_PROFILE_SCOPE("trees");
+	RENDER_STATS_OBJECT("trees");
 	bool hasPoints = false;
 	for (auto& modelGroup : mModelGroups) {
 		if (modelGroup.second->pagePoints.size() > 0) {
@@ -253,29 +259,9 @@ void Tree::render(const std::unordered_map<unsigned int,float>& pageIds, const I
 		shadowMap->setVars(pShader);
 	}
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
-
-	glVertexAttribDivisor(0, 0); // vertices : always reuse the same vertices	-> 0
-	glVertexAttribDivisor(1, 0); // uv : always reuse the same uv 				-> 0
-	glVertexAttribDivisor(2, 1); // positions : one per quad (its center)		-> 1
-	glVertexAttribDivisor(3, 1); // info : one per quad 						-> 1
-
 	for (auto& modelGroup : mModelGroups)
 		modelGroup.second->render(pageIds, pShader);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glVertexAttribDivisor(2, 0); // disable
-	glVertexAttribDivisor(3, 0); // disable
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
+	VertexArray::unbind();
 
 	IShader::stop();
 }
@@ -357,6 +343,7 @@ const std::string& Tree::serializeID() const noexcept {
 //-----------------------------------------------------------------------------
 
 void Tree::ModelGroup::render(const std::unordered_map<unsigned int,float>& pageIds, IShader* shader) {
+	PROFILE_SCOPE("tree group");
 	static std::vector<TreePageData*> pageData(40);
 
 	static const auto findTreePageData = [](float min, float max, const auto& pageIds, const auto& pagePoints){
@@ -437,11 +424,11 @@ Tree::ModelData::ModelData(const std::string& filename, unsigned int windMesh):
 
 	// The VBO containing the shared vertices. Thanks to instancing, they will be shared by all instances.
 	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, modelOBJ->getNumberOfVertices() * modelOBJ->getVertexSize(), &modelOBJ->getVertexBuffer()->position[0], GL_STATIC_DRAW);
 
 	const auto bindMesh = [](GLuint ibo, const ModelOBJ* model, unsigned int meshIndex){
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 					 3 * model->getMesh(meshIndex).triangleCount * model->getIndexSize(),
 					 model->getIndexBuffer() + model->getMesh(meshIndex).startIndex,
@@ -457,50 +444,53 @@ Tree::ModelData::ModelData(const std::string& filename, unsigned int windMesh):
 
 		mesh->indexCount = 3 * modelOBJ->getMesh(i).triangleCount;
 		mesh->hasWind = i == windMesh;
-		mesh->texture = std::make_unique<Texture>(1, IoUtils::resource("/model/vegetation/" + modelOBJ->getMesh(i).pMaterial->colorMapFilename));
-		mesh->texture->mipmap()->bind();
+		// the LODs of a model share their bark and leaves
+		mesh->texture = TextureCache::get().load(1, IoUtils::resource("/model/vegetation/" + modelOBJ->getMesh(i).pMaterial->colorMapFilename), TextureCache::MIPMAP);
 
 		meshes.push_back(std::move(mesh));
 	}
 
 	// Unbind
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
 Tree::ModelData::~ModelData() {
-	glDeleteBuffers(1, &vbo);
+	GLState::get().deleteBuffers(1, &vbo);
+}
+
+
+void Tree::ModelData::recordVertexArray(VertexArray& vertexArray, const MeshData* mesh, GLuint pbo) const {
+	vertexArray.begin();
+	// shared vertices and indices, then the position and info of each instance
+	VertexArray::attribute(0, vbo, 3, modelOBJ->getVertexSize(), 0);
+	VertexArray::attribute(1, vbo, 2, modelOBJ->getVertexSize(), offsetof(ModelOBJ::Vertex, texCoord));
+	VertexArray::attribute(2, pbo, 3, sizeof(TreeData), 0, 1);
+	VertexArray::attribute(3, pbo, 3, sizeof(TreeData), offsetof(TreeData, info), 1);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+	VertexArray::end();
 }
 
 
 void Tree::ModelData::render(const std::vector<TreePageData*>& pageData, IShader* shader) {
-	// shared vertices
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, modelOBJ->getVertexSize(), 0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, modelOBJ->getVertexSize(), (GLvoid*) offsetof(ModelOBJ::Vertex, texCoord));
+	GLState::get().disable(GL_CULL_FACE);
 
-	static const auto renderMesh = [](const MeshData* mesh, IShader* pShader, const std::vector<TreePageData*>& pageData) {
-		pShader->set("texture", mesh->texture.get());
-		// shared indices
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+	for (const auto& mesh : meshes) {
+		shader->set("hasWind", mesh->hasWind);
+		shader->set("texture", mesh->texture.get());
 
 		for (auto& data : pageData) {
-			glBindBuffer(GL_ARRAY_BUFFER, data->pbo);
-			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TreeData), 0);
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(TreeData), (GLvoid*) offsetof(TreeData, info));
+			VertexArray& vertexArray = data->vertexArrays[mesh.get()];
+			if (!vertexArray.isCreated())
+				recordVertexArray(vertexArray, mesh.get(), data->pbo);
+			vertexArray.bind();
 			glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0, data->points.size());
+			RENDER_STATS_DRAW(GL_TRIANGLES, mesh->indexCount, data->points.size());
 		}
-	};
-
-	glDisable(GL_CULL_FACE);
-
-	for (const auto& mesh : meshes) {
-		shader->set("hasWind", mesh->hasWind);
-		renderMesh(mesh.get(), shader, pageData);
 	}
 
-	glEnable(GL_CULL_FACE);
+	GLState::get().enable(GL_CULL_FACE);
 }
 
 
@@ -5,7 +5,9 @@
 #include "../planet/Planet.h"
 #include "../planet/IPlanetExternalObject.h"
 #include "../../util/Pin.h"
+#include "../../util/RenderStats.h"
 #include "../../util/ModelOBJ.h"
+#include "../../util/VertexArray.h"
 
 
 class Tree: public IPlanetExternalObject {
@@ -38,20 +40,25 @@ class Tree: public IPlanetExternalObject {
 		}
 	};
 
+	struct MeshData;
+
 	struct TreePageData {
 		std::vector<TreeData> points;
 		GLuint pbo {0}; // position buffer object
+		// one per mesh of the LODs the page was drawn with, recorded on the first draw
+		std::unordered_map<const MeshData*, VertexArray> vertexArrays;
 
 		~TreePageData() {
-			glDeleteBuffers(1, &pbo);
+			GLState::get().deleteBuffers(1, &pbo);
 		}
 
 		void bind() {
 			if (pbo == 0) {
 				glGenBuffers(1, &pbo);
 			}
-			glBindBuffer(GL_ARRAY_BUFFER, pbo);
+			GLState::get().bindBuffer(GL_ARRAY_BUFFER, pbo);
 			glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(TreeData), &points[0].position, GL_STREAM_DRAW);
+			RENDER_STATS_UPLOAD(points.size() * sizeof(TreeData));
 		}
 
 		void write(ISerializer* serializer) const {
@@ -77,7 +84,7 @@ class Tree: public IPlanetExternalObject {
 		unsigned int indexCount;
 		std::unique_ptr<ITexture> texture;
 
-		~MeshData() { glDeleteBuffers(1, &ibo); }
+		~MeshData() { GLState::get().deleteBuffers(1, &ibo); }
 	};
 
 	struct ModelData {
@@ -90,6 +97,7 @@ class Tree: public IPlanetExternalObject {
 		ModelData(const std::string&, unsigned int windMesh);
 		~ModelData();
 
+		void recordVertexArray(VertexArray& vertexArray, const MeshData* mesh, GLuint pbo) const;
 		void render(const std::vector<TreePageData*>& pageData, IShader* shader);
 
 		void write(ISerializer* serializer) const;
@@ -29,7 +29,8 @@ FourWheels::FourWheels(std::weak_ptr<btDynamicsWorld> dynamicsWorld, const btVec
 	mSuspensionDamping(10.0f),
 	mSuspensionCompression(0.0f),
 	mSuspensionRestLength(0.1f),
-	mRollInfluence(0.0f)
+	mRollInfluence(0.0f),
+	mCapturedSpeed(0.f)
 {
 	mDynamicsWorld = dynamicsWorld;
 
@@ -63,6 +64,20 @@ void FourWheels::updateSimulation() {
 }
 
 
+void FourWheels::captureState() {
+	SceneObject::captureState();
+
+	const btTransform& chassisInverse = mPhysicsBody->getRigidBody()->getWorldTransform().inverse();
+	mCapturedWheelTransforms.resize(mVehicle->getNumWheels());
+	for (int i = 0; i < mVehicle->getNumWheels(); i++) {
+		mVehicle->updateWheelTransform(i, false);
+		mCapturedWheelTransforms[i] = chassisInverse * mVehicle->getWheelInfo(i).m_worldTransform;
+	}
+
+	mCapturedSpeed = mPhysicsBody->getRigidBody()->getLinearVelocity().length();
+}
+
+
 void FourWheels::initPhysics(btTransform transform)
 {
 	float halfWidth = 1.2f;
@@ -270,30 +285,31 @@ void FourWheels::jump() {
 }
 
 
-void FourWheels::render(bool opaque, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) const {
-	if (surfaceReflection && surfaceReflection->isRendering())
-		return;
-
-	static Matrix4x4 carMatrix4x4;
+void FourWheels::getRenderMatrices(Matrix4x4& carMatrix4x4, std::vector<Matrix4x4>& wheelMatrices) const {
 	carMatrix4x4 = getMatrix4x4();
-
-	static std::vector<Matrix4x4> wheelMatrices(4);
 	wheelMatrices.clear();
 
-	const auto updateWheel = [this](int index){
-		mVehicle->updateWheelTransform(index, true);
+	// the wheels follow the interpolated chassis
+	btTransform chassisTransform;
+	mPhysicsBody->getMotionState()->getWorldTransform(chassisTransform);
 
-		Matrix4x4 wheelMatrix4x4 = getMatrix4x4(mVehicle->getWheelInfo(index).m_worldTransform);
+	for (unsigned int index = 0; index < mCapturedWheelTransforms.size(); index++) {
+		Matrix4x4 wheelMatrix4x4 = getMatrix4x4(chassisTransform * mCapturedWheelTransforms[index]);
 		if (index % 2 == 1) {
 			wheelMatrix4x4.rotate(0.0f, -1.0f, 0.f, 1.f, 0.f); // rotate 180 degrees
 		}
 		wheelMatrices.emplace_back(std::move(wheelMatrix4x4));
-	};
+	}
+}
 
-	updateWheel(0);
-	updateWheel(1);
-	updateWheel(2);
-	updateWheel(3);
+
+void FourWheels::render(bool opaque, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) const {
+	if (surfaceReflection && surfaceReflection->isRendering())
+		return;
+
+	static Matrix4x4 carMatrix4x4;
+	static std::vector<Matrix4x4> wheelMatrices(4);
+	getRenderMatrices(carMatrix4x4, wheelMatrices);
 
 	if (gameState.debugCode == DebugCode::COLLISION_SHAPE) {
 		mShapeRenderer->render(camera, sky, mPhysicsBody->getCollisionShape(), carMatrix4x4, opaque);
@@ -307,6 +323,21 @@ void FourWheels::render(bool opaque, const ICamera* camera, const ISky *sky, con
 }
 
 
+void FourWheels::submit(bool opaque, IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) const {
+	if (surfaceReflection && surfaceReflection->isRendering())
+		return;
+
+	Matrix4x4 carMatrix4x4;
+	std::vector<Matrix4x4> wheelMatrices;
+	getRenderMatrices(carMatrix4x4, wheelMatrices);
+
+	mCarModel->submit(queue, camera, sky, shadowMap, carMatrix4x4, opaque);
+	for (auto& wheelMatrix4x4 : wheelMatrices) {
+		mWheelModel->submit(queue, camera, sky, shadowMap, wheelMatrix4x4, opaque);
+	}
+}
+
+
 void FourWheels::renderOpaque(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
 	render(true, camera, sky, shadowMap, surfaceReflection, gameState);
 }
@@ -317,8 +348,24 @@ void FourWheels::renderTranslucent(const ICamera* camera, const ISky *sky, const
 }
 
 
+void FourWheels::submitOpaque(IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
+	if (gameState.debugCode == DebugCode::COLLISION_SHAPE)
+		SceneObject::submitOpaque(queue, camera, sky, shadowMap, surfaceReflection, gameState);
+	else
+		submit(true, queue, camera, sky, shadowMap, surfaceReflection, gameState);
+}
+
+
+void FourWheels::submitTranslucent(IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) {
+	if (gameState.debugCode == DebugCode::COLLISION_SHAPE)
+		SceneObject::submitTranslucent(queue, camera, sky, shadowMap, surfaceReflection, gameState);
+	else
+		submit(false, queue, camera, sky, shadowMap, surfaceReflection, gameState);
+}
+
+
 void FourWheels::render2d(IRenderer2d* renderer2d) {
-	int speed = static_cast<int>(mPhysicsBody->getRigidBody()->getLinearVelocity().length());
+	int speed = static_cast<int>(mCapturedSpeed);
 	const std::string text = "Speed " + std::to_string(speed) + " km/h";
 	const static SDL_Color BLACK = { 0, 0, 0 };
 	renderer2d->renderText(100, text, BLACK, "left=5", "top=10", 20);
@@ -47,10 +47,16 @@ class FourWheels: public SceneObject, public Vehicle
 
 	btVector3 mInitialPosition;
 
+	// captured from the simulation for the renderer, wheels are relative to the chassis
+	std::vector<btTransform> mCapturedWheelTransforms;
+	float mCapturedSpeed;
+
 	void buildVehicleShape(btTransform transform, float halfWidth, float halfHeight, float halfLength, float yShift, float zShift);
 	void buildWheels(float halfWidth, float halfLength, float yShift, float zShift);
 	void addWheel(const btVector3& connectionPointCS0, bool isFrontWheel);
+	void getRenderMatrices(Matrix4x4& carMatrix4x4, std::vector<Matrix4x4>& wheelMatrices) const;
 	void render(bool opaque, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) const;
+	void submit(bool opaque, IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) const;
 
 public:
 	static const std::string& SERIALIZE_ID;
@@ -70,8 +76,11 @@ public:
 
 	virtual void reset() override;
 	virtual void updateSimulation() override;
+	virtual void captureState() override;
 	virtual void renderOpaque(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 	virtual void renderTranslucent(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
+	virtual void submitOpaque(IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
+	virtual void submitTranslucent(IRenderQueue* queue, const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const ISurfaceReflection* surfaceReflection, const GameState& gameState) override;
 	virtual void render2d(IRenderer2d* renderer2d) override;
 
 	virtual void write(ISerializer *serializer) const override;
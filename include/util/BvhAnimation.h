@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <SDL2/SDL_timer.h>
 #include "../scene/SceneObject.h"
 #include "IoUtils.h"
 #include "StringUtils.h"
@@ -214,8 +215,8 @@ public:
 		mStartTime = 0;
 	}
 
-	virtual void paint(Camera* camera) {
-
+	/** selects the frame of the elapsed time since start() */
+	virtual void update() {
 		if (mStartTime) {
 			Uint32 now = SDL_GetTicks();
 			Uint32 timeSinceStart = now - mStartTime;
@@ -224,39 +225,10 @@ public:
 			mCurrentFrame = frame;
 			updateFrame(mRoot);
 		}
-
-		glLineWidth(0.5);
-		glPointSize(4.0);
-
-		glColor3f(0.0, 0.0, 1.0);
-		btVector3 v0 = mRoot->matrix.getVertex();
-		glBegin(GL_POINTS);
-		glVertex3f(v0.x(), v0.y(), v0.z());
-		glEnd();
-
-		glColor3f(1.0, 0.0, 0.0);
-		paintNode(mRoot);
 	}
 
-	virtual void paintNode(Node* node) {
-
-		if (node->parent) {
-			btVector3 p0 = node->parent->matrix.getVertex();
-			btVector3 v0 = node->matrix.getVertex();
-
-			glBegin(GL_POINTS);
-			glVertex3f(v0.x(), v0.y(), v0.z());
-			glEnd();
-
-			glBegin(GL_LINES);
-			glVertex3f(p0.x(), p0.y(), p0.z());
-			glVertex3f(v0.x(), v0.y(), v0.z());
-			glEnd();
-		}
-
-		for (Node* child : node->children) {
-			paintNode(child);
-		}
+	unsigned int getFrameCount() const noexcept {
+		return mFrameCount;
 	}
 };
 
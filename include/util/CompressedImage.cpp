@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "CompressedImage.h"
+
+const std::string CompressedImage::EXTENSION = ".ktx";
+
+static const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static constexpr const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+typedef struct {
+	uint8_t identifier[12];
+	uint32_t endianness;
+	uint32_t glType; // 0 for compressed formats
+	uint32_t glTypeSize;
+	uint32_t glFormat; // 0 for compressed formats
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+} KtxHeader;
+
+
+static uint16_t toRgb565(const int* color) {
+	return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+
+static void fromRgb565(uint16_t value, int* color) {
+	const int r = (value >> 11) & 31;
+	const int g = (value >> 5) & 63;
+	const int b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+
+/** BC1 block of the 4x4 texels (RGBA), 8 bytes: the two end points and 2 bits a texel */
+static void encodeColorBlock(const uint8_t* block, uint8_t* out) {
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			minColor[c] = std::min(minColor[c], static_cast<int>(block[i * 4 + c]));
+			maxColor[c] = std::max(maxColor[c], static_cast<int>(block[i * 4 + c]));
+		}
+	}
+
+	// the diagonal of the box follows the colors only where the channels grow with green
+	int covariance[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		const int g = 2 * block[i * 4 + 1] - minColor[1] - maxColor[1];
+		covariance[0] += (2 * block[i * 4] - minColor[0] - maxColor[0]) * g;
+		covariance[2] += (2 * block[i * 4 + 2] - minColor[2] - maxColor[2]) * g;
+	}
+	for (int c = 0; c < 3; c += 2) {
+		if (covariance[c] < 0)
+			std::swap(minColor[c], maxColor[c]);
+	}
+
+	// inset by 1/16 of the range, the extremes are rarely the best end points
+	for (int c = 0; c < 3; c++) {
+		const int inset = (maxColor[c] - minColor[c]) / 16;
+		maxColor[c] -= inset;
+		minColor[c] += inset;
+	}
+
+	uint16_t color0 = toRgb565(maxColor);
+	uint16_t color1 = toRgb565(minColor);
+	// color0 > color1 is the opaque mode of four colors
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		fromRgb565(color0, palette[0]);
+		fromRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestDistance = 1 << 30;
+			for (int p = 0; p < 4; p++) {
+				int distance = 0;
+				for (int c = 0; c < 3; c++) {
+					const int d = block[i * 4 + c] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (2 * i);
+		}
+	}
+
+	out[0] = color0 & 0xff;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xff;
+	out[3] = color1 >> 8;
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+
+/** BC4 block of a channel of the 4x4 texels, 8 bytes: the two end points and 3 bits a texel */
+static void encodeChannelBlock(const uint8_t* block, int channel, uint8_t* out) {
+	int minValue = 255;
+	int maxValue = 0;
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, static_cast<int>(block[i * 4 + channel]));
+		maxValue = std::max(maxValue, static_cast<int>(block[i * 4 + channel]));
+	}
+
+	uint64_t indices = 0;
+	if (maxValue != minValue) {
+		// value0 > value1: the mode of eight values, 6 interpolated
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int p = 2; p < 8; p++)
+			palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++) {
+				const int distance = std::abs(block[i * 4 + channel] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(maxValue);
+	out[1] = static_cast<uint8_t>(minValue);
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+
+static CompressedImage::Level encodeLevel(CompressedImage::Format format, GLenum internalFormat, const std::vector<uint8_t>& rgba,
+										  unsigned int width, unsigned int height) {
+	CompressedImage::Level level;
+	level.width = width;
+	level.height = height;
+	level.data.resize(CompressedImage::getLevelSize(internalFormat, width, height));
+
+	uint8_t* out = level.data.data();
+	uint8_t block[64];
+	for (unsigned int by = 0; by < height; by += 4) {
+		for (unsigned int bx = 0; bx < width; bx += 4) {
+			// the edge texels are repeated in the blocks that go past the border
+			for (unsigned int y = 0; y < 4; y++) {
+				const unsigned int sy = std::min(by + y, height - 1);
+				for (unsigned int x = 0; x < 4; x++) {
+					const unsigned int sx = std::min(bx + x, width - 1);
+					std::memcpy(block + (y * 4 + x) * 4, rgba.data() + (sy * width + sx) * 4, 4);
+				}
+			}
+
+			switch (format) {
+			case CompressedImage::BC1:
+				encodeColorBlock(block, out);
+				out += 8;
+				break;
+			case CompressedImage::BC3:
+				encodeChannelBlock(block, 3, out);
+				encodeColorBlock(block, out + 8);
+				out += 16;
+				break;
+			case CompressedImage::BC5:
+				encodeChannelBlock(block, 0, out);
+				encodeChannelBlock(block, 1, out + 8);
+				out += 16;
+				break;
+			}
+		}
+	}
+	return level;
+}
+
+
+/** the next level of the chain, 2x2 box filter (as glGenerateMipmap), odd sizes clamp */
+static std::vector<uint8_t> downsample(const std::vector<uint8_t>& rgba, unsigned int width, unsigned int height) {
+	const unsigned int w = std::max(1u, width / 2);
+	const unsigned int h = std::max(1u, height / 2);
+	std::vector<uint8_t> result(w * h * 4);
+	for (unsigned int y = 0; y < h; y++) {
+		const unsigned int y0 = std::min(2 * y, height - 1);
+		const unsigned int y1 = std::min(2 * y + 1, height - 1);
+		for (unsigned int x = 0; x < w; x++) {
+			const unsigned int x0 = std::min(2 * x, width - 1);
+			const unsigned int x1 = std::min(2 * x + 1, width - 1);
+			for (unsigned int c = 0; c < 4; c++) {
+				const unsigned int sum = rgba[(y0 * width + x0) * 4 + c] + rgba[(y0 * width + x1) * 4 + c]
+						+ rgba[(y1 * width + x0) * 4 + c] + rgba[(y1 * width + x1) * 4 + c];
+				result[(y * w + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+
+CompressedImage::CompressedImage():
+	mInternalFormat(0),
+	mBaseFormat(0)
+{}
+
+
+std::string CompressedImage::getFileName(const std::string& imageFileName) {
+	const size_t dot = imageFileName.find_last_of('.');
+	const size_t slash = imageFileName.find_last_of('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return imageFileName + EXTENSION;
+	return imageFileName.substr(0, dot) + EXTENSION;
+}
+
+
+bool CompressedImage::isFileName(const std::string& fileName) {
+	return fileName.size() >= EXTENSION.size()
+		   && fileName.compare(fileName.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0;
+}
+
+
+size_t CompressedImage::getLevelSize(GLenum internalFormat, unsigned int width, unsigned int height) {
+	const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+	return blocks * (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT? 8 : 16);
+}
+
+
+const char* CompressedImage::getFormatName(GLenum internalFormat) {
+	switch (internalFormat) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		return "BC1";
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return "BC3";
+	case GL_COMPRESSED_RG_RGTC2:
+		return "BC5";
+	default:
+		return nullptr;
+	}
+}
+
+
+CompressedImage CompressedImage::encode(Format format, const uint8_t* rgba, unsigned int width, unsigned int height, bool mipmaps) {
+	CompressedImage image;
+	switch (format) {
+	case BC1:
+		image.mInternalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		image.mBaseFormat = GL_RGB;
+		break;
+	case BC3:
+		image.mInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		image.mBaseFormat = GL_RGBA;
+		break;
+	case BC5:
+		image.mInternalFormat = GL_COMPRESSED_RG_RGTC2;
+		image.mBaseFormat = GL_RG;
+		break;
+	}
+
+	std::vector<uint8_t> level(rgba, rgba + static_cast<size_t>(width) * height * 4);
+	for (;;) {
+		image.mLevels.push_back(encodeLevel(format, image.mInternalFormat, level, width, height));
+		if (!mipmaps || (width == 1 && height == 1))
+			break;
+		level = downsample(level, width, height);
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+	return image;
+}
+
+
+CompressedImage CompressedImage::read(const std::string& fileName) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("Can't open " + fileName);
+
+	KtxHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+		throw std::runtime_error("Not a KTX file: " + fileName);
+	// written by the converter on the same (little endian) machines, not swapped
+	if (header.endianness != KTX_ENDIANNESS)
+		throw std::runtime_error("KTX file of the other endianness: " + fileName);
+	if (header.glType != 0 || !getFormatName(header.glInternalFormat))
+		throw std::runtime_error("KTX file not BC1, BC3 or BC5: " + fileName);
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0
+			|| header.numberOfArrayElements != 0 || header.numberOfFaces != 1 || header.numberOfMipmapLevels > 32)
+		throw std::runtime_error("KTX file not a 2D texture: " + fileName);
+
+	CompressedImage image;
+	image.mInternalFormat = header.glInternalFormat;
+	image.mBaseFormat = header.glBaseInternalFormat;
+	file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+	// 0 levels: the chain is to be generated, only the base level is in the file
+	const uint32_t levelCount = std::max(1u, header.numberOfMipmapLevels);
+	for (uint32_t i = 0; i < levelCount; i++) {
+		Level level;
+		level.width = std::max(1u, header.pixelWidth >> i);
+		level.height = std::max(1u, header.pixelHeight >> i);
+		uint32_t imageSize = 0;
+		if (!file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize))
+				|| imageSize != getLevelSize(image.mInternalFormat, level.width, level.height))
+			throw std::runtime_error("Corrupted KTX file: " + fileName);
+		level.data.resize(imageSize);
+		if (!file.read(reinterpret_cast<char*>(level.data.data()), imageSize))
+			throw std::runtime_error("Truncated KTX file: " + fileName);
+		file.seekg((4 - imageSize % 4) % 4, std::ios::cur);
+		image.mLevels.push_back(std::move(level));
+	}
+	return image;
+}
+
+
+void CompressedImage::write(const std::string& fileName) const {
+	KtxHeader header;
+	std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+	header.endianness = KTX_ENDIANNESS;
+	header.glType = 0;
+	header.glTypeSize = 1;
+	header.glFormat = 0;
+	header.glInternalFormat = mInternalFormat;
+	header.glBaseInternalFormat = mBaseFormat;
+	header.pixelWidth = getWidth();
+	header.pixelHeight = getHeight();
+	header.pixelDepth = 0;
+	header.numberOfArrayElements = 0;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = static_cast<uint32_t>(mLevels.size());
+	header.bytesOfKeyValueData = 0;
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	// the block sizes are multiples of 8, there is no padding
+	for (const Level& level : mLevels) {
+		const uint32_t imageSize = static_cast<uint32_t>(level.data.size());
+		file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+		file.write(reinterpret_cast<const char*>(level.data.data()), imageSize);
+	}
+	if (!file)
+		throw std::runtime_error("Can't write " + fileName);
+}
+
+
+size_t CompressedImage::getMemorySize(size_t levelCount) const noexcept {
+	size_t size = 0;
+	for (size_t i = 0; i < levelCount && i < mLevels.size(); i++)
+		size += mLevels[i].data.size();
+	return size;
+}
+
+
+void CompressedImage::clear() noexcept {
+	mLevels.clear();
+}
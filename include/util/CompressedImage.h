@@ -0,0 +1,94 @@
+#ifndef GAMEDEV3D_COMPRESSED_IMAGE_H
+#define GAMEDEV3D_COMPRESSED_IMAGE_H
+
+#include "GLHeaders.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// EXT_texture_compression_s3tc, not in the core headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/**
+ * Block compressed image with its mip chain, in a KTX 1.1 file: BC1 (opaque RGB, 4 bits a
+ * texel), BC3 (RGBA, 8 bits) or BC5 (two channels, 8 bits, normal maps sampled as RG).
+ * The files are made offline by gamedev3d_texconv (src/TextureConverter.cpp) next to the
+ * source image, foo.jpg -> foo.ktx, and uploaded as they are by the Texture.
+ *
+ * Reading and encoding don't touch GL, any thread. Errors throw std::runtime_error.
+ */
+
+class CompressedImage {
+public:
+	enum Format {
+		BC1,
+		BC3,
+		BC5
+	};
+
+	typedef struct {
+		unsigned int width;
+		unsigned int height;
+		std::vector<uint8_t> data;
+	} Level;
+
+private:
+	GLenum mInternalFormat;
+	GLenum mBaseFormat;
+	std::vector<Level> mLevels;
+
+public:
+	static const std::string EXTENSION;
+
+	CompressedImage();
+
+	/** the container of an image file: its name with the extension replaced */
+	static std::string getFileName(const std::string& imageFileName);
+	static bool isFileName(const std::string& fileName);
+
+	/** rgba: 4 bytes a texel, rows packed. mipmaps: the chain down to 1x1, box filtered */
+	static CompressedImage encode(Format format, const uint8_t* rgba, unsigned int width, unsigned int height, bool mipmaps);
+	static CompressedImage read(const std::string& fileName);
+	void write(const std::string& fileName) const;
+
+	/** of a level of width x height texels, in bytes */
+	static size_t getLevelSize(GLenum internalFormat, unsigned int width, unsigned int height);
+	static const char* getFormatName(GLenum internalFormat);
+
+	bool isEmpty() const noexcept;
+	GLenum getInternalFormat() const noexcept;
+	unsigned int getWidth() const noexcept;
+	unsigned int getHeight() const noexcept;
+	size_t getLevelCount() const noexcept;
+	const Level& getLevel(size_t level) const;
+	/** of the first levelCount levels */
+	size_t getMemorySize(size_t levelCount) const noexcept;
+	void clear() noexcept;
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool CompressedImage::isEmpty() const noexcept
+{ return mLevels.empty(); }
+
+inline GLenum CompressedImage::getInternalFormat() const noexcept
+{ return mInternalFormat; }
+
+inline unsigned int CompressedImage::getWidth() const noexcept
+{ return mLevels.empty()? 0 : mLevels.front().width; }
+
+inline unsigned int CompressedImage::getHeight() const noexcept
+{ return mLevels.empty()? 0 : mLevels.front().height; }
+
+inline size_t CompressedImage::getLevelCount() const noexcept
+{ return mLevels.size(); }
+
+inline const CompressedImage::Level& CompressedImage::getLevel(size_t level) const
+{ return mLevels.at(level); }
+
+#endif
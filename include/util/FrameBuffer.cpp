@@ -31,17 +31,27 @@ void FrameBuffer::startColor(const ITexture* texture) const {
 }
 
 
-void FrameBuffer::startDepth(const ITexture* texture) const {
+void FrameBuffer::startDepth(const ITexture* texture, bool clear) const {
 	glViewport(0, 0, texture->getWidth(), texture->getHeight());
 	glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture->getID(), 0);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	if (clear)
+		glClear(GL_DEPTH_BUFFER_BIT);
 	check();
 }
 
 
+// copies the depth attachment, target stays bound afterwards
+void FrameBuffer::blitDepth(const FrameBuffer& target, unsigned int width, unsigned int height) const {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mFboId);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.mFboId);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.mFboId);
+}
+
+
 void FrameBuffer::startColorAndDepth(const ITexture* colorTexture, const ITexture* depthTexture) const {
 	glViewport(0, 0, colorTexture->getWidth(), colorTexture->getHeight());
 	glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
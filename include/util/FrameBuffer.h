@@ -14,8 +14,9 @@ public:
 
 	void check() const;
 	void startColor(const ITexture* texture) const;
-	void startDepth(const ITexture* texture) const;
+	void startDepth(const ITexture* texture, bool clear = true) const;
 	void startColorAndDepth(const ITexture* colorTexture, const ITexture* depthTexture) const;
+	void blitDepth(const FrameBuffer& target, unsigned int width, unsigned int height) const;
 	static void end();
 };
 
@@ -0,0 +1,19 @@
+#ifndef GAMEDEV3D_GL_HEADERS_H
+#define GAMEDEV3D_GL_HEADERS_H
+
+/**
+ * OpenGL declarations: the framework on macOS, the Mesa headers elsewhere (the headless
+ * build on EGL), where the entry points past GL 1.1 come from glext.h.
+ */
+
+#if defined(__APPLE__)
+#include <OpenGL/gl3.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#endif
@@ -5,8 +5,7 @@ static constexpr const char* vsShape[] = {
 	"attribute vec4 position;"
 	"attribute vec4 normal;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"uniform mat4 m16;"
 	"uniform vec3 sunPosition;"
@@ -57,6 +56,7 @@ GLShapeRenderer::GLShapeRenderer() {
 	mShader->bindAttribute(0, "position");
 	mShader->bindAttribute(1, "normal");
 	mShader->link();
+	mModelUniform = mShader->getUniform("m16");
 }
 
 
@@ -117,9 +117,9 @@ GLShapeRenderer::ShapeCache::ShapeCache(btConvexShape *s):
 
 GLShapeRenderer::ShapeCache::~ShapeCache() {
 	Log::debug("Deleting ShaperCache");
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mNbo);
-	glDeleteBuffers(1, &mIbo);
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mNbo);
+	GLState::get().deleteBuffers(1, &mIbo);
 }
 
 
@@ -161,17 +161,17 @@ void GLShapeRenderer::ShapeCache::bind() {
 	glGenBuffers(1, &mNbo);
 	glGenBuffers(1, &mIbo);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(btVector3), &mVertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mNbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mNbo);
 	glBufferData(GL_ARRAY_BUFFER, mNormals.size() * sizeof(btVector3), &mNormals[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned int), &mIndices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	ready = true;
 }
@@ -182,21 +182,21 @@ void GLShapeRenderer::ShapeCache::render() {
 		bind();
 
 	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
 
 	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, mNbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mNbo);
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 
@@ -230,7 +230,7 @@ void GLShapeRenderer::render(const ICamera *camera, const ISky *sky, const btCol
 
 			mShader->run();
 			camera->setMatrices(mShader.get());
-			mShader->set("m16", m4x4);
+			mModelUniform.set(m4x4);
 			mShader->set("sunPosition", sky->getSunPosition());
 			info->render();
 
@@ -38,6 +38,7 @@ private:
 
 	std::forward_list<std::unique_ptr<ShapeCache>> mShapeCaches;
 	std::unique_ptr<IShader> mShader;
+	Uniform mModelUniform; // m16, set for each shape
 
 	ShapeCache* cache(btConvexShape* shape);
 
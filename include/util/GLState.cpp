@@ -0,0 +1,310 @@
+#include <cstdio>
+#include "GLState.h"
+#include "Log.h"
+#include "RenderStats.h"
+
+constexpr const GLenum GLState::CAPABILITIES[];
+constexpr const GLenum GLState::BUFFER_TARGETS[];
+
+
+GLState::GLState():
+	mIsValidating(false)
+{
+	invalidate();
+}
+
+
+GLState& GLState::get() {
+	static GLState state;
+	return state;
+}
+
+
+int GLState::capabilityIndex(GLenum capability) noexcept {
+	for (int i = 0; i < CAPABILITY_COUNT; i++) {
+		if (CAPABILITIES[i] == capability)
+			return i;
+	}
+	return -1;
+}
+
+
+int GLState::bufferIndex(GLenum target) noexcept {
+	for (int i = 0; i < BUFFER_TARGET_COUNT; i++) {
+		if (BUFFER_TARGETS[i] == target)
+			return i;
+	}
+	return -1;
+}
+
+
+void GLState::invalidate() {
+	mProgram = UNKNOWN;
+	mVertexArray = UNKNOWN;
+	for (GLuint& buffer : mBuffers)
+		buffer = UNKNOWN;
+	mActiveUnit = UNKNOWN;
+	for (GLuint& texture : mTextures)
+		texture = UNKNOWN;
+	for (GLuint& capability : mCapabilities)
+		capability = UNKNOWN;
+	mBlendSource = UNKNOWN;
+	mBlendDestination = UNKNOWN;
+	mDepthMask = UNKNOWN;
+	mCullFace = UNKNOWN;
+}
+
+
+void GLState::useProgram(GLuint program) {
+	if (program == mProgram) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glUseProgram(program);
+	mProgram = program;
+	if (program != 0)
+		RENDER_STATS_SHADER_SWITCH();
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::releaseProgram() {
+	// uniforms set without a program are errors, the validation makes them visible
+	if (mIsValidating)
+		useProgram(0);
+}
+
+
+void GLState::deleteProgram(GLuint program) {
+	// a deleted program stays alive while it is in use
+	if (program == mProgram)
+		useProgram(0);
+	glDeleteProgram(program);
+}
+
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+	if (vertexArray == mVertexArray) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	mVertexArray = vertexArray;
+	mBuffers[ELEMENT_ARRAY] = UNKNOWN;
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::deleteVertexArrays(GLsizei n, const GLuint* vertexArrays) {
+	glDeleteVertexArrays(n, vertexArrays);
+	// deleting the bound array binds 0
+	for (GLsizei i = 0; i < n; i++) {
+		if (vertexArrays[i] == mVertexArray) {
+			mVertexArray = 0;
+			mBuffers[ELEMENT_ARRAY] = UNKNOWN;
+		}
+	}
+}
+
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+	const int index = bufferIndex(target);
+	if (index < 0) {
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (buffer == mBuffers[index]) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glBindBuffer(target, buffer);
+	mBuffers[index] = buffer;
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	// the indexed points are not cached, the generic binding changes too
+	glBindBufferBase(target, index, buffer);
+	const int i = bufferIndex(target);
+	if (i >= 0)
+		mBuffers[i] = buffer;
+}
+
+
+void GLState::deleteBuffers(GLsizei n, const GLuint* buffers) {
+	glDeleteBuffers(n, buffers);
+	// deleting a bound buffer binds 0 in its place
+	for (GLsizei i = 0; i < n; i++) {
+		for (GLuint& bound : mBuffers) {
+			if (bound == buffers[i])
+				bound = 0;
+		}
+	}
+}
+
+
+void GLState::activeTexture(GLuint unit) {
+	if (unit == mActiveUnit)
+		return;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	mActiveUnit = unit;
+}
+
+
+void GLState::bindTexture(GLuint unit, GLuint texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		mActiveUnit = UNKNOWN;
+		RENDER_STATS_TEXTURE_BIND();
+		return;
+	}
+
+	activeTexture(unit);
+	if (texture == mTextures[unit]) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	mTextures[unit] = texture;
+	RENDER_STATS_TEXTURE_BIND();
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::unbindTexture() {
+	if (mActiveUnit == UNKNOWN) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+		activeTexture(0);
+		return;
+	}
+	bindTexture(mActiveUnit, 0);
+	activeTexture(0);
+}
+
+
+void GLState::deleteTexture(GLuint texture) {
+	glDeleteTextures(1, &texture);
+	// deleting a bound texture binds 0 in its place
+	for (GLuint& bound : mTextures) {
+		if (bound == texture)
+			bound = 0;
+	}
+}
+
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+	const int index = capabilityIndex(capability);
+	const GLuint value = enabled? GL_TRUE : GL_FALSE;
+	if (index >= 0 && mCapabilities[index] == value) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+	if (index >= 0) {
+		mCapabilities[index] = value;
+		if (mIsValidating)
+			validate();
+	}
+}
+
+
+void GLState::blendFunc(GLenum source, GLenum destination) {
+	if (source == mBlendSource && destination == mBlendDestination) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glBlendFunc(source, destination);
+	mBlendSource = source;
+	mBlendDestination = destination;
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::depthMask(GLboolean mask) {
+	const GLuint value = mask? GL_TRUE : GL_FALSE;
+	if (value == mDepthMask) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glDepthMask(mask);
+	mDepthMask = value;
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::cullFace(GLenum face) {
+	if (face == mCullFace) {
+		RENDER_STATS_STATE_SKIPPED();
+		return;
+	}
+	glCullFace(face);
+	mCullFace = face;
+	if (mIsValidating)
+		validate();
+}
+
+
+void GLState::setValidating(bool validating) {
+	mIsValidating = validating;
+	if (validating)
+		validate();
+}
+
+
+void GLState::check(const char* name, GLuint& cached, GLuint actual) {
+	if (cached == UNKNOWN || cached == actual)
+		return;
+	Log::error("GL state out of sync: %s is %u, cached %u", name, actual, cached);
+	cached = actual;
+}
+
+
+void GLState::validate() {
+	static const char* bufferNames[BUFFER_TARGET_COUNT] = { "array buffer", "element array buffer", "uniform buffer", "pixel unpack buffer" };
+	static const GLenum bufferBindings[BUFFER_TARGET_COUNT] = {
+		GL_ARRAY_BUFFER_BINDING, GL_ELEMENT_ARRAY_BUFFER_BINDING, GL_UNIFORM_BUFFER_BINDING, GL_PIXEL_UNPACK_BUFFER_BINDING
+	};
+	static const char* capabilityNames[CAPABILITY_COUNT] = { "blend", "cull face", "depth test", "multisample", "scissor test" };
+
+	auto value = [](GLenum pname) {
+		GLint v = 0;
+		glGetIntegerv(pname, &v);
+		return static_cast<GLuint>(v);
+	};
+
+	check("program", mProgram, value(GL_CURRENT_PROGRAM));
+	check("vertex array", mVertexArray, value(GL_VERTEX_ARRAY_BINDING));
+	for (int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		check(bufferNames[i], mBuffers[i], value(bufferBindings[i]));
+
+	const GLuint activeUnit = value(GL_ACTIVE_TEXTURE) - GL_TEXTURE0;
+	check("active texture unit", mActiveUnit, activeUnit);
+	for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		if (mTextures[unit] == UNKNOWN)
+			continue;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		char name[32];
+		snprintf(name, sizeof(name), "texture unit %u", unit);
+		check(name, mTextures[unit], value(GL_TEXTURE_BINDING_2D));
+	}
+	glActiveTexture(GL_TEXTURE0 + activeUnit);
+
+	for (int i = 0; i < CAPABILITY_COUNT; i++)
+		check(capabilityNames[i], mCapabilities[i], glIsEnabled(CAPABILITIES[i]));
+	check("blend source", mBlendSource, value(GL_BLEND_SRC_RGB));
+	check("blend destination", mBlendDestination, value(GL_BLEND_DST_RGB));
+	check("depth mask", mDepthMask, value(GL_DEPTH_WRITEMASK));
+	check("cull face", mCullFace, value(GL_CULL_FACE_MODE));
+}
@@ -0,0 +1,102 @@
+#ifndef GAMEDEV3D_GL_STATE_H
+#define GAMEDEV3D_GL_STATE_H
+
+#include "GLHeaders.h"
+
+/**
+ * Shadow copy of the GL state the renderer changes per object: the program, the vertex
+ * array, the buffer bindings, the 2D texture of each unit, the capabilities, the blend
+ * function, the depth mask and the culled face. A call that does not change the state is
+ * dropped, so objects can keep setting what they need without knowing the previous one.
+ *
+ * Every change of this state must go through here, code that calls GL directly must call
+ * invalidate() afterwards. With validation on, each call compares the cache with glGet
+ * and logs the differences, it is slow and meant for debugging ("glstate" command).
+ * GL thread only.
+ */
+
+class GLState {
+public:
+	static constexpr const unsigned int MAX_TEXTURE_UNITS = 16;
+
+private:
+	static constexpr const GLuint UNKNOWN = static_cast<GLuint>(-1);
+
+	enum Capability { BLEND, CULL_FACE, DEPTH_TEST, MULTISAMPLE, SCISSOR_TEST, CAPABILITY_COUNT };
+	static constexpr const GLenum CAPABILITIES[CAPABILITY_COUNT] = {
+		GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_MULTISAMPLE, GL_SCISSOR_TEST
+	};
+
+	enum BufferTarget { ARRAY, ELEMENT_ARRAY, UNIFORM, PIXEL_UNPACK, BUFFER_TARGET_COUNT };
+	static constexpr const GLenum BUFFER_TARGETS[BUFFER_TARGET_COUNT] = {
+		GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER
+	};
+
+	GLuint mProgram;
+	GLuint mVertexArray;
+	GLuint mBuffers[BUFFER_TARGET_COUNT];
+	GLuint mActiveUnit;
+	GLuint mTextures[MAX_TEXTURE_UNITS];
+	GLuint mCapabilities[CAPABILITY_COUNT]; // GL_TRUE, GL_FALSE or UNKNOWN
+	GLuint mBlendSource;
+	GLuint mBlendDestination;
+	GLuint mDepthMask;
+	GLuint mCullFace;
+	bool mIsValidating;
+
+	GLState();
+	static int capabilityIndex(GLenum capability) noexcept;
+	static int bufferIndex(GLenum target) noexcept;
+	void activeTexture(GLuint unit);
+	void check(const char* name, GLuint& cached, GLuint actual);
+
+public:
+	static GLState& get();
+
+	void useProgram(GLuint program);
+	/** the program stays bound until the next one, unbound only when validating */
+	void releaseProgram();
+	void deleteProgram(GLuint program);
+
+	/** the element buffer binding belongs to the vertex array, it is forgotten */
+	void bindVertexArray(GLuint vertexArray);
+	void deleteVertexArrays(GLsizei n, const GLuint* vertexArrays);
+
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void deleteBuffers(GLsizei n, const GLuint* buffers);
+
+	/** GL_TEXTURE_2D of the unit, the unit becomes the active one */
+	void bindTexture(GLuint unit, GLuint texture);
+	/** of the active unit, then the unit 0 becomes the active one */
+	void unbindTexture();
+	void deleteTexture(GLuint texture);
+
+	void setEnabled(GLenum capability, bool enabled);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void blendFunc(GLenum source, GLenum destination);
+	void depthMask(GLboolean mask);
+	void cullFace(GLenum face);
+
+	/** forgets everything, the next calls are issued */
+	void invalidate();
+
+	void setValidating(bool validating);
+	bool isValidating() const noexcept;
+	/** logs the cached values that differ from the GL ones and takes the GL ones */
+	void validate();
+};
+
+//-----------------------------------------------------------------------------
+
+inline void GLState::enable(GLenum capability)
+{ setEnabled(capability, true); }
+
+inline void GLState::disable(GLenum capability)
+{ setEnabled(capability, false); }
+
+inline bool GLState::isValidating() const noexcept
+{ return mIsValidating; }
+
+#endif
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+#include "GpuProfiler.h"
+#include "Log.h"
+
+
+GpuProfiler::GpuProfiler():
+	mEnabled(false),
+	mFrame(0),
+	mWindowStart(Profiler::Clock::now()),
+	mWindowFrames(0)
+{}
+
+
+GpuProfiler& GpuProfiler::get() {
+	// the queries are not deleted, the GL context is gone when static objects are destroyed
+	static GpuProfiler profiler;
+	return profiler;
+}
+
+
+void GpuProfiler::setEnabled(bool enabled) {
+	mEnabled = enabled;
+	if (!enabled) {
+		for (Frame& frame : mFrames)
+			frame.scopes.clear();
+		mTimes.clear();
+		mTotals.clear();
+		mWindowFrames = 0;
+	}
+}
+
+
+GLuint GpuProfiler::nextQuery(Frame& frame) {
+	if (frame.usedQueries == frame.queries.size()) {
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+	return frame.queries[frame.usedQueries++];
+}
+
+
+unsigned int GpuProfiler::begin(const char* name) {
+	if (!mEnabled)
+		return NO_SCOPE;
+
+	Frame& frame = mFrames[mFrame % FRAMES_IN_FLIGHT];
+	// timestamps rather than GL_TIME_ELAPSED, which can't be nested
+	const GLuint query = nextQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.scopes.push_back({ name, query, 0 });
+	return static_cast<unsigned int>(frame.scopes.size() - 1);
+}
+
+
+void GpuProfiler::end(unsigned int scope) {
+	if (scope == NO_SCOPE || !mEnabled)
+		return;
+
+	Frame& frame = mFrames[mFrame % FRAMES_IN_FLIGHT];
+	const GLuint query = nextQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.scopes[scope].end = query;
+}
+
+
+void GpuProfiler::collect(Frame& frame) {
+	if (frame.scopes.empty())
+		return;
+
+	// the last query is the last one to complete, if it is not ready the GPU is more
+	// than FRAMES_IN_FLIGHT frames behind and the frame is dropped rather than waited for
+	GLint isAvailable = 0;
+	glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+	if (isAvailable) {
+		for (const Scope& scope : frame.scopes) {
+			if (scope.end == 0)
+				continue;
+
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+			const float ms = (end - begin) * 0.000001f;
+
+			auto total = std::find_if(mTotals.begin(), mTotals.end(), [&scope](const Profiler::PassTime& t){
+				return t.name == scope.name || std::strcmp(t.name, scope.name) == 0;
+			});
+			if (total != mTotals.end())
+				total->ms += ms;
+			else
+				mTotals.push_back({ scope.name, ms });
+		}
+		mWindowFrames++;
+	}
+
+	frame.scopes.clear();
+	frame.usedQueries = 0;
+}
+
+
+void GpuProfiler::endFrame() {
+	if (!mEnabled)
+		return;
+
+	// the slot of the next frame was used FRAMES_IN_FLIGHT frames ago
+	mFrame++;
+	collect(mFrames[mFrame % FRAMES_IN_FLIGHT]);
+
+	const Profiler::Clock::time_point now = Profiler::Clock::now();
+	if (now - mWindowStart < std::chrono::seconds(1) || mWindowFrames == 0)
+		return;
+
+	mTimes = mTotals;
+	for (Profiler::PassTime& time : mTimes)
+		time.ms /= mWindowFrames;
+
+	for (Profiler::PassTime& total : mTotals)
+		total.ms = 0.f;
+	mWindowFrames = 0;
+	mWindowStart = now;
+}
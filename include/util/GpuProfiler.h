@@ -0,0 +1,91 @@
+#ifndef GAMEDEV3D_GPU_PROFILER_H
+#define GAMEDEV3D_GPU_PROFILER_H
+
+#include "GLHeaders.h"
+#include <vector>
+#include "Profiler.h"
+
+/**
+ * GPU time of the render passes and of the big objects, measured with GL timestamp queries.
+ * The queries of a frame are read FRAMES_IN_FLIGHT frames later, when the GPU is done with
+ * them, so the CPU never waits. Results are averaged over a second like the CPU passes.
+ *
+ * Disabled until setEnabled(true) ("gpuprof 1"). GPU_PROFILE_SCOPE compiles to nothing
+ * without GAMEDEV3D_PROFILER. Main (GL) thread only.
+ */
+
+class GpuProfiler {
+	static constexpr const unsigned int FRAMES_IN_FLIGHT = 4;
+	static constexpr const unsigned int NO_SCOPE = static_cast<unsigned int>(-1);
+
+	typedef struct {
+		const char* name;
+		GLuint begin;
+		GLuint end;
+	} Scope;
+
+	// timestamp queries are reused, a pair per scope
+	struct Frame {
+		std::vector<GLuint> queries;
+		size_t usedQueries = 0;
+		std::vector<Scope> scopes;
+	};
+
+	bool mEnabled;
+	unsigned int mFrame;
+	Frame mFrames[FRAMES_IN_FLIGHT];
+
+	// totals of the current second, published in mTimes
+	Profiler::Clock::time_point mWindowStart;
+	unsigned int mWindowFrames;
+	std::vector<Profiler::PassTime> mTotals;
+	std::vector<Profiler::PassTime> mTimes;
+
+	GpuProfiler();
+	GLuint nextQuery(Frame& frame);
+	void collect(Frame& frame);
+
+public:
+	static GpuProfiler& get();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const noexcept;
+
+	unsigned int begin(const char* name);
+	void end(unsigned int scope);
+	void endFrame();
+
+	/** GPU ms per frame, averaged over the last second */
+	const std::vector<Profiler::PassTime>& getTimes() const noexcept;
+};
+
+
+class GpuProfileScope {
+	unsigned int mScope;
+public:
+	explicit GpuProfileScope(const char* name):
+		mScope(GpuProfiler::get().begin(name))
+	{}
+
+	~GpuProfileScope()
+	{ GpuProfiler::get().end(mScope); }
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool GpuProfiler::isEnabled() const noexcept
+{ return mEnabled; }
+
+inline const std::vector<Profiler::PassTime>& GpuProfiler::getTimes() const noexcept
+{ return mTimes; }
+
+
+#ifdef GAMEDEV3D_PROFILER
+#define GPU_PROFILE_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __COUNTER__)(name)
+#define GPU_PROFILE_END_FRAME() GpuProfiler::get().endFrame()
+#else
+#define GPU_PROFILE_SCOPE(name)
+#define GPU_PROFILE_END_FRAME()
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef GAMEDEV3D_INTERPOLATED_MOTION_STATE_H
+#define GAMEDEV3D_INTERPOLATED_MOTION_STATE_H
+
+#include <LinearMath/btDefaultMotionState.h>
+
+/**
+ * Motion state that keeps the transforms of the last two simulation ticks.
+ * m_graphicsWorldTrans is blended between them before rendering, so the scene
+ * moves smoothly even when the frame rate and the tick rate differ.
+ *
+ * storeTick() belongs to the simulation, interpolate() to the renderer and
+ * capture() copies from one side to the other while the simulation is idle.
+ */
+
+class InterpolatedMotionState: public btDefaultMotionState {
+	btTransform mPreviousTrans;
+	btTransform mCurrentTrans;
+	btTransform mCapturedPreviousTrans;
+	btTransform mCapturedCurrentTrans;
+public:
+	explicit InterpolatedMotionState(const btTransform& startTrans = btTransform::getIdentity()):
+		btDefaultMotionState(startTrans),
+		mPreviousTrans(startTrans),
+		mCurrentTrans(startTrans),
+		mCapturedPreviousTrans(startTrans),
+		mCapturedCurrentTrans(startTrans)
+	{}
+
+	// Bullet extrapolates the transform it pushes here, the ticks are stored by storeTick() instead
+	virtual void setWorldTransform(const btTransform& centerOfMassWorldTrans) override {}
+
+	void storeTick(const btTransform& centerOfMassWorldTrans);
+	void capture();
+	void teleport(const btTransform& centerOfMassWorldTrans);
+	void interpolate(btScalar alpha);
+
+	static btTransform interpolate(const btTransform& from, const btTransform& to, btScalar alpha);
+};
+
+//-----------------------------------------------------------------------------
+
+inline void InterpolatedMotionState::storeTick(const btTransform& centerOfMassWorldTrans) {
+	mPreviousTrans = mCurrentTrans;
+	mCurrentTrans = centerOfMassWorldTrans;
+}
+
+inline void InterpolatedMotionState::capture() {
+	mCapturedPreviousTrans = mPreviousTrans;
+	mCapturedCurrentTrans = mCurrentTrans;
+}
+
+inline void InterpolatedMotionState::teleport(const btTransform& centerOfMassWorldTrans) {
+	mPreviousTrans = mCurrentTrans = centerOfMassWorldTrans;
+	mCapturedPreviousTrans = mCapturedCurrentTrans = centerOfMassWorldTrans;
+	m_graphicsWorldTrans = centerOfMassWorldTrans * m_centerOfMassOffset;
+}
+
+inline void InterpolatedMotionState::interpolate(btScalar alpha) {
+	m_graphicsWorldTrans = interpolate(mCapturedPreviousTrans, mCapturedCurrentTrans, alpha) * m_centerOfMassOffset;
+}
+
+inline btTransform InterpolatedMotionState::interpolate(const btTransform& from, const btTransform& to, btScalar alpha) {
+	const btVector3& origin = from.getOrigin().lerp(to.getOrigin(), alpha);
+	const btQuaternion& rotation = from.getRotation().slerp(to.getRotation(), alpha);
+	return btTransform(rotation, origin);
+}
+
+#endif
@@ -42,6 +42,23 @@ const std::string& IoUtils::getCurrentFolder() {
 }
 
 
+const std::string& IoUtils::getCacheFolder() {
+	static std::string cachePath;
+	static bool initialized = false;
+	if (!initialized) {
+		initialized = true;
+		char* path = SDL_GetPrefPath("gamedev3d", "cache");
+		if (path) {
+			cachePath = path;
+			SDL_free(path);
+		} else {
+			Log::error("No cache folder: %s", SDL_GetError());
+		}
+	}
+	return cachePath;
+}
+
+
 const std::string IoUtils::resource(const std::string& path) {
 	return getCurrentFolder() + "/res" + path;
 }
@@ -8,6 +8,8 @@ public:
 	static bool fileExists(const std::string& filename);
 	static std::string readFile(const std::string& filename);
 	static const std::string& getCurrentFolder();
+	/** user writable folder for generated files, with the trailing separator, empty if unavailable */
+	static const std::string& getCacheFolder();
 	static const std::string resource(const std::string& path);
 };
 
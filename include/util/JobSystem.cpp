@@ -0,0 +1,201 @@
+#include <algorithm>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// queue of the current thread, 0 for the threads that are not workers
+static thread_local unsigned int tQueueIndex = 0;
+
+
+JobSystem::JobSystem(unsigned int workerCount):
+	mStop(false),
+	mQueuedJobs(0)
+{
+	if (workerCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i <= workerCount; i++)
+		mQueues.push_back(std::make_unique<WorkQueue>());
+
+	for (unsigned int i = 1; i <= workerCount; i++)
+		mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+
+	Log::info("Job system started with %u workers", workerCount);
+}
+
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStop = true;
+	}
+	mSleepCondition.notify_all();
+
+	for (auto& worker : mWorkers)
+		worker.join();
+}
+
+
+JobHandle JobSystem::submit(Job job, const std::vector<JobHandle>& dependencies) {
+	JobHandle handle = std::make_shared<JobState>();
+	handle->job = std::move(job);
+
+	for (const auto& dependency : dependencies) {
+		if (!dependency)
+			continue;
+
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->done) {
+			handle->pendingDependencies++;
+			dependency->continuations.push_back(handle);
+		}
+	}
+
+	// release the guard taken at creation, the last dependency to finish schedules the job
+	if (--handle->pendingDependencies == 0)
+		schedule(handle);
+
+	return handle;
+}
+
+
+void JobSystem::schedule(const JobHandle& handle) {
+	WorkQueue& queue = *mQueues[tQueueIndex];
+	mQueuedJobs++;
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(handle);
+	}
+
+	// lock so a worker cannot miss the notification between its check and its wait
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mSleepCondition.notify_one();
+}
+
+
+void JobSystem::execute(const JobHandle& handle) {
+	{
+		PROFILE_SCOPE("job");
+		handle->job();
+	}
+	handle->job = nullptr;
+
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(handle->mutex);
+		handle->done = true;
+		continuations.swap(handle->continuations);
+	}
+
+	for (auto& continuation : continuations) {
+		if (--continuation->pendingDependencies == 0)
+			schedule(continuation);
+	}
+}
+
+
+JobHandle JobSystem::pop(unsigned int queueIndex) {
+	WorkQueue& queue = *mQueues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty())
+		return nullptr;
+
+	JobHandle handle = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	mQueuedJobs--;
+	return handle;
+}
+
+
+JobHandle JobSystem::steal(unsigned int queueIndex) {
+	const unsigned int queueCount = static_cast<unsigned int>(mQueues.size());
+	for (unsigned int i = 1; i < queueCount; i++) {
+		WorkQueue& queue = *mQueues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+
+		JobHandle handle = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		mQueuedJobs--;
+		return handle;
+	}
+	return nullptr;
+}
+
+
+bool JobSystem::runPendingJob() {
+	JobHandle handle = pop(tQueueIndex);
+	if (!handle)
+		handle = steal(tQueueIndex);
+	if (!handle)
+		return false;
+
+	execute(handle);
+	return true;
+}
+
+
+void JobSystem::workerLoop(unsigned int queueIndex) {
+	tQueueIndex = queueIndex;
+	PROFILE_THREAD("worker " + std::to_string(queueIndex));
+
+	while (!mStop) {
+		if (runPendingJob())
+			continue;
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mSleepCondition.wait(lock, [this](){ return mStop || mQueuedJobs > 0; });
+	}
+}
+
+
+void JobSystem::wait(const JobHandle& handle) {
+	while (!isDone(handle)) {
+		if (!runPendingJob())
+			std::this_thread::yield();
+	}
+}
+
+
+void JobSystem::parallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, const RangeJob& job) {
+	if (begin >= end)
+		return;
+
+	grainSize = std::max(grainSize, 1u);
+	if (end - begin <= grainSize) {
+		job(begin, end);
+		return;
+	}
+
+	std::vector<JobHandle> chunks;
+	chunks.reserve((end - begin) / grainSize + 1);
+	for (unsigned int first = begin; first < end; first += grainSize) {
+		unsigned int last = std::min(first + grainSize, end);
+		chunks.push_back(submit([&job, first, last](){ job(first, last); }));
+	}
+
+	for (auto& chunk : chunks)
+		wait(chunk);
+}
+
+
+void JobSystem::runOnMainThread(Job job) {
+	std::lock_guard<std::mutex> lock(mMainThreadMutex);
+	mMainThreadJobs.push_back(std::move(job));
+}
+
+
+void JobSystem::runMainThreadJobs() {
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mMainThreadMutex);
+		jobs.swap(mMainThreadJobs);
+	}
+
+	for (auto& job : jobs)
+		job();
+}
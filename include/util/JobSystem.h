@@ -0,0 +1,78 @@
+#ifndef GAMEDEV3D_JOB_SYSTEM_H
+#define GAMEDEV3D_JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../app/Interfaces.h"
+
+
+struct JobState {
+	IJobSystem::Job job;
+	std::atomic<int> pendingDependencies {1};
+	std::atomic<bool> done {false};
+
+	// jobs waiting for this one, guarded by mutex
+	std::mutex mutex;
+	std::vector<JobHandle> continuations;
+};
+
+/**
+ * Fixed pool of workers, each one with its own deque. A worker pops its newest
+ * job first and steals the oldest job of the others when it runs out of work.
+ * Threads that are not workers (main, simulation) push to a shared deque.
+ */
+
+class JobSystem: public IJobSystem {
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	// index 0 is shared by the threads that are not workers
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+	std::vector<std::thread> mWorkers;
+	std::atomic<bool> mStop;
+
+	// sleeping workers are woken up when a job is pushed
+	std::mutex mSleepMutex;
+	std::condition_variable mSleepCondition;
+	std::atomic<unsigned int> mQueuedJobs;
+
+	std::mutex mMainThreadMutex;
+	std::vector<Job> mMainThreadJobs;
+
+	void workerLoop(unsigned int queueIndex);
+	void schedule(const JobHandle& handle);
+	void execute(const JobHandle& handle);
+	bool runPendingJob();
+	JobHandle pop(unsigned int queueIndex);
+	JobHandle steal(unsigned int queueIndex);
+public:
+	/** 0 workers picks one less than the hardware threads */
+	explicit JobSystem(unsigned int workerCount = 0);
+	virtual ~JobSystem();
+
+	virtual JobHandle submit(Job job, const std::vector<JobHandle>& dependencies = {}) override;
+	virtual void wait(const JobHandle& handle) override;
+	virtual bool isDone(const JobHandle& handle) const override;
+	virtual void parallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, const RangeJob& job) override;
+
+	virtual void runOnMainThread(Job job) override;
+	virtual void runMainThreadJobs() override;
+
+	virtual unsigned int getWorkerCount() const noexcept override;
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool JobSystem::isDone(const JobHandle& handle) const
+{ return !handle || handle->done.load(); }
+
+inline unsigned int JobSystem::getWorkerCount() const noexcept
+{ return static_cast<unsigned int>(mWorkers.size()); }
+
+#endif
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Log.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr const uint32_t RECORDS_PER_THREAD = 1024; // power of 2
+
+// single producer (the owner thread), single consumer (the writer thread)
+struct LogBuffer {
+	std::atomic<uint32_t> head {0}; // next record to write
+	std::atomic<uint32_t> tail {0}; // next record to print
+	std::vector<Log::Record> records = std::vector<Log::Record>(RECORDS_PER_THREAD);
+};
+
+
+class LogWriter {
+	std::mutex mBuffersMutex;
+	std::vector<std::unique_ptr<LogBuffer>> mBuffers;
+
+	std::mutex mWakeMutex;
+	std::condition_variable mWake;
+	bool mStopping;
+	std::thread mThread;
+
+	// the clock time is formatted once per second
+	std::mutex mOutputMutex;
+	std::chrono::system_clock::time_point mSystemStart;
+	Clock::time_point mStart;
+	time_t mCachedSecond;
+	char mCachedTime[16];
+
+	typedef struct {
+		int64_t ticks;
+		int level;
+		std::string text;
+	} Line;
+	std::vector<Line> mLines;
+
+	void run();
+	bool drain();
+	void write(int64_t ticks, int level, const char* text);
+
+public:
+	LogWriter();
+	~LogWriter();
+
+	LogBuffer& getBuffer();
+	void wake();
+	void flush();
+	void print(int level, const char* text);
+};
+
+// 0 not started, 1 running, 2 stopped (static destruction)
+static std::atomic<int> gState {0};
+static thread_local LogBuffer* tBuffer = nullptr;
+
+
+static LogWriter& getWriter() {
+	static LogWriter writer;
+	return writer;
+}
+
+
+LogWriter::LogWriter():
+	mStopping(false),
+	mSystemStart(std::chrono::system_clock::now()),
+	mStart(Clock::now()),
+	mCachedSecond(0)
+{
+	mCachedTime[0] = '\0';
+	gState = 1;
+	mThread = std::thread(&LogWriter::run, this);
+}
+
+
+LogWriter::~LogWriter() {
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mStopping = true;
+	}
+	mWake.notify_one();
+	mThread.join();
+	gState = 2;
+}
+
+
+LogBuffer& LogWriter::getBuffer() {
+	if (!tBuffer) {
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		mBuffers.push_back(std::make_unique<LogBuffer>());
+		tBuffer = mBuffers.back().get();
+	}
+	return *tBuffer;
+}
+
+
+void LogWriter::wake() {
+	mWake.notify_one();
+}
+
+
+void LogWriter::run() {
+	while (true) {
+		bool stopping;
+		{
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWake.wait_for(lock, std::chrono::milliseconds(5), [this]{ return mStopping; });
+			stopping = mStopping;
+		}
+		while (drain());
+
+		if (stopping) {
+			// later messages are printed by their own thread
+			gState = 2;
+			while (drain());
+			return;
+		}
+	}
+}
+
+
+bool LogWriter::drain() {
+	std::vector<LogBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		for (auto& buffer : mBuffers)
+			buffers.push_back(buffer.get());
+	}
+
+	mLines.clear();
+	for (LogBuffer* buffer : buffers) {
+		const uint32_t head = buffer->head.load(std::memory_order_acquire);
+		uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+		for (; tail != head; tail++) {
+			const Log::Record& record = buffer->records[tail & (RECORDS_PER_THREAD - 1)];
+			mLines.push_back({ record.ticks, record.level, std::string() });
+			Log::format(record, mLines.back().text);
+		}
+		buffer->tail.store(tail, std::memory_order_release);
+	}
+
+	// the order of each thread is kept, the threads are interleaved by time
+	std::stable_sort(mLines.begin(), mLines.end(), [](const Line& a, const Line& b){ return a.ticks < b.ticks; });
+	std::lock_guard<std::mutex> lock(mOutputMutex);
+	for (const Line& line : mLines)
+		write(line.ticks, line.level, line.text.c_str());
+	fflush(stdout);
+	fflush(stderr);
+	return !mLines.empty();
+}
+
+
+void LogWriter::write(int64_t ticks, int level, const char* text) {
+	const auto elapsed = std::chrono::duration_cast<std::chrono::system_clock::duration>(Clock::duration(ticks) - mStart.time_since_epoch());
+	const time_t second = std::chrono::system_clock::to_time_t(mSystemStart + elapsed);
+	if (second != mCachedSecond) {
+		struct tm current;
+		localtime_r(&second, &current);
+		snprintf(mCachedTime, sizeof(mCachedTime), "[%02i:%02i:%02i] ", current.tm_hour, current.tm_min, current.tm_sec);
+		mCachedSecond = second;
+	}
+
+	FILE* out = level == Log::LEVEL_ERROR? stderr : stdout;
+	fputs(mCachedTime, out);
+	if (level == Log::LEVEL_DEBUG)
+		fputs("DEBUG ", out);
+	fputs(text, out);
+	fputc('\n', out);
+}
+
+
+void LogWriter::print(int level, const char* text) {
+	std::lock_guard<std::mutex> lock(mOutputMutex);
+	write(Clock::now().time_since_epoch().count(), level, text);
+	fflush(level == Log::LEVEL_ERROR? stderr : stdout);
+}
+
+
+void LogWriter::flush() {
+	std::vector<std::pair<LogBuffer*, uint32_t>> pending;
+	{
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		for (auto& buffer : mBuffers)
+			pending.push_back({ buffer.get(), buffer->head.load(std::memory_order_acquire) });
+	}
+
+	for (auto& p : pending) {
+		// distance, the counters wrap around
+		while (gState == 1 && static_cast<int32_t>(p.second - p.first->tail.load(std::memory_order_acquire)) > 0) {
+			wake();
+			std::this_thread::yield();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+Log::Record* Log::beginRecord(int level) {
+	if (gState == 2)
+		return nullptr;
+
+	LogWriter& writer = getWriter();
+	LogBuffer& buffer = writer.getBuffer();
+	const uint32_t head = buffer.head.load(std::memory_order_relaxed);
+
+	// full: wait for the writer rather than losing messages
+	while (head - buffer.tail.load(std::memory_order_acquire) >= RECORDS_PER_THREAD) {
+		if (gState != 1)
+			return nullptr;
+		writer.wake();
+		std::this_thread::yield();
+	}
+
+	Record& record = buffer.records[head & (RECORDS_PER_THREAD - 1)];
+	record.ticks = Clock::now().time_since_epoch().count();
+	record.level = static_cast<uint8_t>(level);
+	record.size = 0;
+	return &record;
+}
+
+
+void Log::commitRecord() {
+	tBuffer->head.fetch_add(1, std::memory_order_release);
+}
+
+
+void Log::print(int level, const char* text) {
+	if (gState == 2) {
+		// no writer any more, the output is not shared with another thread
+		fprintf(level == LEVEL_ERROR? stderr : stdout, "%s%s\n", level == LEVEL_DEBUG? "DEBUG " : "", text);
+		return;
+	}
+	// after the messages already queued by this thread
+	flush();
+	getWriter().print(level, text);
+}
+
+
+void Log::flush() {
+	if (gState == 1)
+		getWriter().flush();
+}
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+class RecordReader {
+	const Log::Record& mRecord;
+	size_t mOffset;
+
+public:
+	RecordReader(const Log::Record& record):
+		mRecord(record),
+		mOffset(0)
+	{}
+
+	const char* readString() {
+		const char* s = mRecord.data + mOffset;
+		mOffset += std::strlen(s) + 1;
+		return s;
+	}
+
+	/** false when there are no more arguments */
+	bool next(char& type) {
+		if (mOffset >= mRecord.size)
+			return false;
+		type = mRecord.data[mOffset++];
+		return true;
+	}
+
+	template <typename T> T read() {
+		T value;
+		std::memcpy(&value, mRecord.data + mOffset, sizeof(T));
+		mOffset += sizeof(T);
+		return value;
+	}
+};
+
+typedef struct {
+	char type; // 0 when missing
+	int64_t i;
+	uint64_t u;
+	double d;
+	const char* s;
+	const void* p;
+} Arg;
+
+
+Arg readArg(RecordReader& reader) {
+	Arg arg = { 0, 0, 0, 0.0, nullptr, nullptr };
+	if (!reader.next(arg.type))
+		return arg;
+
+	switch (arg.type) {
+		case Log::ARG_INT: arg.i = reader.read<int64_t>(); arg.u = static_cast<uint64_t>(arg.i); arg.d = static_cast<double>(arg.i); break;
+		case Log::ARG_UINT: arg.u = reader.read<uint64_t>(); arg.i = static_cast<int64_t>(arg.u); arg.d = static_cast<double>(arg.u); break;
+		case Log::ARG_DOUBLE: arg.d = reader.read<double>(); arg.i = static_cast<int64_t>(arg.d); arg.u = static_cast<uint64_t>(arg.i); break;
+		case Log::ARG_STRING: arg.s = reader.readString(); break;
+		case Log::ARG_POINTER: arg.p = reader.read<const void*>(); arg.u = reinterpret_cast<uintptr_t>(arg.p); break;
+	}
+	return arg;
+}
+
+
+template <typename T>
+void append(std::string& out, const std::string& spec, T value) {
+	char buffer[128];
+	const int length = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+	if (length < static_cast<int>(sizeof(buffer))) {
+		out.append(buffer, std::max(length, 0));
+	} else {
+		std::string big(length, '\0');
+		snprintf(&big[0], big.size() + 1, spec.c_str(), value);
+		out += big;
+	}
+}
+
+}
+
+
+void Log::format(const Record& record, std::string& out) {
+	RecordReader reader(record);
+	const char* msg = reader.readString();
+
+	for (const char* c = msg; *c; c++) {
+		if (*c != '%') {
+			out += *c;
+			continue;
+		}
+		if (*(c + 1) == '%') {
+			out += '%';
+			c++;
+			continue;
+		}
+
+		// %[flags][width][.precision][length]conversion, the length is replaced by the type of the argument
+		std::string spec("%");
+		for (c++; *c && std::strchr("-+ #0", *c); c++)
+			spec += *c;
+		for (; *c && (std::isdigit(*c) || *c == '*'); c++) {
+			if (*c == '*')
+				spec += std::to_string(readArg(reader).i);
+			else
+				spec += *c;
+		}
+		if (*c == '.') {
+			spec += *c;
+			for (c++; *c && (std::isdigit(*c) || *c == '*'); c++) {
+				if (*c == '*')
+					spec += std::to_string(readArg(reader).i);
+				else
+					spec += *c;
+			}
+		}
+		std::string length;
+		for (; *c && std::strchr("hlLqjzt", *c); c++)
+			length += *c;
+		if (!*c)
+			break;
+
+		const Arg arg = readArg(reader);
+		if (arg.type == 0) {
+			out += "<?>";
+			continue;
+		}
+
+		const char conversion = *c;
+		const bool isLong = !length.empty() && length != "h" && length != "hh";
+		switch (conversion) {
+			case 'd':
+			case 'i':
+				if (isLong)
+					append(out, spec + "lld", static_cast<long long>(arg.i));
+				else if (length == "hh")
+					append(out, spec + "d", static_cast<int>(static_cast<signed char>(arg.i)));
+				else if (length == "h")
+					append(out, spec + "d", static_cast<int>(static_cast<short>(arg.i)));
+				else
+					append(out, spec + "d", static_cast<int>(arg.i));
+				break;
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				if (isLong)
+					append(out, spec + "ll" + conversion, static_cast<unsigned long long>(arg.u));
+				else if (length == "hh")
+					append(out, spec + conversion, static_cast<unsigned int>(static_cast<unsigned char>(arg.u)));
+				else if (length == "h")
+					append(out, spec + conversion, static_cast<unsigned int>(static_cast<unsigned short>(arg.u)));
+				else
+					append(out, spec + conversion, static_cast<unsigned int>(arg.u));
+				break;
+			case 'c':
+				append(out, spec + "c", static_cast<int>(arg.i));
+				break;
+			case 's':
+				append(out, spec + "s", arg.type == ARG_STRING? arg.s : "<?>");
+				break;
+			case 'p':
+				append(out, spec + "p", arg.type == ARG_POINTER? arg.p : reinterpret_cast<const void*>(static_cast<uintptr_t>(arg.u)));
+				break;
+			case 'n':
+				break;
+			default:
+				if (std::strchr("fFeEgGaA", conversion))
+					append(out, spec + conversion, arg.d);
+				else
+					out += spec + length + conversion; // not a conversion, printed as is
+				break;
+		}
+	}
+}
@@ -1,56 +1,170 @@
 #pragma once
 
-#include <stdio.h>
-#include <stdarg.h>
-#include <time.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
 
-#define DEBUG true
+// 0 = debug, 1 = info, 2 = error: the calls under the level return at once, their
+// arguments are still evaluated
+#ifndef GAMEDEV3D_LOG_LEVEL
+#define GAMEDEV3D_LOG_LEVEL 0
+#endif
+
+/**
+ * Asynchronous logger: a call copies the format and its arguments into a lock-free ring
+ * buffer of the calling thread, a background thread formats, timestamps and prints them.
+ * Errors wait until they are printed (the process may be about to exit).
+ *
+ * Messages too big for a record, and the ones logged while the background thread is not
+ * running (static destruction), are printed on the calling thread.
+ */
 
 class Log
 {
-	static void printTime()
-	{
-		time_t now;
-		time(&now);
-		struct tm *current;
-		current = localtime(&now);
-		printf("[%02i:%02i:%02i] ", current->tm_hour, current->tm_min, current->tm_sec);
+public:
+	static constexpr const int LEVEL_DEBUG = 0;
+	static constexpr const int LEVEL_INFO = 1;
+	static constexpr const int LEVEL_ERROR = 2;
+
+	static constexpr const size_t RECORD_SIZE = 256;
+
+	struct Record {
+		int64_t ticks; // steady clock
+		uint8_t level;
+		uint16_t size; // used bytes of data
+		char data[RECORD_SIZE - sizeof(int64_t) - 2 * sizeof(uint16_t)]; // format, then type and value of each argument
+	};
+
+	enum ArgType: char {
+		ARG_INT = 'i',
+		ARG_UINT = 'u',
+		ARG_DOUBLE = 'd',
+		ARG_STRING = 's',
+		ARG_POINTER = 'p'
+	};
+
+private:
+	static Record* beginRecord(int level);
+	static void commitRecord();
+	static void print(int level, const char* text);
+
+	static bool put(Record& record, const void* value, size_t size) {
+		if (record.size + size > sizeof(record.data))
+			return false;
+		std::memcpy(record.data + record.size, value, size);
+		record.size += static_cast<uint16_t>(size);
+		return true;
+	}
+
+	static bool putString(Record& record, const char* value) {
+		return put(record, value? value : "(null)", std::strlen(value? value : "(null)") + 1);
+	}
+
+	template <typename T>
+	static bool putArg(Record& record, ArgType type, const T& value) {
+		const char t = type;
+		return put(record, &t, 1) && put(record, &value, sizeof(value));
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, bool>::type
+	encodeArg(Record& record, T value)
+	{ return putArg(record, ARG_INT, static_cast<int64_t>(value)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, bool>::type
+	encodeArg(Record& record, T value)
+	{ return putArg(record, ARG_UINT, static_cast<uint64_t>(value)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value, bool>::type
+	encodeArg(Record& record, T value)
+	{ return putArg(record, ARG_INT, static_cast<int64_t>(value)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+	encodeArg(Record& record, T value)
+	{ return putArg(record, ARG_DOUBLE, static_cast<double>(value)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_pointer<T>::value, bool>::type
+	encodeArg(Record& record, T value)
+	{ return putArg(record, ARG_POINTER, static_cast<const void*>(value)); }
+
+	// strings are copied, they may be gone when the record is formatted
+	static bool encodeArg(Record& record, const char* value) {
+		const char t = ARG_STRING;
+		return put(record, &t, 1) && putString(record, value);
+	}
+
+	static bool encodeArg(Record& record, char* value)
+	{ return encodeArg(record, static_cast<const char*>(value)); }
+
+	static bool encodeArg(Record& record, const std::string& value)
+	{ return encodeArg(record, value.c_str()); }
+
+	static bool encodeArgs(Record& /*record*/)
+	{ return true; }
+
+	template <typename T, typename... Args>
+	static bool encodeArgs(Record& record, const T& first, const Args&... rest)
+	{ return encodeArg(record, first) && encodeArgs(record, rest...); }
+
+	template <typename T>
+	static const T& printfArg(const T& value)
+	{ return value; }
+
+	static const char* printfArg(const std::string& value)
+	{ return value.c_str(); }
+
+	static void printNow(int level, const char* msg)
+	{ print(level, msg); }
+
+	template <typename... Args>
+	static void printNow(int level, const char* msg, const Args&... args) {
+		const int length = std::snprintf(nullptr, 0, msg, printfArg(args)...);
+		std::string text(length > 0? length : 0, '\0');
+		std::snprintf(&text[0], text.size() + 1, msg, printfArg(args)...);
+		print(level, text.c_str());
+	}
+
+	template <typename... Args>
+	static void log(int level, const char* msg, const Args&... args) {
+		Record* record = beginRecord(level);
+		if (record && putString(*record, msg) && encodeArgs(*record, args...)) {
+			commitRecord();
+			return;
+		}
+		printNow(level, msg, args...);
 	}
 
 public:
-	static void info(const char* msg, ...)
+	template <typename... Args>
+	static void info(const char* msg, const Args&... args)
 	{
-		printTime();
-		va_list argptr;
-		va_start(argptr, msg);
-		vfprintf(stdout, msg, argptr);
-		fprintf(stdout, "\n");
-		va_end(argptr);
+		if (GAMEDEV3D_LOG_LEVEL <= LEVEL_INFO)
+			log(LEVEL_INFO, msg, args...);
 	}
 
-	static void error(const char* msg, ...)
+	template <typename... Args>
+	static void error(const char* msg, const Args&... args)
 	{
-		printTime();
-		va_list argptr;
-		va_start(argptr, msg);
-		vfprintf(stderr, msg, argptr);
-		fprintf(stderr, "\n");
-		va_end(argptr);
+		log(LEVEL_ERROR, msg, args...);
+		flush();
 	}
 
-	static void debug(const char* msg, ...)
+	template <typename... Args>
+	static void debug(const char* msg, const Args&... args)
 	{
-		if (DEBUG) {
-			printTime();
-			printf("DEBUG ");
-			va_list argptr;
-			va_start(argptr, msg);
-			vfprintf(stdout, msg, argptr);
-			fprintf(stdout, "\n");
-			va_end(argptr);
-		}
+		if (GAMEDEV3D_LOG_LEVEL <= LEVEL_DEBUG)
+			log(LEVEL_DEBUG, msg, args...);
 	}
-};
-
 
+	/** waits until the messages logged so far are printed */
+	static void flush();
 
+	/** printf of a record, on the background thread */
+	static void format(const Record& record, std::string& out);
+};
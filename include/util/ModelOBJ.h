@@ -6,7 +6,7 @@
 #include <string>
 #include <vector>
 
-#include <OpenGL/gl3.h>
+#include "GLHeaders.h"
 #include "LinearMath/btVector3.h"
 
 //-----------------------------------------------------------------------------
@@ -1,11 +1,12 @@
 #include "ModelOBJRenderer.h"
+#include "RenderStats.h"
+#include "TextureCache.h"
 
 static constexpr const char* vsShadow[] = {
 	"attribute vec3 position;"
 
 	"uniform mat4 M;"
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"void main() {"
 		"gl_Position = P * V * M * vec4(position, 1.0);"
@@ -22,8 +23,7 @@ static constexpr const char* vsMaterial[] = {
 	"attribute vec3 normal;"
 
 	"uniform mat4 M;"
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 	"uniform vec3 lightPosition;"
 
 	"varying vec4 eyeV;"
@@ -86,8 +86,7 @@ static constexpr const char* vsColorTexture[] = {
 	"attribute vec2 texCoord;"
 
 	"uniform mat4 M;"
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 	"uniform vec3 lightPosition;"
 
 	,ShadowMap::getVertexShaderCode(),
@@ -158,8 +157,7 @@ static constexpr const char* vsColorNormalTexture[] = {
 	"attribute vec4 tangent;"
 
 	"uniform mat4 M;"
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 	"uniform vec3 lightPosition;"
 
 	,ShadowMap::getVertexShaderCode(),
@@ -231,6 +229,7 @@ std::unique_ptr<IShader> ModelOBJRenderer::gShaderShadow;
 std::unique_ptr<IShader> ModelOBJRenderer::gShaderMaterial;
 std::unique_ptr<IShader> ModelOBJRenderer::gShaderTexture;
 std::unique_ptr<IShader> ModelOBJRenderer::gShaderNormalTexture;
+ModelOBJRenderer::Uniforms ModelOBJRenderer::gUniforms[4];
 
 
 void ModelOBJRenderer::initShaders() {
@@ -256,9 +255,45 @@ void ModelOBJRenderer::initShaders() {
 		gShaderNormalTexture->bindAttribute(2, "texCoord");
 		gShaderNormalTexture->bindAttribute(3, "tangent");
 		gShaderNormalTexture->link();
+
+		gUniforms[0] = resolveUniforms(gShaderShadow.get());
+		gUniforms[1] = resolveUniforms(gShaderMaterial.get());
+		gUniforms[2] = resolveUniforms(gShaderTexture.get());
+		gUniforms[3] = resolveUniforms(gShaderNormalTexture.get());
 	}
 }
 
+
+ModelOBJRenderer::Uniforms ModelOBJRenderer::resolveUniforms(IShader* shader) {
+	Uniforms uniforms;
+	uniforms.M = shader->getUniform("M");
+	// the shadow shader only has M
+	if (shader == gShaderShadow.get())
+		return uniforms;
+
+	uniforms.ambientMaterial = shader->getUniform("ambientMaterial");
+	uniforms.diffuseMaterial = shader->getUniform("diffuseMaterial");
+	uniforms.specularMaterial = shader->getUniform("specularMaterial");
+	uniforms.shininess = shader->getUniform("shininess");
+	uniforms.alpha = shader->getUniform("alpha");
+	if (shader != gShaderMaterial.get())
+		uniforms.colorMap = shader->getUniform("colorMap");
+	if (shader == gShaderNormalTexture.get())
+		uniforms.normalMap = shader->getUniform("normalMap");
+	return uniforms;
+}
+
+
+const ModelOBJRenderer::Uniforms& ModelOBJRenderer::uniformsOf(const IShader* shader) {
+	if (shader == gShaderShadow.get())
+		return gUniforms[0];
+	if (shader == gShaderMaterial.get())
+		return gUniforms[1];
+	if (shader == gShaderTexture.get())
+		return gUniforms[2];
+	return gUniforms[3];
+}
+
 //-----------------------------------------------------------------------------
 
 ModelOBJRenderer::ModelOBJRenderer(const std::string& filename) {
@@ -281,9 +316,10 @@ void ModelOBJRenderer::bind() {
 	int nMeshes = mModel->getNumberOfMeshes();
 
 	auto nodeDeleter = [](RenderNode* node){
-		glDeleteBuffers(1, &node->vbo);
-		glDeleteBuffers(1, &node->ibo);
+		GLState::get().deleteBuffers(1, &node->vbo);
+		GLState::get().deleteBuffers(1, &node->ibo);
 		Log::debug("Deleting RenderNode");
+		delete node;
 	};
 
 	for (int i = 0; i < nMeshes; ++i) {
@@ -296,19 +332,31 @@ void ModelOBJRenderer::bind() {
 		glGenBuffers(1, &node->vbo);
 		glGenBuffers(1, &node->ibo);
 
-		glBindBuffer(GL_ARRAY_BUFFER, node->vbo);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, node->vbo);
 		glBufferData(GL_ARRAY_BUFFER, mModel->getNumberOfVertices() * mModel->getVertexSize(), mModel->getVertexBuffer()->position, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, node->indiceCount * mModel->getIndexSize(), mModel->getIndexBuffer() + pMesh->startIndex, GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		const GLsizei stride = mModel->getVertexSize();
+		node->vertexArray.begin();
+		VertexArray::attribute(0, node->vbo, 3, stride, 0);
+		if (mModel->hasNormals())
+			VertexArray::attribute(1, node->vbo, 3, stride, offsetof(ModelOBJ::Vertex, normal));
+		if (mModel->hasTextureCoords())
+			VertexArray::attribute(2, node->vbo, 2, stride, offsetof(ModelOBJ::Vertex, texCoord));
+		if (mModel->hasTangents())
+			VertexArray::attribute(3, node->vbo, 4, stride, offsetof(ModelOBJ::Vertex, tangent));
+		GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
+		VertexArray::end();
 
 		auto& v = pMesh->pMaterial->alpha == 1.0? mOpaqueNodes : mTranslucentNodes;
 		v.push_back(node);
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	Log::debug("Model Bound | Meshes: %d | Opaque: %d | Translucent: %d", nMeshes, mOpaqueNodes.size(), mTranslucentNodes.size());
 }
 
@@ -339,9 +387,7 @@ void ModelOBJRenderer::loadTextures() {
 		}
 
 		if (exists) {
-			std::shared_ptr<ITexture> texture = std::make_shared<Texture>(1, filename);
-			texture->mipmap()->repeat()->unbind();
-			mModelTextures[pMaterial->colorMapFilename] = texture;
+			mModelTextures[pMaterial->colorMapFilename] = TextureCache::get().load(1, filename);
 		} else
 			Log::error("Unable to load material %s", pMaterial->colorMapFilename.c_str());
 
@@ -367,98 +413,128 @@ void ModelOBJRenderer::loadTextures() {
 		}
 
 		if (exists) {
-			std::shared_ptr<ITexture> texture = std::make_shared<Texture>(2, filename);
-			texture->mipmap()->repeat()->unbind();
-			mModelTextures[pMaterial->bumpMapFilename] = texture;
+			mModelTextures[pMaterial->bumpMapFilename] = TextureCache::get().load(2, filename);
 		} else
 			Log::error("Unable to load material %s", pMaterial->bumpMapFilename.c_str());
 	}
 }
 
 
-void ModelOBJRenderer::render(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const std::vector<Matrix4x4>& matrices, bool opaque) {
-	IShader* shader;
+IShader* ModelOBJRenderer::selectShader(const IShadowMap* shadowMap, const ModelOBJ::Material* pMaterial) const {
+	if (shadowMap->isRendering())
+		return gShaderShadow.get();
+
+	if (!pMaterial->colorMapFilename.empty())
+		return pMaterial->bumpMapFilename.empty()? gShaderTexture.get() : gShaderNormalTexture.get();
+
+	return gShaderMaterial.get();
+}
+
+
+void ModelOBJRenderer::setupShader(IShader* shader, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap) const {
 	if (shadowMap->isRendering()) {
-		shader = gShaderShadow.get();
-		shader->run();
-		shadowMap->setMatrices(gShaderShadow.get());
+		shadowMap->setMatrices(shader);
+		return;
 	}
 
-	auto& nodes = opaque? mOpaqueNodes : mTranslucentNodes;
+	camera->setMatrices(shader);
+	shadowMap->setVars(shader);
 
-	for (auto& node : nodes) {
-		if (!shadowMap->isRendering()) {
-			const ModelOBJ::Material *pMaterial = node->mesh->pMaterial;
-
-			if (!pMaterial->colorMapFilename.empty()) {
-				if (!pMaterial->bumpMapFilename.empty()) {
-					shader = gShaderNormalTexture.get();
-					shader->run();
-					shader->set("colorMap", mModelTextures[pMaterial->colorMapFilename].get());
-					shader->set("normalMap", mModelTextures[pMaterial->bumpMapFilename].get());
-				} else {
-					shader = gShaderTexture.get();
-					shader->run();
-					shader->set("colorMap", mModelTextures[pMaterial->colorMapFilename].get());
-				}
-			} else {
-				shader = gShaderMaterial.get();
-				shader->run();
-			}
-
-			camera->setMatrices(shader);
-			shadowMap->setVars(shader);
-
-			shader->set4f("ambientMaterial", (float*) pMaterial->ambient);
-			shader->set4f("diffuseMaterial", (float*) pMaterial->diffuse);
-			shader->set4f("specularMaterial", (float*) pMaterial->specular);
-			shader->set("shininess", pMaterial->shininess);
-			shader->set("alpha", pMaterial->alpha);
-			shader->set("ambientLight", sky->getAmbientLight());
-			shader->set("diffuseLight", sky->getDiffuseLight());
-			shader->set("specularLight", sky->getSpecularLight());
-			shader->set("lightPosition", sky->getSunPosition());
-		}
+	shader->set("ambientLight", sky->getAmbientLight());
+	shader->set("diffuseLight", sky->getDiffuseLight());
+	shader->set("specularLight", sky->getSpecularLight());
+	shader->set("lightPosition", sky->getSunPosition());
+}
 
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, node->vbo);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), 0);
 
-		if (mModel->hasNormals()) {
-			glEnableVertexAttribArray(1);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), (GLvoid*) offsetof(ModelOBJ::Vertex, normal));
-		}
+void ModelOBJRenderer::bindMaterial(IShader* shader, const ModelOBJ::Material* pMaterial) {
+	const Uniforms& uniforms = uniformsOf(shader);
+	if (!pMaterial->colorMapFilename.empty()) {
+		uniforms.colorMap.set(mModelTextures[pMaterial->colorMapFilename].get());
+		if (!pMaterial->bumpMapFilename.empty())
+			uniforms.normalMap.set(mModelTextures[pMaterial->bumpMapFilename].get());
+	}
 
-		if (mModel->hasTextureCoords()) {
-			glEnableVertexAttribArray(2);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), (GLvoid*) offsetof(ModelOBJ::Vertex, texCoord));
-		}
+	uniforms.ambientMaterial.set4f(pMaterial->ambient);
+	uniforms.diffuseMaterial.set4f(pMaterial->diffuse);
+	uniforms.specularMaterial.set4f(pMaterial->specular);
+	uniforms.shininess.set(pMaterial->shininess);
+	uniforms.alpha.set(pMaterial->alpha);
+}
 
-		if (mModel->hasTangents()) {
-			glEnableVertexAttribArray(3);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node->ibo);
-			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, mModel->getVertexSize(), (GLvoid*) offsetof(ModelOBJ::Vertex, tangent));
+
+void ModelOBJRenderer::bindNode(const RenderNode* node) const {
+	node->vertexArray.bind();
+}
+
+
+void ModelOBJRenderer::unbindNodes() {
+	VertexArray::unbind();
+}
+
+
+void ModelOBJRenderer::render(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const std::vector<Matrix4x4>& matrices, bool opaque) {
+	IShader* shader = nullptr;
+	auto& nodes = opaque? mOpaqueNodes : mTranslucentNodes;
+
+	for (auto& node : nodes) {
+		const ModelOBJ::Material *pMaterial = node->mesh->pMaterial;
+		IShader* nodeShader = selectShader(shadowMap, pMaterial);
+
+		// the shadow shader is set up once for all the nodes
+		if (nodeShader != shader || !shadowMap->isRendering()) {
+			shader = nodeShader;
+			shader->run();
+			setupShader(shader, camera, sky, shadowMap);
 		}
+		if (!shadowMap->isRendering())
+			bindMaterial(shader, pMaterial);
 
+		bindNode(node.get());
+
+		const Uniform& uniformM = uniformsOf(shader).M;
 		for (auto& m4x4 : matrices) {
-			shader->set("M", m4x4);
+			uniformM.set(m4x4);
 			glDrawElements(GL_TRIANGLES, node->indiceCount, GL_UNSIGNED_INT, 0);
+			RENDER_STATS_DRAW(GL_TRIANGLES, node->indiceCount, 1);
 		}
 	}
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(3);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	unbindNodes();
 
 	IShader::stop();
 }
 
 
+void ModelOBJRenderer::submit(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const Matrix4x4& m4x4, bool opaque) {
+	auto& nodes = opaque? mOpaqueNodes : mTranslucentNodes;
+	const float depth = camera->getPosition().distance(m4x4.getOrigin());
+	const bool shadowPass = shadowMap->isRendering();
+
+	for (auto& node : nodes) {
+		const RenderNode* pNode = node.get();
+		const ModelOBJ::Material* pMaterial = pNode->mesh->pMaterial;
+
+		RenderPacket packet;
+		packet.name = "model";
+		packet.shader = selectShader(shadowMap, pMaterial);
+		packet.depth = depth;
+		packet.setup = [this, camera, sky, shadowMap](IShader* shader){ setupShader(shader, camera, sky, shadowMap); };
+		if (!shadowPass) {
+			packet.material = pMaterial;
+			packet.bindMaterial = [this, pMaterial](IShader* shader){ bindMaterial(shader, pMaterial); };
+		}
+		packet.draw = [this, pNode, m4x4](IShader* shader){
+			bindNode(pNode);
+			uniformsOf(shader).M.set(m4x4);
+			glDrawElements(GL_TRIANGLES, pNode->indiceCount, GL_UNSIGNED_INT, 0);
+			RENDER_STATS_DRAW(GL_TRIANGLES, pNode->indiceCount, 1);
+			unbindNodes();
+		};
+		queue->submit(std::move(packet));
+	}
+}
+
+
 void ModelOBJRenderer::render(const ICamera *camera, const ISky *sky, const IShadowMap *shadowMap, const Matrix4x4& m4x4, bool opaque) {
 	static std::vector<Matrix4x4> v(1);
 	v.clear();
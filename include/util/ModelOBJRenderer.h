@@ -10,6 +10,7 @@
 #include "ModelOBJ.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "VertexArray.h"
 #include "IoUtils.h"
 #include "ShadowMap.h"
 #include "ShaderUtils.h"
@@ -24,9 +25,26 @@ class ModelOBJRenderer {
 	static std::unique_ptr<IShader> gShaderNormalTexture;
 	static void initShaders();
 
+	// set per material and per draw, resolved once per program
+	typedef struct {
+		Uniform M;
+		Uniform ambientMaterial;
+		Uniform diffuseMaterial;
+		Uniform specularMaterial;
+		Uniform shininess;
+		Uniform alpha;
+		Uniform colorMap;
+		Uniform normalMap;
+	} Uniforms;
+
+	static Uniforms gUniforms[4]; // same order as the shaders
+	static Uniforms resolveUniforms(IShader* shader);
+	static const Uniforms& uniformsOf(const IShader* shader);
+
 	struct RenderNode {
 		GLuint vbo;
 		GLuint ibo;
+		VertexArray vertexArray;
 		GLuint indiceCount;
 		const ModelOBJ::Mesh* mesh;
 	};
@@ -37,6 +55,12 @@ class ModelOBJRenderer {
 	std::vector<std::shared_ptr<RenderNode>> mTranslucentNodes;
 
 	void loadTextures();
+
+	IShader* selectShader(const IShadowMap* shadowMap, const ModelOBJ::Material* pMaterial) const;
+	void setupShader(IShader* shader, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap) const;
+	void bindMaterial(IShader* shader, const ModelOBJ::Material* pMaterial);
+	void bindNode(const RenderNode* node) const;
+	static void unbindNodes();
 public:
 	explicit ModelOBJRenderer(const std::string& filename);
 
@@ -44,6 +68,9 @@ public:
 
 	void render(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const Matrix4x4& m4x4, bool opaque);
 	void render(const ICamera* camera, const ISky *sky, const IShadowMap* shadowMap, const std::vector<Matrix4x4>& matrices, bool opaque);
+
+	/** one packet per mesh, so the queue can group them by shader and material with the other models */
+	void submit(IRenderQueue* queue, const ICamera* camera, const ISky* sky, const IShadowMap* shadowMap, const Matrix4x4& m4x4, bool opaque);
 };
 
 //-----------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 #include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
 #include "PhysicsBody.h"
 #include "Log.h"
+#include "InterpolatedMotionState.h"
 
 
 PhysicsBody::PhysicsBody(float mass, std::unique_ptr<btTriangleIndexVertexArray> vertexArray, std::unique_ptr<btMotionState> motionState, const btVector3& localInertia):
@@ -57,6 +58,10 @@ void PhysicsBody::read(ISerializer* serializer) const {
 	serializer->read(row2);
 	btTransform transform(btMatrix3x3(row0, row1, row2), origin);
 	mRigidBody->setWorldTransform(transform);
+
+	InterpolatedMotionState* motionState = dynamic_cast<InterpolatedMotionState*>(mMotionState.get());
+	if (motionState)
+		motionState->teleport(transform);
 }
 
 
@@ -6,8 +6,7 @@ static constexpr const char* vs[] = {
 	"attribute vec3 vertex;"
 	"attribute vec3 normal;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"uniform vec3 position;"
 	"uniform vec3 lightPosition;"
@@ -59,8 +58,7 @@ static constexpr const char* vs_Instanced[] = {
 	"attribute vec3 normal;"
 	"attribute vec3 position;"
 
-	"uniform mat4 V;"
-	"uniform mat4 P;"
+	,UniformBlock::VIEW_CODE,
 
 	"uniform vec3 lightPosition;"
 
@@ -94,6 +92,9 @@ Pin::Pin() {
 	mShader->bindAttribute(0, "vertex");
 	mShader->bindAttribute(1, "normal");
 	mShader->link();
+	mPositionUniform = mShader->getUniform("position");
+	mLightPositionUniform = mShader->getUniform("lightPosition");
+	mColorUniform = mShader->getUniform("color");
 
 	mShaderInstanced = std::make_unique<Shader>(vs_Instanced, fs);
 	mShaderInstanced->bindAttribute(0, "vertex");
@@ -142,51 +143,54 @@ Pin::Pin() {
 	glGenBuffers(1, &mVbo);
 	glGenBuffers(1, &mNbo);
 	glGenBuffers(1, &mIbo);
+	glGenBuffers(1, &mPbo);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mVbo);
 	glBufferData(GL_ARRAY_BUFFER, gVertices.size() * sizeof(btVector3), &gVertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mNbo);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mNbo);
 	glBufferData(GL_ARRAY_BUFFER, gNormals.size() * sizeof(btVector3), &gNormals[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, gIndiceCount * sizeof(unsigned int), &gIndices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	mVertexArray.begin();
+	VertexArray::attribute(0, mVbo, 3, sizeof(btVector3), 0);
+	VertexArray::attribute(1, mNbo, 3, sizeof(btVector3), 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	VertexArray::end();
+
+	// shared vertices and normals, positions: one per pin
+	mInstancedArray.begin();
+	VertexArray::attribute(0, mVbo, 3, sizeof(btVector3), 0);
+	VertexArray::attribute(1, mNbo, 3, sizeof(btVector3), 0);
+	VertexArray::attribute(2, mPbo, 3, sizeof(btVector3), 0, 1);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	VertexArray::end();
 }
 
 
 Pin::~Pin() {
-	glDeleteBuffers(1, &mVbo);
-	glDeleteBuffers(1, &mNbo);
-	glDeleteBuffers(1, &mIbo);
+	GLState::get().deleteBuffers(1, &mVbo);
+	GLState::get().deleteBuffers(1, &mNbo);
+	GLState::get().deleteBuffers(1, &mIbo);
+	GLState::get().deleteBuffers(1, &mPbo);
 }
 
 
 void Pin::render(const btVector3& point, const ICamera* camera, const btVector3& lightPosition, const btVector3& color) {
 	mShader->run();
 	camera->setMatrices(mShader.get());
-	mShader->set("position", point);
-	mShader->set("lightPosition", lightPosition);
-	mShader->set("color", color);
+	mPositionUniform.set(point);
+	mLightPositionUniform.set(lightPosition);
+	mColorUniform.set(color);
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, mNbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
+	mVertexArray.bind();
 	glDrawElements(GL_TRIANGLES, gIndiceCount, GL_UNSIGNED_INT, 0);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	VertexArray::unbind();
 
 	Shader::stop();
 }
@@ -198,36 +202,13 @@ void Pin::render(const std::vector<btVector3>& points, const ICamera* camera, co
 	mShaderInstanced->set("lightPosition", lightPosition);
 	mShaderInstanced->set("color", color);
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-
-	glVertexAttribDivisor(0, 0); // vertices : always reuse the same vertices	-> 0
-	glVertexAttribDivisor(1, 0); // normals : always reuse the same uv 			-> 0
-	glVertexAttribDivisor(2, 1); // positions : one per quad (its center)		-> 1
-
-	// Shared: Vertices
-	glBindBuffer(GL_ARRAY_BUFFER, mVbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-	// Shared: Normals
-	glBindBuffer(GL_ARRAY_BUFFER, mNbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-	// Shared: Indices
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIbo);
-
-	// Positions
-	glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(btVector3), &points[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(btVector3), 0);
-	glDrawElementsInstanced(GL_TRIANGLES, gIndiceCount, GL_UNSIGNED_INT, 0, points.size());
-
-	glVertexAttribDivisor(2, 0); // disable
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, mPbo);
+	glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(btVector3), &points[0], GL_STREAM_DRAW);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	mInstancedArray.bind();
+	glDrawElementsInstanced(GL_TRIANGLES, gIndiceCount, GL_UNSIGNED_INT, 0, points.size());
+	VertexArray::unbind();
 
 	Shader::stop();
 }
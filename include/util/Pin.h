@@ -4,14 +4,22 @@
 #include <LinearMath/btVector3.h>
 #include <vector>
 #include "Shader.h"
+#include "VertexArray.h"
 
 
 class Pin {
 	GLuint mVbo;
 	GLuint mNbo;
 	GLuint mIbo;
+	GLuint mPbo; // positions of the instanced pins
+	VertexArray mVertexArray;
+	VertexArray mInstancedArray;
 	std::unique_ptr<IShader> mShader;
 	std::unique_ptr<IShader> mShaderInstanced;
+	// of mShader, set for each pin
+	Uniform mPositionUniform;
+	Uniform mLightPositionUniform;
+	Uniform mColorUniform;
 public:
 	Pin();
 	~Pin();
@@ -0,0 +1,140 @@
+#include <cstring>
+#include <fstream>
+#include "Profiler.h"
+#include "Log.h"
+
+// buffer of the current thread, registered on its first event
+static thread_local void* tThreadBuffer = nullptr;
+
+
+Profiler::Profiler():
+	mStart(Clock::now()),
+	mWindowStart(mStart),
+	mWindowFrames(0)
+{}
+
+
+Profiler& Profiler::get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+
+Profiler::ThreadBuffer& Profiler::getThreadBuffer() {
+	if (tThreadBuffer)
+		return *static_cast<ThreadBuffer*>(tThreadBuffer);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->events.resize(EVENTS_PER_THREAD);
+	buffer->threadId = static_cast<unsigned int>(mThreads.size());
+	buffer->threadName = "thread " + std::to_string(buffer->threadId);
+	tThreadBuffer = buffer.get();
+	mThreads.push_back(std::move(buffer));
+	return *static_cast<ThreadBuffer*>(tThreadBuffer);
+}
+
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.threadName = name;
+}
+
+
+void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end, bool isPass) {
+	ThreadBuffer& buffer = getThreadBuffer();
+	{
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.events[buffer.next] = { name, start, end };
+		if (++buffer.next == buffer.events.size()) {
+			buffer.next = 0;
+			buffer.isFull = true;
+		}
+	}
+
+	if (!isPass)
+		return;
+
+	const float ms = std::chrono::duration<float, std::milli>(end - start).count();
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (PassTime& total : mPassTotals) {
+		if (total.name == name || std::strcmp(total.name, name) == 0) {
+			total.ms += ms;
+			return;
+		}
+	}
+	mPassTotals.push_back({ name, ms });
+}
+
+
+void Profiler::endFrame() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mWindowFrames++;
+
+	const Clock::time_point now = Clock::now();
+	if (now - mWindowStart < std::chrono::seconds(1))
+		return;
+
+	mPassTimes = mPassTotals;
+	for (PassTime& pass : mPassTimes)
+		pass.ms /= mWindowFrames;
+
+	// keep the order of the passes stable on screen
+	for (PassTime& total : mPassTotals)
+		total.ms = 0.f;
+	mWindowFrames = 0;
+	mWindowStart = now;
+}
+
+
+std::vector<Profiler::PassTime> Profiler::getPassTimes() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPassTimes;
+}
+
+
+static void writeEscaped(std::ofstream& file, const std::string& text) {
+	for (char c : text) {
+		if (c == '"' || c == '\\')
+			file << '\\';
+		file << c;
+	}
+}
+
+
+void Profiler::writeChromeTrace(const std::string& fileName) {
+	std::ofstream file(fileName);
+	if (!file)
+		throw std::runtime_error("Can't write trace: " + fileName);
+
+	unsigned int eventCount = 0;
+	file << "{\"traceEvents\":[\n";
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& thread : mThreads) {
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+		if (eventCount++ > 0)
+			file << ",\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread->threadId << ",\"args\":{\"name\":\"";
+		writeEscaped(file, thread->threadName);
+		file << "\"}}";
+
+		// oldest first
+		const size_t count = thread->isFull? thread->events.size() : thread->next;
+		const size_t first = thread->isFull? thread->next : 0;
+		for (size_t i = 0; i < count; i++) {
+			const Event& event = thread->events[(first + i) % thread->events.size()];
+			const double ts = std::chrono::duration<double, std::micro>(event.start - mStart).count();
+			const double dur = std::chrono::duration<double, std::micro>(event.end - event.start).count();
+
+			file << ",\n{\"name\":\"";
+			writeEscaped(file, event.name);
+			file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread->threadId << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+			eventCount++;
+		}
+	}
+	file << "\n]}\n";
+
+	Log::info("Profiler trace: %u events written to %s", eventCount, fileName.c_str());
+}
@@ -0,0 +1,102 @@
+#ifndef GAMEDEV3D_PROFILER_H
+#define GAMEDEV3D_PROFILER_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * CPU profiler: nested scopes are recorded per thread in a ring buffer and can be
+ * exported as Chrome trace events (chrome://tracing, Perfetto). The scopes marked as
+ * passes are also summed per frame and averaged over a second for the on-screen summary.
+ *
+ * Use the PROFILE_SCOPE / PROFILE_PASS macros, they compile to nothing without GAMEDEV3D_PROFILER.
+ * The names must outlive the profiler (literals or static strings).
+ */
+
+class Profiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	typedef struct {
+		const char* name;
+		float ms;
+	} PassTime;
+
+private:
+	typedef struct {
+		const char* name;
+		Clock::time_point start;
+		Clock::time_point end;
+	} Event;
+
+	struct ThreadBuffer {
+		std::mutex mutex;
+		std::vector<Event> events; // ring buffer
+		size_t next = 0;
+		bool isFull = false;
+		unsigned int threadId;
+		std::string threadName;
+	};
+
+	static constexpr const size_t EVENTS_PER_THREAD = 1 << 16;
+
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+	Clock::time_point mStart;
+
+	// pass totals of the current second, published in mPassTimes
+	Clock::time_point mWindowStart;
+	unsigned int mWindowFrames;
+	std::vector<PassTime> mPassTotals;
+	std::vector<PassTime> mPassTimes;
+
+	Profiler();
+	ThreadBuffer& getThreadBuffer();
+
+public:
+	static Profiler& get();
+
+	void setThreadName(const std::string& name);
+	void record(const char* name, Clock::time_point start, Clock::time_point end, bool isPass);
+	void endFrame();
+
+	/** ms per frame, averaged over the last second */
+	std::vector<PassTime> getPassTimes();
+	void writeChromeTrace(const std::string& fileName);
+};
+
+
+class ProfileScope {
+	const char* mName;
+	bool mIsPass;
+	Profiler::Clock::time_point mStart;
+public:
+	explicit ProfileScope(const char* name, bool isPass = false):
+		mName(name),
+		mIsPass(isPass),
+		mStart(Profiler::Clock::now())
+	{}
+
+	~ProfileScope()
+	{ Profiler::get().record(mName, mStart, Profiler::Clock::now(), mIsPass); }
+};
+
+
+#ifdef GAMEDEV3D_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __COUNTER__)(name)
+#define PROFILE_PASS(name) ProfileScope PROFILE_CONCAT(profileScope, __COUNTER__)(name, true)
+#define PROFILE_THREAD(name) Profiler::get().setThreadName(name)
+#define PROFILE_END_FRAME() Profiler::get().endFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_PASS(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_END_FRAME()
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "ProgramCache.h"
+#include "IoUtils.h"
+#include "Log.h"
+
+
+static const char* glString(GLenum name) {
+	const char* s = reinterpret_cast<const char*>(glGetString(name));
+	return s? s : "";
+}
+
+
+ProgramCache::ProgramCache():
+	mEnabled(false),
+	mDriver(0)
+{
+	int major = 0, minor = 0;
+	bool hasBinaries = std::sscanf(glString(GL_VERSION), "%d.%d", &major, &minor) == 2 && (major > 4 || (major == 4 && minor >= 1));
+	if (!hasBinaries) {
+		// only legacy contexts get here, they still have the extension string
+		hasBinaries = std::strstr(glString(GL_EXTENSIONS), "GL_ARB_get_program_binary") != nullptr;
+	}
+	GLint formats = 0;
+	if (hasBinaries)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	mFolder = IoUtils::getCacheFolder();
+	mEnabled = formats > 0 && !mFolder.empty();
+
+	// a driver update may change the binary format without changing its enum
+	mDriver = hash(glString(GL_VENDOR));
+	mDriver = hash(glString(GL_RENDERER), mDriver);
+	mDriver = hash(glString(GL_VERSION), mDriver);
+	mDriver = hash(glString(GL_SHADING_LANGUAGE_VERSION), mDriver);
+
+	Log::info("Program cache %s (%d binary formats) %s", mEnabled? "enabled" : "disabled", formats, mFolder.c_str());
+}
+
+
+ProgramCache& ProgramCache::get() {
+	static ProgramCache cache;
+	return cache;
+}
+
+
+uint64_t ProgramCache::hash(const char* text, uint64_t seed) noexcept {
+	uint64_t h = seed;
+	for (const char* c = text; *c; c++) {
+		h ^= static_cast<unsigned char>(*c);
+		h *= 1099511628211ULL;
+	}
+	// separator, so that "ab" + "c" and "a" + "bc" differ
+	h ^= 0xff;
+	h *= 1099511628211ULL;
+	return h;
+}
+
+
+std::string ProgramCache::getFileName(uint64_t key) const {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return mFolder + name;
+}
+
+
+void ProgramCache::prepare(GLuint program) const {
+	if (mEnabled)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+
+bool ProgramCache::load(GLuint program, uint64_t key) const {
+	if (!mEnabled)
+		return false;
+
+	std::ifstream file(getFileName(key), std::ios::binary);
+	if (!file)
+		return false;
+
+	Header header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| header.magic != MAGIC || header.version != VERSION || header.driver != mDriver || header.key != key) {
+		Log::info("Program cache: %016llx is stale", static_cast<unsigned long long>(key));
+		return false;
+	}
+
+	// a truncated or corrupt file is a miss, before its length sizes anything
+	const std::streampos start = file.tellg();
+	file.seekg(0, std::ios::end);
+	const std::streamoff remaining = file.tellg() - start;
+	if (header.length == 0 || remaining != static_cast<std::streamoff>(header.length)) {
+		Log::info("Program cache: %016llx is corrupt", static_cast<unsigned long long>(key));
+		return false;
+	}
+	file.seekg(start);
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+		return false;
+
+	// the driver may still reject it (format no longer supported), the caller compiles then
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	GLint isLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+	if (isLinked == GL_FALSE) {
+		Log::info("Program cache: %016llx rejected by the driver", static_cast<unsigned long long>(key));
+		return false;
+	}
+	return true;
+}
+
+
+void ProgramCache::save(GLuint program, uint64_t key) const {
+	if (!mEnabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	Header header { MAGIC, VERSION, mDriver, key, format, static_cast<uint32_t>(length) };
+	// written aside then renamed, a crash never leaves a truncated file under the real name
+	const std::string& fileName = getFileName(key);
+	const std::string& tempName = fileName + ".tmp";
+	{
+		std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+		if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), length)) {
+			Log::error("Can't write the program cache: %s", tempName.c_str());
+			return;
+		}
+	}
+	if (std::rename(tempName.c_str(), fileName.c_str()) != 0)
+		Log::error("Can't write the program cache: %s", fileName.c_str());
+}
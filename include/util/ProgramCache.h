@@ -0,0 +1,60 @@
+#ifndef GAMEDEV3D_PROGRAM_CACHE_H
+#define GAMEDEV3D_PROGRAM_CACHE_H
+
+#include "GLHeaders.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * Linked programs saved with glGetProgramBinary in the cache folder, one file per program.
+ * The key is a hash of the shader sources and attribute bindings, the files also record
+ * the driver (vendor, renderer, version) and are ignored when it changed: the caller then
+ * compiles the sources and saves the new binary.
+ *
+ * Disabled without GL 4.1 or GL_ARB_get_program_binary. GL thread only.
+ */
+
+class ProgramCache {
+	static constexpr const uint32_t MAGIC = 0x42504447; // "GDPB"
+	static constexpr const uint32_t VERSION = 1;
+
+	typedef struct {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t driver;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	} Header;
+
+	bool mEnabled;
+	uint64_t mDriver;
+	std::string mFolder;
+
+	ProgramCache();
+	std::string getFileName(uint64_t key) const;
+
+public:
+	static constexpr const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+	static ProgramCache& get();
+
+	/** FNV-1a, chained through the seed */
+	static uint64_t hash(const char* text, uint64_t seed = HASH_SEED) noexcept;
+
+	bool isEnabled() const noexcept;
+
+	/** call before linking, or the driver may not keep the binary */
+	void prepare(GLuint program) const;
+
+	/** true if the program is linked from the cached binary */
+	bool load(GLuint program, uint64_t key) const;
+	void save(GLuint program, uint64_t key) const;
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool ProgramCache::isEnabled() const noexcept
+{ return mEnabled; }
+
+#endif
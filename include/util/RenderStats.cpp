@@ -0,0 +1,143 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "RenderStats.h"
+#include "Log.h"
+
+
+RenderStats::RenderStats():
+	mPass("none"),
+	mObject("none"),
+	mCurrent(NO_ENTRY)
+{}
+
+
+RenderStats& RenderStats::get() {
+	static RenderStats stats;
+	return stats;
+}
+
+
+static bool sameName(const char* a, const char* b) {
+	return a == b || std::strcmp(a, b) == 0;
+}
+
+
+RenderStats::Counters& RenderStats::getCounters() {
+	if (mCurrent != NO_ENTRY)
+		return mEntries[mCurrent].counters;
+
+	for (size_t i = 0; i < mEntries.size(); i++) {
+		if (sameName(mEntries[i].pass, mPass) && sameName(mEntries[i].object, mObject)) {
+			mCurrent = i;
+			return mEntries[i].counters;
+		}
+	}
+	mCurrent = mEntries.size();
+	mEntries.push_back({ mPass, mObject, Counters() });
+	return mEntries.back().counters;
+}
+
+
+const char* RenderStats::setPass(const char* pass) {
+	const char* previous = mPass;
+	mPass = pass;
+	mCurrent = NO_ENTRY;
+	return previous;
+}
+
+
+const char* RenderStats::setObject(const char* object) {
+	const char* previous = mObject;
+	mObject = object;
+	mCurrent = NO_ENTRY;
+	return previous;
+}
+
+
+void RenderStats::drawCall(GLenum mode, size_t count, size_t instances) {
+	size_t triangles;
+	switch (mode) {
+		case GL_TRIANGLES: triangles = count / 3; break;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN: triangles = count > 2? count - 2 : 0; break;
+		case GL_QUADS: triangles = count / 2; break;
+		default: triangles = 0;
+	}
+
+	Counters& counters = getCounters();
+	counters.drawCalls++;
+	counters.instances += instances;
+	counters.triangles += triangles * instances;
+}
+
+
+void RenderStats::bufferUpload(size_t bytes) {
+	Counters& counters = getCounters();
+	counters.bufferUploads++;
+	counters.uploadedBytes += bytes;
+}
+
+
+void RenderStats::textureBind() {
+	getCounters().textureBinds++;
+}
+
+
+void RenderStats::shaderSwitch() {
+	getCounters().shaderSwitches++;
+}
+
+
+void RenderStats::stateSkipped() {
+	getCounters().skippedStates++;
+}
+
+
+void RenderStats::endFrame() {
+	mLastFrame.swap(mEntries);
+	mEntries.clear();
+	mCurrent = NO_ENTRY;
+}
+
+
+std::vector<RenderStats::Entry> RenderStats::getPassTotals() const {
+	std::vector<Entry> totals;
+	for (const Entry& entry : mLastFrame) {
+		Entry* total = nullptr;
+		for (Entry& t : totals) {
+			if (sameName(t.pass, entry.pass))
+				total = &t;
+		}
+		if (!total) {
+			totals.push_back({ entry.pass, nullptr, Counters() });
+			total = &totals.back();
+		}
+
+		Counters& c = total->counters;
+		c.drawCalls += entry.counters.drawCalls;
+		c.triangles += entry.counters.triangles;
+		c.instances += entry.counters.instances;
+		c.bufferUploads += entry.counters.bufferUploads;
+		c.uploadedBytes += entry.counters.uploadedBytes;
+		c.textureBinds += entry.counters.textureBinds;
+		c.shaderSwitches += entry.counters.shaderSwitches;
+		c.skippedStates += entry.counters.skippedStates;
+	}
+	return totals;
+}
+
+
+void RenderStats::writeCsv(const std::string& fileName) const {
+	std::ofstream file(fileName);
+	if (!file)
+		throw std::runtime_error("Can't write render stats: " + fileName);
+
+	file << "pass,object,draw calls,triangles,instances,buffer uploads,uploaded bytes,texture binds,shader switches,skipped states\n";
+	for (const Entry& entry : mLastFrame) {
+		const Counters& c = entry.counters;
+		file << entry.pass << "," << entry.object << "," << c.drawCalls << "," << c.triangles << "," << c.instances << ","
+			 << c.bufferUploads << "," << c.uploadedBytes << "," << c.textureBinds << "," << c.shaderSwitches << "," << c.skippedStates << "\n";
+	}
+	Log::info("Render stats of the last frame written to %s", fileName.c_str());
+}
@@ -0,0 +1,115 @@
+#ifndef GAMEDEV3D_RENDER_STATS_H
+#define GAMEDEV3D_RENDER_STATS_H
+
+#include "GLHeaders.h"
+#include <string>
+#include <vector>
+#include "Profiler.h"
+
+/**
+ * GL work of a frame: draw calls, triangles, instances, buffer uploads, texture binds,
+ * shader switches and skipped state changes, counted per pass and per object type. The counters of the last complete
+ * frame are kept for the overlay and the "renderstats" command.
+ *
+ * Use the RENDER_STATS_* macros next to the GL calls, they compile to nothing without
+ * GAMEDEV3D_PROFILER. The names must outlive the frame (literals or static strings).
+ * GL thread only.
+ */
+
+class RenderStats {
+public:
+	typedef struct {
+		unsigned int drawCalls = 0;
+		unsigned int triangles = 0;
+		unsigned int instances = 0;
+		unsigned int bufferUploads = 0;
+		size_t uploadedBytes = 0;
+		unsigned int textureBinds = 0;
+		unsigned int shaderSwitches = 0;
+		unsigned int skippedStates = 0; // dropped by GLState
+	} Counters;
+
+	typedef struct {
+		const char* pass;
+		const char* object; // nullptr in the pass totals
+		Counters counters;
+	} Entry;
+
+private:
+	const char* mPass;
+	const char* mObject;
+	// entry of the current pass and object, looked up again when one of them changes
+	size_t mCurrent;
+	std::vector<Entry> mEntries;
+	std::vector<Entry> mLastFrame;
+
+	RenderStats();
+	Counters& getCounters();
+
+public:
+	static constexpr const size_t NO_ENTRY = static_cast<size_t>(-1);
+
+	static RenderStats& get();
+
+	/** return the previous name, to be restored at the end of the scope */
+	const char* setPass(const char* pass);
+	const char* setObject(const char* object);
+
+	void drawCall(GLenum mode, size_t count, size_t instances = 1);
+	void bufferUpload(size_t bytes);
+	void textureBind();
+	void shaderSwitch();
+	void stateSkipped();
+	void endFrame();
+
+	/** of the last frame */
+	const std::vector<Entry>& getEntries() const noexcept;
+	std::vector<Entry> getPassTotals() const;
+	void writeCsv(const std::string& fileName) const;
+};
+
+
+class RenderStatsScope {
+	bool mIsPass;
+	const char* mPrevious;
+public:
+	RenderStatsScope(const char* name, bool isPass):
+		mIsPass(isPass),
+		mPrevious(isPass? RenderStats::get().setPass(name) : RenderStats::get().setObject(name))
+	{}
+
+	~RenderStatsScope() {
+		if (mIsPass)
+			RenderStats::get().setPass(mPrevious);
+		else
+			RenderStats::get().setObject(mPrevious);
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+inline const std::vector<RenderStats::Entry>& RenderStats::getEntries() const noexcept
+{ return mLastFrame; }
+
+
+#ifdef GAMEDEV3D_PROFILER
+#define RENDER_STATS_PASS(name) RenderStatsScope PROFILE_CONCAT(renderStatsScope, __COUNTER__)(name, true)
+#define RENDER_STATS_OBJECT(name) RenderStatsScope PROFILE_CONCAT(renderStatsScope, __COUNTER__)(name, false)
+#define RENDER_STATS_DRAW(mode, count, instances) RenderStats::get().drawCall(mode, count, instances)
+#define RENDER_STATS_UPLOAD(bytes) RenderStats::get().bufferUpload(bytes)
+#define RENDER_STATS_TEXTURE_BIND() RenderStats::get().textureBind()
+#define RENDER_STATS_SHADER_SWITCH() RenderStats::get().shaderSwitch()
+#define RENDER_STATS_STATE_SKIPPED() RenderStats::get().stateSkipped()
+#define RENDER_STATS_END_FRAME() RenderStats::get().endFrame()
+#else
+#define RENDER_STATS_PASS(name)
+#define RENDER_STATS_OBJECT(name)
+#define RENDER_STATS_DRAW(mode, count, instances)
+#define RENDER_STATS_UPLOAD(bytes)
+#define RENDER_STATS_TEXTURE_BIND()
+#define RENDER_STATS_SHADER_SWITCH()
+#define RENDER_STATS_STATE_SKIPPED()
+#define RENDER_STATS_END_FRAME()
+#endif
+
+#endif
@@ -1,19 +1,83 @@
+#include <cstdlib>
 #include <unordered_map>
-#include <OpenGL/gl3.h>
+#include "GLHeaders.h"
 #include "Log.h"
 #include "Texture.h"
 #include "Shader.h"
 
 
+Shader::Shader(const std::vector<const char*>& vs, const std::vector<const char*>& fs, const std::string& defines):
+	mVertexShader(0),
+	mFragmentShader(0),
+	mProgram(glCreateProgram()),
+	mUniformBlocks(0),
+	mVertexSources(vs),
+	mFragmentSources(fs),
+	mDefines(defines),
+	mKey(ProgramCache::hash(UniformBlock::EXTENSION_CODE))
+{
+	mKey = ProgramCache::hash(mDefines.c_str(), mKey);
+	for (const char* source : mVertexSources)
+		mKey = ProgramCache::hash(source, mKey);
+	// the same fragments in the other stage must not give the same key
+	mKey = ProgramCache::hash("/* fragment */", mKey);
+	for (const char* source : mFragmentSources)
+		mKey = ProgramCache::hash(source, mKey);
+}
+
+
 Shader::~Shader() {
 	Log::debug("Deleting shader %d", mProgram);
-	glDeleteProgram(mProgram);
+	GLState::get().deleteProgram(mProgram);
 	glDeleteShader(mVertexShader);
 	glDeleteShader(mFragmentShader);
 }
 
 
+GLuint Shader::compile(GLuint type, const std::vector<const char*>& source) const {
+	// the extension directive must come before anything else
+	std::vector<const char*> sources { UniformBlock::EXTENSION_CODE, mDefines.c_str() };
+	sources.insert(sources.end(), source.begin(), source.end());
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, sources.size(), sources.data(), NULL);
+	glCompileShader(shader);
+	GLint compiled;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled) {
+		GLint length;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+		std::string log(length, ' ');
+		glGetShaderInfoLog(shader, length, &length, &log[0]);
+		std::string msg { "Shader not compiled: " + log };
+		Log::error(msg.c_str());
+		glDeleteShader(shader); // Don't leak the shader.
+
+		for (const char* s : source) {
+			Log::debug(s);
+		}
+
+		exit(-1);
+	}
+	return shader;
+}
+
+
 void Shader::link() const {
+	// warm runs skip the compilation
+	const ProgramCache& cache = ProgramCache::get();
+	if (cache.load(mProgram, mKey)) {
+		mUniformBlocks = UniformBlock::bindProgram(mProgram);
+		return;
+	}
+
+	if (mVertexShader == 0) {
+		mVertexShader = compile(GL_VERTEX_SHADER, mVertexSources);
+		mFragmentShader = compile(GL_FRAGMENT_SHADER, mFragmentSources);
+		glAttachShader(mProgram, mVertexShader);
+		glAttachShader(mProgram, mFragmentShader);
+	}
+	cache.prepare(mProgram);
 	glLinkProgram(mProgram);
 	GLint isLinked = 0;
 	glGetProgramiv(mProgram, GL_LINK_STATUS, (int*) &isLinked);
@@ -28,24 +92,30 @@ void Shader::link() const {
 		Log::error("Shader link error: %s", log.c_str());
 
 		this->~Shader();
+		return;
 	}
+	cache.save(mProgram, mKey);
+	mUniformBlocks = UniformBlock::bindProgram(mProgram);
 }
 
 
 void Shader::bindAttribute(GLuint index, const GLchar *name) const {
 	glBindAttribLocation(mProgram, index, name);
+	// the locations are part of the binary
+	mKey = ProgramCache::hash(name, mKey + index);
 }
 
 
 GLint Shader::getLocation(const std::string& param) {
 	// if location is unknown, add it to the cache
-	if (locations.find(param) == locations.end()) {
+	auto it = locations.find(param);
+	if (it == locations.end()) {
 		GLint location = glGetUniformLocation(mProgram, param.c_str());
-		locations[param] = location;
+		it = locations.emplace(param, location).first;
 		if (location == -1)
 			Log::info("Location not found for %s", param.c_str());
 	}
-	return locations[param];
+	return it->second;
 }
 
 
@@ -55,57 +125,35 @@ void Shader::setUniform1i(int location, int number) const {
 
 
 void Shader::set(const std::string& param, const ITexture* texture) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		texture->bind();
-		setUniform1i(location, texture->getSlot());
-	}
+	getUniform(param).set(texture);
 }
 
 
 void Shader::set(const std::string& param, const btVector3& vector) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniform3f(location, vector.x(), vector.y(), vector.z());
-	}
+	getUniform(param).set(vector);
 }
 
 
 void Shader::set(const std::string& param, float value) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniform1f(location, value);
-	}
+	getUniform(param).set(value);
 }
 
 
 void Shader::set(const std::string& param, int value) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniform1i(location, value);
-	}
+	getUniform(param).set(value);
 }
 
 
 void Shader::set(const std::string& param, float v1, float v2) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniform2f(location, v1, v2);
-	}
+	getUniform(param).set(v1, v2);
 }
 
 
 void Shader::set(const std::string &param, const Matrix4x4 &matrix) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniformMatrix4fv(location, 1 /*only setting 1 matrix*/, false /*transpose?*/, matrix.raw());
-	}
+	getUniform(param).set(matrix);
 }
 
 
 void Shader::set4f(const std::string& param, float* value) {
-	GLint location = getLocation(param);
-	if (location >= 0) {
-		glUniform4f(location, value[0], value[1], value[2], value[3]);
-	}
+	getUniform(param).set4f(value);
 }
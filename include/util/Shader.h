@@ -1,29 +1,47 @@
 #ifndef SHADER_H_
 #define SHADER_H_
 
+#include <cstdint>
 #include <unordered_map>
-#include <OpenGL/gl3.h>
+#include <vector>
+#include "GLHeaders.h"
 #include <LinearMath/btVector3.h>
 #include "../app/Interfaces.h"
 #include "Log.h"
+#include "RenderStats.h"
+#include "ProgramCache.h"
 
 class Shader: public IShader
 {
-	GLuint mVertexShader;
-	GLuint mFragmentShader;
+	// compiled by link() only when the program is not in the ProgramCache
+	mutable GLuint mVertexShader;
+	mutable GLuint mFragmentShader;
 	GLuint mProgram;
+	// mask of the uniform blocks declared by the program, they are bound again on each link
+	mutable unsigned int mUniformBlocks;
+
+	// the fragments are static strings, only the pointers are kept
+	std::vector<const char*> mVertexSources;
+	std::vector<const char*> mFragmentSources;
+	// #define lines of a ShaderVariants permutation, inserted before the sources
+	std::string mDefines;
+	// program cache key: hash of the sources and of the attribute bindings
+	mutable uint64_t mKey;
 
 	std::unordered_map<std::string, GLint> locations;
 
-	template <int N> GLuint compile(GLuint type, const char* const(&source)[N]) const;
+	GLuint compile(GLuint type, const std::vector<const char*>& source) const;
 public:
 	template <int N, int M> Shader(const char* const(&vs)[N], const char* const(&fs)[M]);
+	Shader(const std::vector<const char*>& vs, const std::vector<const char*>& fs, const std::string& defines = "");
 	virtual ~Shader();
 
 	virtual void run() const override;
 	virtual void link() const override;
 
 	GLint getLocation(const std::string& param);
+	virtual Uniform getUniform(const std::string& param) override;
+	virtual bool hasUniformBlock(UniformBlock::Binding binding) const noexcept override;
 	virtual void bindAttribute(GLuint index, const GLchar *name) const override;
 	void setUniform1i(int location, int number) const;
 	virtual void set(const std::string& param, const ITexture* texture) override;
@@ -37,43 +55,20 @@ public:
 
 //-----------------------------------------------------------------------------
 
-inline void Shader::run() const
-{ glUseProgram(mProgram); }
-
-
-template <int N> GLuint Shader::compile(GLuint type, const char* const(&source)[N]) const {
-	GLuint shader = glCreateShader(type);
-	glShaderSource(shader, N, source, NULL);
-	glCompileShader(shader);
-	GLint compiled;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-	if (!compiled) {
-		GLint length;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
-		std::string log(length, ' ');
-		glGetShaderInfoLog(shader, length, &length, &log[0]);
-		std::string msg { "Shader not compiled: " + log };
-		Log::error(msg.c_str());
-		glDeleteShader(shader); // Don't leak the shader.
+inline void Shader::run() const {
+	GLState::get().useProgram(mProgram);
+}
 
-		for (int i = 0; i < N; i++) {
-			Log::debug(source[i]);
-		}
+inline Uniform Shader::getUniform(const std::string& param)
+{ return Uniform(getLocation(param)); }
 
-		exit(-1);
-	}
-	return shader;
-}
+inline bool Shader::hasUniformBlock(UniformBlock::Binding binding) const noexcept
+{ return (mUniformBlocks & (1u << binding)) != 0; }
 
 
-template <int N, int M> Shader::Shader(const char* const(&vs)[N], const char* const(&fs)[M]) {
-	mVertexShader = compile(GL_VERTEX_SHADER, vs);
-	mFragmentShader = compile(GL_FRAGMENT_SHADER, fs);
-	mProgram = glCreateProgram();
-	glAttachShader(mProgram, mVertexShader);
-	glAttachShader(mProgram, mFragmentShader);
-	glLinkProgram(mProgram);
-}
+template <int N, int M> Shader::Shader(const char* const(&vs)[N], const char* const(&fs)[M]):
+	Shader(std::vector<const char*>(vs, vs + N), std::vector<const char*>(fs, fs + M))
+{}
 
 
 #endif
\ No newline at end of file
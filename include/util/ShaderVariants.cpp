@@ -0,0 +1,36 @@
+#include "ShaderVariants.h"
+#include "Shader.h"
+#include "Log.h"
+#include "Profiler.h"
+
+
+std::string ShaderVariants::getDefines(unsigned int features) const {
+	std::string defines;
+	for (size_t i = 0; i < mFeatures.size(); i++) {
+		if (features & (1u << i))
+			defines += std::string("#define ") + mFeatures[i] + "\n";
+	}
+	return defines;
+}
+
+
+void ShaderVariants::bindAttribute(GLuint index, const char* name) {
+	mAttributes.emplace_back(index, name);
+}
+
+
+IShader* ShaderVariants::get(unsigned int features) {
+	auto it = mVariants.find(features);
+	if (it != mVariants.end())
+		return it->second.get();
+
+	PROFILE_SCOPE("shader variant");
+	const std::string& defines = getDefines(features);
+	std::unique_ptr<IShader> shader = std::make_unique<Shader>(mVertexSources, mFragmentSources, defines);
+	for (const auto& attribute : mAttributes)
+		shader->bindAttribute(attribute.first, attribute.second);
+	shader->link();
+	Log::debug("Shader variant %u linked (%d variants)", features, mVariants.size() + 1);
+
+	return mVariants.emplace(features, std::move(shader)).first->second.get();
+}
@@ -0,0 +1,52 @@
+#ifndef GAMEDEV3D_SHADER_VARIANTS_H
+#define GAMEDEV3D_SHADER_VARIANTS_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../app/Interfaces.h"
+
+/**
+ * Permutations of a program: the same sources compiled with a set of "#define" feature
+ * flags, the sources test them with #ifdef so each variant only has the code it needs.
+ * A variant is linked the first time it is asked for, and comes from the ProgramCache
+ * on the next runs. GL thread only.
+ */
+
+class ShaderVariants {
+	std::vector<const char*> mVertexSources;
+	std::vector<const char*> mFragmentSources;
+	// bit i of a variant defines mFeatures[i]
+	std::vector<const char*> mFeatures;
+	std::vector<std::pair<GLuint, const char*>> mAttributes;
+	std::unordered_map<unsigned int, std::unique_ptr<IShader>> mVariants;
+
+	std::string getDefines(unsigned int features) const;
+
+public:
+	template <int N, int M, int F>
+	ShaderVariants(const char* const(&vs)[N], const char* const(&fs)[M], const char* const(&features)[F]);
+
+	/** applied to every variant, call before get() */
+	void bindAttribute(GLuint index, const char* name);
+
+	/** compiles and links the variant the first time, the pointer stays valid */
+	IShader* get(unsigned int features);
+	size_t getVariantCount() const noexcept;
+};
+
+//-----------------------------------------------------------------------------
+
+template <int N, int M, int F>
+ShaderVariants::ShaderVariants(const char* const(&vs)[N], const char* const(&fs)[M], const char* const(&features)[F]):
+	mVertexSources(vs, vs + N),
+	mFragmentSources(fs, fs + M),
+	mFeatures(features, features + F)
+{}
+
+inline size_t ShaderVariants::getVariantCount() const noexcept
+{ return mVariants.size(); }
+
+#endif
@@ -1,20 +1,47 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include "ShadowMap.h"
 #include "Texture.h"
 #include "math/Matrix4x4.h"
 
 const std::string& ShadowMap::SERIALIZE_ID = "ShadowMap";
 
+// casters between the sun and the light box of a cascade
+static constexpr const float SHADOW_CASTER_DISTANCE = 500.f;
+
+// the cached cascades are rendered again when the light turns more than ~0.25 degrees
+static constexpr const float LIGHT_DIRECTION_THRESHOLD = 0.99999f;
+
+// the origin of a cascade moves in steps of this fraction of its radius
+static constexpr const float CASCADE_ORIGIN_STEP = 0.125f;
+
 //-----------------------------------------------------------------------------
 
-ShadowMap::ShadowMap(GLuint slot, unsigned int size) {
+ShadowMap::ShadowMap(GLuint slot, unsigned int size, unsigned int cascadeCount):
+	mIsRendering(false),
+	mIsRenderingStatic(false),
+	mIsStaticBound(false),
+	mCurrentCascade(0),
+	mSplitLambda(0.8f),
+	mShadowDistance(600.f),
+	mSoftShadows(true),
+	mHasLight(false),
+	mStatsStart(std::chrono::steady_clock::now()),
+	mStaticRenders(0),
+	mStaticRendersPerSecond(0.f)
+{
+	setCascadeCount(cascadeCount);
+
 	mDepthTexture = std::make_unique<Texture>(slot, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, size, size, std::vector<Uint32>());
 	mDepthTexture->linear()->clampToEdge()->image()->unbind();
 
+	mStaticDepthTexture = std::make_unique<Texture>(slot, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, size, size, std::vector<Uint32>());
+	mStaticDepthTexture->linear()->clampToEdge()->image()->unbind();
+
 	mFBO = std::make_unique<FrameBuffer>();
+	mStaticFBO = std::make_unique<FrameBuffer>();
 	FrameBuffer::end();
-
-	static constexpr const float range = 200.0f;
-	mProjectionMatrix.ortho(-range, range, -range, range, 0.f, 10000.f);
 }
 
 
@@ -23,51 +50,250 @@ ShadowMap::~ShadowMap() {
 }
 
 
-void ShadowMap::start(const btVector3& lightPosition, const btVector3& targetPosition, const btVector3& up) {
-	mIsRendering = true;
-	glUseProgram(0);
-	mFBO->startDepth(mDepthTexture.get());
+void ShadowMap::setCascadeCount(unsigned int cascadeCount) {
+	if (cascadeCount == 0 || cascadeCount > MAX_CASCADES)
+		throw std::runtime_error("Invalid shadow cascade count: " + std::to_string(cascadeCount));
+	mCascadeCount = cascadeCount;
+	invalidateStatic(); // the tiles have moved
+}
+
+
+void ShadowMap::invalidateStatic() noexcept {
+	for (auto& cascade : mCascades)
+		cascade.isStaticValid = false;
+}
+
+
+void ShadowMap::fitCascades(const ICamera* camera, const btVector3& lightDirection) {
+	mCameraPosition = camera->getPosition();
+	mCameraDirection = camera->getDirectionUnit();
+
+	// the light basis is kept while the sun doesn't turn, so the cache stays valid
+	if (!mHasLight || lightDirection.dot(mLightDirection) < LIGHT_DIRECTION_THRESHOLD) {
+		// fixed reference so the light box doesn't rotate with the camera
+		mLightReference = btFabs(lightDirection.y()) > 0.99f? btVector3(1.f, 0.f, 0.f) : btVector3(0.f, 1.f, 0.f);
+		mLightDirection = lightDirection;
+		mLightRight = mLightReference.cross(-lightDirection).normalized();
+		mLightUp = (-lightDirection).cross(mLightRight);
+		mHasLight = true;
+		invalidateStatic();
+	}
 
-	mViewMatrix.lookAt(lightPosition, targetPosition, up);
+	// squared distance from the view axis to the corners of the frustum, per unit of depth
+	const float tanHalfFovY = std::tan(camera->getFovY() * SIMD_RADS_PER_DEG * 0.5f);
+	const float aspect = camera->getAspectRatio();
+	const float corner2 = tanHalfFovY * tanHalfFovY * (1.f + aspect * aspect);
 
-	glCullFace(GL_FRONT);
+	const float near = camera->getZnear();
+	const float far = std::max(near + 1.f, std::min(mShadowDistance, camera->getZfar()));
+	const float tileSize = static_cast<float>(getTileSize());
+
+	float cascadeNear = near;
+	for (unsigned int i = 0; i < mCascadeCount; i++) {
+		Cascade& cascade = mCascades[i];
+
+		// practical split scheme: blend of the logarithmic and the uniform splits
+		const float p = static_cast<float>(i + 1) / mCascadeCount;
+		const float logSplit = near * std::pow(far / near, p);
+		const float uniformSplit = near + (far - near) * p;
+		cascade.far = mSplitLambda * logSplit + (1.f - mSplitLambda) * uniformSplit;
+
+		// bounding sphere of the slice, it only depends on the distances so its size is stable
+		const float n = cascadeNear;
+		const float f = cascade.far;
+		cascadeNear = cascade.far;
+		float centerDepth = 0.5f * (n + f) * (1.f + corner2);
+		float sphereRadius;
+		if (centerDepth >= f) {
+			centerDepth = f;
+			sphereRadius = f * std::sqrt(corner2);
+		} else
+			sphereRadius = std::sqrt((f - centerDepth) * (f - centerDepth) + f * f * corner2);
+
+		// the origin moves in steps of whole texels, the box grows by one step to keep the sphere inside
+		float step = sphereRadius * CASCADE_ORIGIN_STEP;
+		const float radius = sphereRadius + step;
+		const float texelSize = 2.f * radius / tileSize;
+		step = std::ceil(step / texelSize) * texelSize;
+
+		const btVector3& sphereCenter = mCameraPosition + mCameraDirection * centerDepth;
+		const btVector3& center =
+			mLightRight * (std::floor(sphereCenter.dot(mLightRight) / step) * step) +
+			mLightUp * (std::floor(sphereCenter.dot(mLightUp) / step) * step) +
+			mLightDirection * (std::floor(sphereCenter.dot(mLightDirection) / step) * step);
+
+		if (cascade.isStaticValid && cascade.center == center && cascade.radius == radius)
+			continue;
+
+		cascade.isStaticValid = false;
+		cascade.center = center;
+		cascade.radius = radius;
+
+		const float backDistance = radius + SHADOW_CASTER_DISTANCE;
+		cascade.lightPosition = center - mLightDirection * backDistance;
+		cascade.viewMatrix.lookAt(cascade.lightPosition, center, mLightReference);
+		cascade.projectionMatrix.ortho(-radius, radius, -radius, radius, 0.f, backDistance + radius);
+
+		// Moving from unit cube [-1,1] to [0,1]
+		static constexpr const float bias[16] = {
+				0.5f, 0.0f, 0.0f, 0.0f,
+				0.0f, 0.5f, 0.0f, 0.0f,
+				0.0f, 0.0f, 0.5f, 0.0f,
+				0.5f, 0.5f, 0.5f, 1.0f
+		};
+		cascade.shadowMVP = std::move(Matrix4x4(bias).multiplyRight(cascade.projectionMatrix).multiplyRight(cascade.viewMatrix));
+	}
+}
+
+
+void ShadowMap::start(const ICamera* camera, const btVector3& lightDirection) {
+	fitCascades(camera, lightDirection);
+	updateShadowBlock();
+
+	const auto now = std::chrono::steady_clock::now();
+	const float elapsed = std::chrono::duration<float>(now - mStatsStart).count();
+	if (elapsed >= 1.f) {
+		mStaticRendersPerSecond = mStaticRenders / elapsed;
+		mStaticRenders = 0;
+		mStatsStart = now;
+	}
+
+	mIsRendering = true;
+	mIsStaticBound = false;
+	IShader::stop();
+	GLState::get().cullFace(GL_FRONT);
 	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 }
 
 
-void ShadowMap::end() {
-	setTextureMatrix();
+void ShadowMap::setTileViewport(unsigned int cascade, bool clear) const {
+	const GLsizei tileSize = getTileSize();
+	const GLint x = mCascadeCount == 1? 0 : (cascade % 2) * tileSize;
+	const GLint y = mCascadeCount == 1? 0 : (cascade / 2) * tileSize;
+	glViewport(x, y, tileSize, tileSize);
+
+	if (clear) {
+		GLState::get().enable(GL_SCISSOR_TEST);
+		glScissor(x, y, tileSize, tileSize);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		GLState::get().disable(GL_SCISSOR_TEST);
+	}
+}
+
+
+bool ShadowMap::startStaticCascade(unsigned int cascade) {
+	Cascade& current = mCascades[cascade];
+	if (current.isStaticValid)
+		return false;
+
+	if (!mIsStaticBound) {
+		mStaticFBO->startDepth(mStaticDepthTexture.get(), false);
+		mIsStaticBound = true;
+	}
+
+	mIsRenderingStatic = true;
+	mCurrentCascade = cascade;
+	current.isStaticValid = true;
+	mStaticRenders++;
+
+	setTileViewport(cascade, true);
+	updateViewBlock();
+	return true;
+}
+
+
+void ShadowMap::startDynamic() {
+	mIsRenderingStatic = false;
+
+	// the static texture stays attached to its frame buffer since the first static cascade
+	mFBO->startDepth(mDepthTexture.get(), false);
+	mStaticFBO->blitDepth(*mFBO, mDepthTexture->getWidth(), mDepthTexture->getHeight());
+}
+
+
+void ShadowMap::setCascade(unsigned int cascade) {
+	mCurrentCascade = cascade;
+	setTileViewport(cascade, false);
+	updateViewBlock();
+}
+
 
+void ShadowMap::end() {
 	mFBO->end();
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-	glCullFace(GL_BACK);
+	GLState::get().cullFace(GL_BACK);
 	mIsRendering = false;
+	mIsRenderingStatic = false;
 }
 
 
 void ShadowMap::setVars(IShader* shader) const {
-	shader->set("shadowMVP", mShadowMVP);
+	static const std::string mvpNames[MAX_CASCADES] = { "shadowMVP[0]", "shadowMVP[1]", "shadowMVP[2]", "shadowMVP[3]" };
+
 	shader->set("shadowMap", mDepthTexture.get());
+	if (shader->hasUniformBlock(UniformBlock::SHADOW))
+		return;
+
+	float splits[4] = { BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT };
+	for (unsigned int i = 0; i < mCascadeCount; i++) {
+		shader->set(mvpNames[i], mCascades[i].shadowMVP);
+		if (i + 1 < mCascadeCount)
+			splits[i] = mCascades[i].far;
+	}
+
 	shader->set("shadowSize", static_cast<float>(mDepthTexture->getWidth()));
+	shader->set4f("cascadeSplits", splits);
+	shader->set("shadowDistance", mCascades[mCascadeCount - 1].far);
+	shader->set("shadowTileScale", getTileScale());
+	shader->set("shadowCameraPosition", mCameraPosition);
+	shader->set("shadowCameraDirection", mCameraDirection);
 }
 
 
 void ShadowMap::setMatrices(IShader *shader) const {
-	shader->set("V", mViewMatrix);
-	shader->set("P", mProjectionMatrix);
+	if (shader->hasUniformBlock(UniformBlock::VIEW))
+		return;
+	shader->set("V", mCascades[mCurrentCascade].viewMatrix);
+	shader->set("P", mCascades[mCurrentCascade].projectionMatrix);
 }
 
 
-void ShadowMap::setTextureMatrix()
-{
-	// Moving from unit cube [-1,1] to [0,1]
-	static constexpr const float bias[16] = {
-			0.5f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.5f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.5f, 0.0f,
-			0.5f, 0.5f, 0.5f, 1.0f
-	};
-	mShadowMVP = std::move(Matrix4x4(bias).multiplyRight(mProjectionMatrix).multiplyRight(mViewMatrix));
+void ShadowMap::updateViewBlock() const {
+	UniformBlock::ViewData data;
+	std::memcpy(data.V, mCascades[mCurrentCascade].viewMatrix.raw(), sizeof(data.V));
+	std::memcpy(data.P, mCascades[mCurrentCascade].projectionMatrix.raw(), sizeof(data.P));
+	UniformBlock::get(UniformBlock::VIEW).update(data);
+}
+
+
+void ShadowMap::updateShadowBlock() const {
+	UniformBlock::ShadowData data = {};
+	for (unsigned int i = 0; i < MAX_CASCADES; i++) {
+		std::memcpy(data.shadowMVP[i], mCascades[i].shadowMVP.raw(), sizeof(data.shadowMVP[i]));
+		data.cascadeSplits[i] = i + 1 < mCascadeCount? mCascades[i].far : BT_LARGE_FLOAT;
+	}
+	data.shadowCameraPosition[0] = mCameraPosition.x();
+	data.shadowCameraPosition[1] = mCameraPosition.y();
+	data.shadowCameraPosition[2] = mCameraPosition.z();
+	data.shadowSize = static_cast<float>(mDepthTexture->getWidth());
+	data.shadowCameraDirection[0] = mCameraDirection.x();
+	data.shadowCameraDirection[1] = mCameraDirection.y();
+	data.shadowCameraDirection[2] = mCameraDirection.z();
+	data.shadowDistance = mCascades[mCascadeCount - 1].far;
+	data.shadowTileScale = getTileScale();
+	UniformBlock::get(UniformBlock::SHADOW).update(data);
+}
+
+
+bool ShadowMap::isCaster(const btVector3& center, float radius) const {
+	const Cascade& cascade = mCascades[mCurrentCascade];
+	const btVector3& v = center - cascade.lightPosition;
+	const float depth = v.dot(mLightDirection);
+	if (depth < -radius || depth > SHADOW_CASTER_DISTANCE + 2.f * cascade.radius + radius)
+		return false;
+
+	const float range = cascade.radius + radius;
+	return btFabs(v.dot(mLightRight)) <= range && btFabs(v.dot(mLightUp)) <= range;
 }
 
 
@@ -1,33 +1,102 @@
 #ifndef SHADOWMAP_H_
 #define SHADOWMAP_H_
 
+#include <array>
+#include <chrono>
 #include "../app/Interfaces.h"
 #include "FrameBuffer.h"
 
 
+/**
+ * Cascaded shadow map. The view distance up to mShadowDistance is split in up to 4 cascades,
+ * each one rendered into a tile of a single depth texture (2x2 atlas) with a light box
+ * fitted to its slice of the camera frustum. The fragment shader picks the cascade from
+ * the distance of the point to the camera.
+ *
+ * The static casters are cached in their own atlas, a cascade is only rendered again when
+ * the light turns or its snapped origin moves. Every frame the cache is copied to the
+ * sampled atlas and the dynamic casters are drawn on top.
+ */
+
 class ShadowMap: public IShadowMap {
+public:
+	static constexpr const unsigned int MAX_CASCADES = 4;
+
+private:
+	struct Cascade {
+		float far; // distance to the camera where the cascade ends
+		float radius; // half size of the light box
+		btVector3 center; // snapped, the light box only moves when it changes
+		bool isStaticValid; // the static casters of the cache are up to date
+		btVector3 lightPosition;
+		Matrix4x4 viewMatrix;
+		Matrix4x4 projectionMatrix;
+		Matrix4x4 shadowMVP; // world to [0,1] of the cascade
+	};
+
 	std::unique_ptr<ITexture> mDepthTexture;
 	std::unique_ptr<FrameBuffer> mFBO;
+	std::unique_ptr<ITexture> mStaticDepthTexture;
+	std::unique_ptr<FrameBuffer> mStaticFBO;
 	bool mIsRendering;
-
-	Matrix4x4 mViewMatrix;
-	Matrix4x4 mProjectionMatrix;
-	Matrix4x4 mShadowMVP;
-
-	void setTextureMatrix();
+	bool mIsRenderingStatic;
+	bool mIsStaticBound;
+
+	unsigned int mCascadeCount;
+	unsigned int mCurrentCascade;
+	float mSplitLambda; // 0 = uniform splits, 1 = logarithmic splits
+	float mShadowDistance;
+	bool mSoftShadows;
+	std::array<Cascade, MAX_CASCADES> mCascades;
+
+	// camera of the current frame, for the cascade selection
+	btVector3 mCameraPosition;
+	btVector3 mCameraDirection;
+
+	// light basis of the cache (same axes as lookAt)
+	bool mHasLight;
+	btVector3 mLightReference;
+	btVector3 mLightRight;
+	btVector3 mLightUp;
+	btVector3 mLightDirection;
+
+	// static cascades rendered in the last second
+	std::chrono::steady_clock::time_point mStatsStart;
+	unsigned int mStaticRenders;
+	float mStaticRendersPerSecond;
+
+	unsigned int getTileSize() const noexcept;
+	void setTileViewport(unsigned int cascade, bool clear) const;
+	float getTileScale() const noexcept;
+	void fitCascades(const ICamera* camera, const btVector3& lightDirection);
+	void updateViewBlock() const;
+	void updateShadowBlock() const;
 
 public:
 	static const std::string& SERIALIZE_ID;
 
-	ShadowMap(GLuint slot, unsigned int size);
+	ShadowMap(GLuint slot, unsigned int size, unsigned int cascadeCount = 3);
 	virtual ~ShadowMap();
 
-	virtual void start(const btVector3& lightPosition, const btVector3& targetPosition, const btVector3& up) override;
+	virtual void start(const ICamera* camera, const btVector3& lightDirection) override;
+	virtual bool startStaticCascade(unsigned int cascade) override;
+	virtual void startDynamic() override;
+	virtual void setCascade(unsigned int cascade) override;
 	virtual void end() override;
 	virtual bool isRendering() const noexcept override;
+	virtual bool isRenderingStatic() const noexcept override;
+	virtual void invalidateStatic() noexcept override;
+	virtual float getStaticRendersPerSecond() const noexcept override;
+	virtual unsigned int getCascadeCount() const noexcept override;
+	virtual void setCascadeCount(unsigned int cascadeCount) override;
+	virtual void setSplitLambda(float lambda) noexcept override;
+	virtual void setShadowDistance(float distance) noexcept override;
+	virtual void setSoftShadows(bool soft) noexcept override;
+	virtual bool hasSoftShadows() const noexcept override;
 
 	virtual void setVars(IShader* shader) const override;
 	virtual void setMatrices(IShader* shader) const override;
+	virtual bool isCaster(const btVector3& center, float radius) const override;
 
 	static constexpr const char* getVertexShaderCode() noexcept;
 	static constexpr const char* getFragmentShaderCode() noexcept;
@@ -42,56 +111,126 @@ public:
 inline bool ShadowMap::isRendering() const noexcept
 { return mIsRendering; }
 
+inline bool ShadowMap::isRenderingStatic() const noexcept
+{ return mIsRenderingStatic; }
+
+inline float ShadowMap::getStaticRendersPerSecond() const noexcept
+{ return mStaticRendersPerSecond; }
+
+inline unsigned int ShadowMap::getCascadeCount() const noexcept
+{ return mCascadeCount; }
+
+inline void ShadowMap::setSplitLambda(float lambda) noexcept
+{ mSplitLambda = btClamped(lambda, 0.f, 1.f); }
+
+inline void ShadowMap::setShadowDistance(float distance) noexcept
+{ mShadowDistance = distance; }
+
+inline void ShadowMap::setSoftShadows(bool soft) noexcept
+{ mSoftShadows = soft; }
+
+inline bool ShadowMap::hasSoftShadows() const noexcept
+{ return mSoftShadows; }
+
+// a single cascade uses the whole texture, otherwise the texture is a 2x2 atlas
+inline float ShadowMap::getTileScale() const noexcept
+{ return mCascadeCount == 1? 1.f : 0.5f; }
+
+inline unsigned int ShadowMap::getTileSize() const noexcept
+{ return static_cast<unsigned int>(mDepthTexture->getWidth() * getTileScale()); }
+
 //-----------------------------------------------------------------------------
 
+// the cascade is chosen per fragment from the world point given to getShadow9(),
+// setShadowMap() is kept for the vertex shaders that still call it
 static constexpr const char* vertexShaderCode =
-	"uniform mat4 shadowMVP;"
-	"varying vec4 shadowCoord;"
-	"void setShadowMap(vec4 p) {"
-		"shadowCoord = shadowMVP * p;"
-	"}"
-	"void setShadowMap(vec3 p) {"
-		"setShadowMap(vec4(p, 1.0));"
-	"}";
+	"void setShadowMap(vec4 p) {}"
+	"void setShadowMap(vec3 p) {}";
 
+// UniformBlock::SHADOW, ShadowData has the same layout
 static constexpr const char* fragmentShaderCode =
 	"uniform sampler2D shadowMap;"
+	"\n#ifdef GL_ARB_uniform_buffer_object\n"
+	"layout(std140) uniform ShadowBlock {"
+		"mat4 shadowMVP[4];"
+		"vec4 cascadeSplits;" // far distance of the cascades 0-2, very far if unused
+		"vec3 shadowCameraPosition;"
+		"float shadowSize;" // texels of the atlas
+		"vec3 shadowCameraDirection;"
+		"float shadowDistance;"
+		"float shadowTileScale;"
+	"};"
+	"\n#else\n"
+	"uniform mat4 shadowMVP[4];"
+	"uniform vec4 cascadeSplits;"
+	"uniform vec3 shadowCameraPosition;"
 	"uniform float shadowSize;"
-	"varying vec4 shadowCoord;"
+	"uniform vec3 shadowCameraDirection;"
+	"uniform float shadowDistance;"
+	"uniform float shadowTileScale;"
+	"\n#endif\n"
+
+	"float lookup(vec4 coord, vec2 tileMin, vec2 tileMax, float dx, float dy) {"
+		"vec2 uv = clamp(coord.xy + vec2(dx, dy) / shadowSize, tileMin, tileMax);"
+		"float depth = texture2D(shadowMap, uv).z;"
+		"return depth < coord.z? 0.0 : 1.0;"
+	"}"
 
-	"float lookup(vec3 v, float dx, float dy, float offset) {"
-		"vec4 uv = shadowCoord + vec4(dx * offset, dy * offset, 0.0, 0.0);"
-		"float depth = texture2D(shadowMap, uv.xy).z;"
-		"float distance = shadowCoord.z;"
-		"return depth < distance? 0.0 : 1.0;"
+	// false if the point is outside the light boxes
+	"bool shadowCoord(vec3 v, out vec4 coord, out vec2 tileMin, out vec2 tileMax) {"
+		"float viewDepth = dot(v - shadowCameraPosition, shadowCameraDirection);"
+		"if (viewDepth > shadowDistance) return false;"
+
+		"mat4 mvp = shadowMVP[0];"
+		"vec2 tile = vec2(0.0, 0.0);"
+		"if (viewDepth > cascadeSplits.x) { mvp = shadowMVP[1]; tile = vec2(1.0, 0.0); }"
+		"if (viewDepth > cascadeSplits.y) { mvp = shadowMVP[2]; tile = vec2(0.0, 1.0); }"
+		"if (viewDepth > cascadeSplits.z) { mvp = shadowMVP[3]; tile = vec2(1.0, 1.0); }"
+
+		// If not inside the light box of the cascade, then return
+		"coord = mvp * vec4(v, 1.0);"
+		"bool rangeX = coord.x > 0.0 && coord.x < 1.0;"
+		"bool rangeY = coord.y > 0.0 && coord.y < 1.0;"
+		"bool rangeZ = coord.z > 0.0 && coord.z < 1.0;"
+		"if (!(rangeX && rangeY && rangeZ)) return false;"
+
+		// move to the tile of the cascade, the filter must not read the neighbour tiles
+		"tileMin = tile * shadowTileScale;"
+		"coord.xy = tileMin + coord.xy * shadowTileScale;"
+		"vec2 margin = vec2(0.5 / shadowSize);"
+		"tileMax = tileMin + vec2(shadowTileScale) - margin;"
+		"tileMin += margin;"
+		"return true;"
 	"}"
 
+	// 3x3 filter
 	"float getShadow9(vec3 v) {"
-		// If not visible in the shadow map, then return;
-		// http://stackoverflow.com/questions/6301085/how-to-check-if-an-object-lies-outside-the-clipping-volume-in-opengl
-		// (ranges for shadowMap are different)
-		"bool rangeX = shadowCoord.x > 0.0 && shadowCoord.x < shadowCoord.w;"
-		"bool rangeY = shadowCoord.y > 0.0 && shadowCoord.y < shadowCoord.w;"
-		"bool rangeZ = shadowCoord.z > 0.0 && shadowCoord.z < shadowCoord.w;"
-		"bool inFrustum = rangeX && rangeY && rangeZ;"
-		"if (!inFrustum) return 1.0;"
-
-		"float offset = shadowCoord.w / shadowSize;"
-		"float d = 1.5;"
+		"vec4 coord;"
+		"vec2 tileMin, tileMax;"
+		"if (!shadowCoord(v, coord, tileMin, tileMax)) return 1.0;"
 
-		"float v1 = lookup(v, 0.0, 0.0, offset);"
-		"float v2 = lookup(v, d, 0.0, offset);"
-		"float v3 = lookup(v, -d, 0.0, offset);"
-		"float v4 = lookup(v, 0.0, d, offset);"
-		"float v5 = lookup(v, 0.0, -d, offset);"
-		"float v6 = lookup(v, -d, -d, offset);"
-		"float v7 = lookup(v, d, -d, offset);"
-		"float v8 = lookup(v, -d, d, offset);"
-		"float v9 = lookup(v, d, d, offset);"
+		"float d = 1.5;"
+		"float v1 = lookup(coord, tileMin, tileMax, 0.0, 0.0);"
+		"float v2 = lookup(coord, tileMin, tileMax, d, 0.0);"
+		"float v3 = lookup(coord, tileMin, tileMax, -d, 0.0);"
+		"float v4 = lookup(coord, tileMin, tileMax, 0.0, d);"
+		"float v5 = lookup(coord, tileMin, tileMax, 0.0, -d);"
+		"float v6 = lookup(coord, tileMin, tileMax, -d, -d);"
+		"float v7 = lookup(coord, tileMin, tileMax, d, -d);"
+		"float v8 = lookup(coord, tileMin, tileMax, -d, d);"
+		"float v9 = lookup(coord, tileMin, tileMax, d, d);"
 		"float s = (v1+v2+v3+v4+v5+v6+v7+v8+v9) / 9.0;"
 		"s = clamp(s, 0.0, 1.0);"
 		"return s;"
 	"}"
+
+	// hard shadows, a single lookup
+	"float getShadow1(vec3 v) {"
+		"vec4 coord;"
+		"vec2 tileMin, tileMax;"
+		"if (!shadowCoord(v, coord, tileMin, tileMax)) return 1.0;"
+		"return lookup(coord, tileMin, tileMax, 0.0, 0.0);"
+	"}"
 ;
 
 inline constexpr const char* ShadowMap::getVertexShaderCode() noexcept
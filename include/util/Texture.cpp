@@ -1,5 +1,9 @@
+#include <cstring>
 #include "Texture.h"
 #include "IoUtils.h"
+#include "RenderStats.h"
+#include "TextureLoader.h"
+#include "TextureCache.h"
 
 const std::string& Texture::SERIALIZE_ID = "Texture";
 
@@ -10,21 +14,17 @@ mSlot(slot)
 
 
 Texture::Texture(GLuint slot, const std::string& filename):
-	mSlot(slot)
+	mFileName(filename),
+	mSlot(slot),
+	mColorCount(4),
+	mTextureFormat(GL_RGBA),
+	mWidth(1),
+	mHeight(1),
+	mPixels(1, 0x00808080),
+	mIsLoaded(false)
 {
 	glGenTextures(1, &mTextureID);
-
-	static auto deleter = [](SDL_Surface* img) {
-		SDL_FreeSurface(img);
-	};
-
-	auto img = std::unique_ptr<SDL_Surface, decltype(deleter)>(IMG_Load(filename.c_str()), deleter);
-	if (!img) {
-		Log::error("Unable to load texture: %s", filename.c_str());
-		throw std::runtime_error(std::string("Unable to load texture: ") + filename);
-	}
-	setFromSurface(img.get());
-	mFileName = filename;
+	TextureLoader::get().load(this, filename);
 }
 
 
@@ -77,60 +77,120 @@ Texture::Texture(GLuint slot, int colorCount, unsigned int width, unsigned int h
 
 Texture::~Texture() {
 	Log::debug("Deleting Texture %u", mSlot);
-	glDeleteTextures(1, (const GLuint*) &mTextureID);
+	if (!mIsLoaded)
+		TextureLoader::get().cancel(this);
+	GLState::get().deleteTexture(mTextureID);
 	if (mPBO != 0)
-		glDeleteBuffers(1, &mPBO);
+		GLState::get().deleteBuffers(1, &mPBO);
 }
 
 
-void Texture::loadPixels(const void *pixels) {
-	mPixels.clear();
-	if (pixels != nullptr) {
-		int size = mWidth * mHeight;
-		mPixels.reserve(size);
-		const Uint32* pixels0 = static_cast<const Uint32*>(pixels);
-		for (auto i = 0; i < size; ++i) {
-			mPixels[i] = pixels0[i];
-		}
-	}
+void Texture::readSurface(const SDL_Surface* surface, int& colorCount, GLenum& format, std::vector<Uint32>& pixels) {
+	// get the number of channels in the SDL surface
+	colorCount = surface->format->BytesPerPixel;
+	if (colorCount == 4) // contains an alpha channel
+		format = surface->format->Rmask == 0x000000ff? GL_RGBA : GL_BGRA;
+	else if (colorCount == 3) // no alpha channel
+		format = surface->format->Rmask == 0x000000ff? GL_RGB : GL_BGR;
+	else
+		throw std::runtime_error("Error: image is not truecolor");
+
+	// rows without the padding of the surface, uploaded with an unpack alignment of 1
+	const size_t rowSize = surface->w * colorCount;
+	pixels.assign((rowSize * surface->h + sizeof(Uint32) - 1) / sizeof(Uint32), 0);
+	Uint8* dst = reinterpret_cast<Uint8*>(pixels.data());
+	const Uint8* src = static_cast<const Uint8*>(surface->pixels);
+	for (int y = 0; y < surface->h; y++)
+		std::memcpy(dst + y * rowSize, src + y * surface->pitch, rowSize);
 }
 
 
 void Texture::setFromSurface(const SDL_Surface* surface) {
 	mFileName.clear();
-	// get the number of channels in the SDL surface
-	mColorCount = surface->format->BytesPerPixel;
-	if (mColorCount == 4) // contains an alpha channel
-		mTextureFormat = surface->format->Rmask == 0x000000ff? GL_RGBA : GL_BGRA;
-	else if (mColorCount == 3) // no alpha channel
-		mTextureFormat = surface->format->Rmask == 0x000000ff? GL_RGB : GL_BGR;
-	else
-		throw std::runtime_error("Error: image is not truecolor");
+	mCompressed.clear();
+	readSurface(surface, mColorCount, mTextureFormat, mPixels);
 	mWidth = (unsigned int) surface->w;
 	mHeight = (unsigned int) surface->h;
+}
+
+
+size_t Texture::getMemorySize() const noexcept {
+	if (isCompressed())
+		return mCompressed.getMemorySize(mHasMipmap? mCompressed.getLevelCount() : 1);
+	const size_t size = static_cast<size_t>(mWidth) * mHeight * mColorCount;
+	// the mipmap chain adds a third
+	return mHasMipmap? size + size / 3 : size;
+}
+
+
+void Texture::setLoadedPixels(int colorCount, GLenum format, unsigned int width, unsigned int height, std::vector<Uint32>&& pixels, bool staged) {
+	mColorCount = colorCount;
+	mTextureFormat = format;
+	mWidth = width;
+	mHeight = height;
+	mPixels = std::move(pixels);
+	mIsLoaded = true;
+	if (mHasImage)
+		upload(staged? nullptr : mPixels.data());
+}
+
 
-	loadPixels(surface->pixels);
+void Texture::setLoadedImage(CompressedImage&& image) {
+	mWidth = image.getWidth();
+	mHeight = image.getHeight();
+	mCompressed = std::move(image);
+	// the placeholder
+	mPixels.clear();
+	mIsLoaded = true;
+	if (mHasImage)
+		uploadCompressed();
 }
 
 
 void Texture::bind() const {
-	glEnable(GL_TEXTURE_2D);
-	glActiveTexture(GL_TEXTURE0 + mSlot);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	GLState::get().bindTexture(mSlot, mTextureID);
 }
 
 
-ITexture* Texture::mipmap() {
+void Texture::upload(const void* pixels) {
+	if (isCompressed()) {
+		uploadCompressed();
+		return;
+	}
 	bind();
-	image();
-	glGenerateMipmap(GL_TEXTURE_2D);
-	return this;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, mColorCount, mWidth, mHeight, 0, mTextureFormat, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	if (mHasMipmap)
+		glGenerateMipmap(GL_TEXTURE_2D);
 }
 
 
-ITexture* Texture::image() {
+void Texture::uploadCompressed() {
+	// the chain comes from the file, glGenerateMipmap can't encode blocks. A file without
+	// one is sampled at its base level only
+	const size_t levelCount = mHasMipmap? mCompressed.getLevelCount() : 1;
 	bind();
-	glTexImage2D(GL_TEXTURE_2D, 0, mColorCount, mWidth, mHeight, 0, mTextureFormat, GL_UNSIGNED_BYTE, &mPixels[0]);
+	for (size_t i = 0; i < levelCount; i++) {
+		const CompressedImage::Level& level = mCompressed.getLevel(i);
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), mCompressed.getInternalFormat(), level.width, level.height, 0,
+							   static_cast<GLsizei>(level.data.size()), level.data.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+	RENDER_STATS_UPLOAD(mCompressed.getMemorySize(levelCount));
+}
+
+
+ITexture* Texture::mipmap() {
+	mHasMipmap = true;
+	return image();
+}
+
+
+ITexture* Texture::image() {
+	// the loaded pixels replace the placeholder when they are ready
+	mHasImage = true;
+	upload(mPixels.empty()? nullptr : mPixels.data());
 	return this;
 }
 
@@ -139,15 +199,16 @@ ITexture *Texture::update(SDL_Surface *surface) {
 	const unsigned int sizeTexture = mWidth * mHeight * mColorCount;
 	if (mPBO == 0) {
 		glGenBuffers(1, &mPBO);
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
+		GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
 		glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeTexture, 0, GL_STREAM_DRAW);
 	}
 
 	bind();
-	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
+	GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mWidth, mHeight, mTextureFormat, GL_UNSIGNED_BYTE, 0);
 
 	glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeTexture, 0, GL_STREAM_DRAW);
+	RENDER_STATS_UPLOAD(sizeTexture);
 	Uint32* ptr = static_cast<Uint32*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
 	if (ptr) {
 		const Uint32* pixels0 = static_cast<const Uint32*>(surface->pixels);
@@ -164,7 +225,7 @@ ITexture *Texture::update(SDL_Surface *surface) {
 		}
 		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER); // release pointer to mapping buffer
 	}
-	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
 	return this;
 }
@@ -237,6 +298,9 @@ void Texture::write(ISerializer *serializer) const {
 		serializer->write(mWidth);
 		serializer->write(mHeight);
 		serializer->write(mPixels);
+	} else {
+		// read back through the TextureCache
+		serializer->write(static_cast<unsigned int>(TextureCache::MIPMAP | TextureCache::REPEAT));
 	}
 }
 
@@ -266,11 +330,17 @@ std::pair<std::string,Factory> Texture::factory() {
 
 			o = std::make_shared<Texture>(slot, colorCount, textureFormat, width, height, std::move(pixels0));
 		} else {
-			o = std::make_shared<Texture>(slot, filename);
+			// shared with the other objects using the file and the sampler
+			unsigned int sampler;
+			serializer->read(sampler);
+			std::shared_ptr<SharedTexture> shared = TextureCache::get().load(slot, filename, sampler);
+			shared->setObjectId(objectId);
+			shared->scaleFactor(scaleFactor);
+			return std::static_pointer_cast<ISerializable>(shared);
 		}
 		o->setObjectId(objectId);
 		o->scaleFactor(scaleFactor);
-		return o;
+		return std::static_pointer_cast<ISerializable>(o);
 	};
 	return std::make_pair(SERIALIZE_ID, Factory(factory));
 }
@@ -3,8 +3,13 @@
 
 #include <string>
 #include <functional>
+#if defined(__APPLE__)
 #include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
 #include "../app/Interfaces.h"
+#include "CompressedImage.h"
 
 
 class Texture: public ITexture
@@ -19,8 +24,13 @@ class Texture: public ITexture
 	unsigned int mWidth;
 	unsigned int mHeight;
 	std::vector<Uint32> mPixels;
+	CompressedImage mCompressed;
+	bool mIsLoaded {true};
+	bool mHasImage {false};
+	bool mHasMipmap {false};
 
-	void loadPixels(const void* pixels);
+	void upload(const void* pixels);
+	void uploadCompressed();
 public:
 	static const std::string& SERIALIZE_ID;
 
@@ -51,6 +61,23 @@ public:
 	virtual float getScaleFactor() override;
 	virtual void setFromSurface(const SDL_Surface* img) override;
 
+	/** the rows of the surface packed in pixels, throws if it is not truecolor. Any thread */
+	static void readSurface(const SDL_Surface* surface, int& colorCount, GLenum& format, std::vector<Uint32>& pixels);
+
+	const std::string& getFileName() const noexcept;
+	/** of the texel data, with the mipmaps */
+	size_t getMemorySize() const noexcept;
+
+	/** false while the file is loaded by the TextureLoader */
+	bool isLoaded() const noexcept;
+	/** image() was called, the pixels are uploaded as soon as they are set */
+	bool hasImage() const noexcept;
+	/** of the TextureLoader, staged: the pixels are in the bound unpack buffer */
+	void setLoadedPixels(int colorCount, GLenum format, unsigned int width, unsigned int height, std::vector<Uint32>&& pixels, bool staged);
+	/** of the TextureLoader, the file converted by gamedev3d_texconv: uploaded with its mip chain */
+	void setLoadedImage(CompressedImage&& image);
+	bool isCompressed() const noexcept;
+
 	virtual void write(ISerializer *serializer) const override;
 	virtual const std::string& serializeID() const noexcept override;
 	static std::pair<std::string,Factory> factory();
@@ -70,5 +97,17 @@ inline unsigned int Texture::getWidth() const noexcept
 inline unsigned int Texture::getHeight() const noexcept
 { return mHeight; }
 
+inline const std::string& Texture::getFileName() const noexcept
+{ return mFileName; }
+
+inline bool Texture::isLoaded() const noexcept
+{ return mIsLoaded; }
+
+inline bool Texture::hasImage() const noexcept
+{ return mHasImage; }
+
+inline bool Texture::isCompressed() const noexcept
+{ return !mCompressed.isEmpty(); }
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "TextureCache.h"
+#include "GLState.h"
+#include "Log.h"
+
+
+SharedTexture::SharedTexture(GLuint slot, std::shared_ptr<Texture> texture, unsigned int sampler):
+	mTexture(std::move(texture)),
+	mSlot(slot),
+	mSampler(sampler)
+{}
+
+
+ITexture* SharedTexture::ignore(const char* setter) {
+	Log::error("%s ignored on the shared texture %s, its sampler is set by TextureCache::load()", setter, mTexture->getFileName().c_str());
+	return this;
+}
+
+
+void SharedTexture::bind() const {
+	GLState::get().bindTexture(mSlot, mTexture->getID());
+}
+
+
+ITexture* SharedTexture::mipmap() {
+	return (mSampler & TextureCache::MIPMAP)? this : ignore("mipmap()");
+}
+
+
+// the cache uploads the image of every texture
+ITexture* SharedTexture::image() {
+	return this;
+}
+
+
+ITexture* SharedTexture::update(SDL_Surface* surface) {
+	return ignore("update()");
+}
+
+
+ITexture* SharedTexture::linear() {
+	return (mSampler & TextureCache::NEAREST)? ignore("linear()") : this;
+}
+
+
+ITexture* SharedTexture::nearest() {
+	return (mSampler & TextureCache::NEAREST)? this : ignore("nearest()");
+}
+
+
+ITexture* SharedTexture::wrap(GLint value) {
+	const GLint current = (mSampler & TextureCache::CLAMP_TO_EDGE)? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	return value == current? this : ignore("wrap()");
+}
+
+
+ITexture* SharedTexture::repeat() {
+	return wrap(GL_REPEAT);
+}
+
+
+ITexture* SharedTexture::repeatMirrored() {
+	return wrap(GL_MIRRORED_REPEAT);
+}
+
+
+ITexture* SharedTexture::clampToBorder() {
+	return wrap(GL_CLAMP_TO_BORDER);
+}
+
+
+ITexture* SharedTexture::clampToEdge() {
+	return wrap(GL_CLAMP_TO_EDGE);
+}
+
+
+ITexture* SharedTexture::scaleFactor(float factor) {
+	mScaleFactor = factor;
+	return this;
+}
+
+
+float SharedTexture::getScaleFactor() {
+	return mScaleFactor;
+}
+
+
+void SharedTexture::setFromSurface(const SDL_Surface* surface) {
+	ignore("setFromSurface()");
+}
+
+
+void SharedTexture::write(ISerializer *serializer) const {
+	// the record of a Texture loaded from its file
+	serializer->writeBegin(serializeID(), getObjectId());
+	serializer->write(mSlot);
+	serializer->write(mScaleFactor);
+	serializer->write(mTexture->getFileName());
+	serializer->write(mSampler);
+}
+
+
+const std::string& SharedTexture::serializeID() const noexcept {
+	return Texture::SERIALIZE_ID;
+}
+
+//-----------------------------------------------------------------------------
+
+TextureCache::TextureCache():
+	mRequests(0),
+	mHits(0)
+{}
+
+
+TextureCache& TextureCache::get() {
+	static TextureCache cache;
+	return cache;
+}
+
+
+unsigned int TextureCache::normalize(unsigned int sampler) noexcept {
+	if (sampler & REPEAT)
+		sampler &= ~CLAMP_TO_EDGE;
+	return sampler & ~REPEAT;
+}
+
+
+std::string TextureCache::getKey(const std::string& fileName, unsigned int sampler) {
+	return fileName + "#" + std::to_string(sampler);
+}
+
+
+std::unique_ptr<SharedTexture> TextureCache::load(GLuint slot, const std::string& fileName, unsigned int sampler) {
+	mRequests++;
+	sampler = normalize(sampler);
+	std::weak_ptr<Texture>& entry = mTextures[getKey(fileName, sampler)];
+	std::shared_ptr<Texture> texture = entry.lock();
+	if (texture) {
+		mHits++;
+		return std::make_unique<SharedTexture>(slot, std::move(texture), sampler);
+	}
+
+	texture = std::make_shared<Texture>(slot, fileName);
+	if (sampler & NEAREST)
+		texture->nearest();
+	if (sampler & CLAMP_TO_EDGE)
+		texture->clampToEdge();
+	if (sampler & MIPMAP)
+		texture->mipmap();
+	else
+		texture->image();
+	entry = texture;
+	return std::make_unique<SharedTexture>(slot, std::move(texture), sampler);
+}
+
+
+void TextureCache::report() {
+	size_t total = 0;
+	size_t saved = 0;
+	for (auto it = mTextures.begin(); it != mTextures.end();) {
+		std::shared_ptr<Texture> texture = it->second.lock();
+		if (!texture) {
+			it = mTextures.erase(it);
+			continue;
+		}
+		// the cache holds weak references only, the count is of the objects
+		const long users = texture.use_count() - 1;
+		const size_t size = texture->getMemorySize();
+		total += size;
+		saved += size * (users - 1);
+		Log::info("%s: %ux%u%s, %lu KB, %ld users%s", it->first.c_str(), texture->getWidth(), texture->getHeight(),
+				  texture->isCompressed()? " compressed" : "", static_cast<unsigned long>(size / 1024), users,
+				  texture->isLoaded()? "" : " (loading)");
+		++it;
+	}
+	Log::info("Texture cache: %u textures, %lu KB, %lu KB saved by sharing, %u of %u loads shared",
+			  static_cast<unsigned int>(mTextures.size()), static_cast<unsigned long>(total / 1024),
+			  static_cast<unsigned long>(saved / 1024), mHits, mRequests);
+}
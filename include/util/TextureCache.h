@@ -0,0 +1,108 @@
+#ifndef GAMEDEV3D_TEXTURE_CACHE_H
+#define GAMEDEV3D_TEXTURE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Texture.h"
+
+/**
+ * Image file shared by several objects: a slot and a scale factor of its own around the
+ * texture of the TextureCache. The sampler state (mipmaps, wrap, filter) and the pixels
+ * are the ones of the shared texture, set once by the cache: the setters asking for
+ * another state are logged and ignored, pick the sampler in TextureCache::load().
+ * Serialized as a Texture loaded from its file, with the sampler flags.
+ */
+
+class SharedTexture: public ITexture {
+	std::shared_ptr<Texture> mTexture;
+	GLuint mSlot;
+	unsigned int mSampler; // TextureCache::Sampler flags, normalized
+	float mScaleFactor {1.f};
+
+	ITexture* ignore(const char* setter);
+
+	// Texture::factory() reads the records
+	friend class Texture;
+
+public:
+	SharedTexture(GLuint slot, std::shared_ptr<Texture> texture, unsigned int sampler);
+
+	const std::shared_ptr<Texture>& getTexture() const noexcept;
+
+	virtual GLuint getSlot() const noexcept override;
+	virtual GLuint getID() const noexcept override;
+	virtual unsigned int getWidth() const noexcept override;
+	virtual unsigned int getHeight() const noexcept override;
+
+	virtual void bind() const override;
+	/** no-ops when the shared texture already has that state, ignored otherwise */
+	virtual ITexture* mipmap() override;
+	virtual ITexture* image() override;
+	virtual ITexture* update(SDL_Surface*) override;
+	virtual ITexture* linear() override;
+	virtual ITexture* nearest() override;
+	virtual ITexture* wrap(GLint value) override;
+	virtual ITexture* repeat() override;
+	virtual ITexture* repeatMirrored() override;
+	virtual ITexture* clampToBorder() override;
+	virtual ITexture* clampToEdge() override;
+	virtual ITexture* scaleFactor(float) override;
+	virtual float getScaleFactor() override;
+	virtual void setFromSurface(const SDL_Surface* img) override;
+
+	virtual void write(ISerializer *serializer) const override;
+	virtual const std::string& serializeID() const noexcept override;
+};
+
+/**
+ * Textures loaded from files, keyed by path and sampler: the objects asking for the same
+ * file with the same sampler share one GL texture, released with its last SharedTexture.
+ * report() logs the memory of the live textures and what the sharing saves. GL thread only.
+ */
+
+class TextureCache {
+public:
+	enum Sampler: unsigned int {
+		MIPMAP = 1,
+		REPEAT = 2,
+		CLAMP_TO_EDGE = 4,
+		NEAREST = 8
+	};
+
+private:
+	std::unordered_map<std::string, std::weak_ptr<Texture>> mTextures;
+	unsigned int mRequests;
+	unsigned int mHits;
+
+	TextureCache();
+	/** REPEAT is the GL default, the flags giving the same GL state are the same */
+	static unsigned int normalize(unsigned int sampler) noexcept;
+	static std::string getKey(const std::string& fileName, unsigned int sampler);
+
+public:
+	static TextureCache& get();
+
+	/** sampler: Sampler flags, REPEAT wins over CLAMP_TO_EDGE. The image is uploaded (with mipmaps if asked) */
+	std::unique_ptr<SharedTexture> load(GLuint slot, const std::string& fileName, unsigned int sampler = MIPMAP | REPEAT);
+	void report();
+};
+
+//-----------------------------------------------------------------------------
+
+inline const std::shared_ptr<Texture>& SharedTexture::getTexture() const noexcept
+{ return mTexture; }
+
+inline GLuint SharedTexture::getSlot() const noexcept
+{ return mSlot; }
+
+inline GLuint SharedTexture::getID() const noexcept
+{ return mTexture->getID(); }
+
+inline unsigned int SharedTexture::getWidth() const noexcept
+{ return mTexture->getWidth(); }
+
+inline unsigned int SharedTexture::getHeight() const noexcept
+{ return mTexture->getHeight(); }
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "TextureLoader.h"
+#include "Texture.h"
+#include "GLState.h"
+#include "IoUtils.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+constexpr const float TextureLoader::DEFAULT_BUDGET_MS;
+
+
+TextureLoader::TextureLoader():
+	mJobSystem(nullptr),
+	mBudgetMs(DEFAULT_BUDGET_MS),
+	mPbo(0)
+{}
+
+
+TextureLoader& TextureLoader::get() {
+	// the buffer is not deleted, the GL context is gone when static objects are destroyed
+	static TextureLoader loader;
+	return loader;
+}
+
+
+void TextureLoader::setJobSystem(IJobSystem* jobSystem) {
+	mJobSystem = jobSystem;
+}
+
+
+void TextureLoader::setBudget(float ms) {
+	mBudgetMs = ms;
+}
+
+
+void TextureLoader::queryCompressedFormats() {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+	mCompressedFormats.resize(count);
+	if (count > 0)
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, mCompressedFormats.data());
+	// core since GL 3.0, but the drivers don't have to list it
+	mCompressedFormats.push_back(GL_COMPRESSED_RG_RGTC2);
+}
+
+
+bool TextureLoader::isSupported(GLenum compressedFormat) const {
+	return std::find(mCompressedFormats.begin(), mCompressedFormats.end(), static_cast<GLint>(compressedFormat)) != mCompressedFormats.end();
+}
+
+
+void TextureLoader::decode(Request& request) const {
+	PROFILE_SCOPE("texture decode");
+	const std::string& compressedName = CompressedImage::getFileName(request.fileName);
+	if (IoUtils::fileExists(compressedName)) {
+		try {
+			CompressedImage image = CompressedImage::read(compressedName);
+			if (isSupported(image.getInternalFormat())) {
+				request.width = image.getWidth();
+				request.height = image.getHeight();
+				request.compressed = std::move(image);
+				return;
+			}
+			Log::info("%s: %s not supported by the driver", compressedName.c_str(), CompressedImage::getFormatName(image.getInternalFormat()));
+		} catch (const std::runtime_error& e) {
+			// the image itself is loaded then
+			Log::error(e.what());
+		}
+	}
+
+	SDL_Surface* surface = IMG_Load(request.fileName.c_str());
+	if (!surface) {
+		request.failed = true;
+		return;
+	}
+	try {
+		Texture::readSurface(surface, request.colorCount, request.format, request.pixels);
+		request.width = static_cast<unsigned int>(surface->w);
+		request.height = static_cast<unsigned int>(surface->h);
+	} catch (const std::runtime_error&) {
+		request.failed = true;
+	}
+	SDL_FreeSurface(surface);
+}
+
+
+void TextureLoader::load(Texture* texture, const std::string& fileName) {
+	auto request = std::make_shared<Request>();
+	request->texture = texture;
+	request->fileName = fileName;
+	request->failed = false;
+	if (mCompressedFormats.empty())
+		queryCompressedFormats();
+
+	if (!mJobSystem) {
+		decode(*request);
+		if (request->failed) {
+			Log::error("Unable to load texture: %s", fileName.c_str());
+			throw std::runtime_error(std::string("Unable to load texture: ") + fileName);
+		}
+		if (!request->compressed.isEmpty()) {
+			texture->setLoadedImage(std::move(request->compressed));
+			return;
+		}
+		texture->setLoadedPixels(request->colorCount, request->format, request->width, request->height, std::move(request->pixels), false);
+		return;
+	}
+
+	mRequests.push_back(request);
+	mJobSystem->submit([this, request]() {
+		decode(*request);
+		std::lock_guard<std::mutex> lock(mMutex);
+		mDecoded.push_back(request);
+	});
+}
+
+
+void TextureLoader::cancel(const Texture* texture) {
+	for (auto& request : mRequests) {
+		if (request->texture == texture)
+			request->texture = nullptr;
+	}
+}
+
+
+void TextureLoader::upload(Request& request) {
+	Texture* texture = request.texture;
+	if (!texture)
+		return;
+	if (request.failed) {
+		Log::error("Unable to load texture: %s", request.fileName.c_str());
+		return;
+	}
+
+	if (!request.compressed.isEmpty()) {
+		// a fraction of the size of the pixels, uploaded from memory
+		texture->setLoadedImage(std::move(request.compressed));
+		return;
+	}
+
+	if (!texture->hasImage()) {
+		// nothing to upload yet, image() will
+		texture->setLoadedPixels(request.colorCount, request.format, request.width, request.height, std::move(request.pixels), false);
+		return;
+	}
+
+	// the copy goes to a buffer the driver can read while the frame goes on
+	const size_t size = request.width * request.height * request.colorCount;
+	if (mPbo == 0)
+		glGenBuffers(1, &mPbo);
+	GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, mPbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	const bool staged = staging != nullptr;
+	if (staged) {
+		std::memcpy(staging, request.pixels.data(), size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	} else {
+		GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	RENDER_STATS_UPLOAD(size);
+
+	texture->setLoadedPixels(request.colorCount, request.format, request.width, request.height, std::move(request.pixels), staged);
+	GLState::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+
+void TextureLoader::update() {
+	if (mRequests.empty())
+		return;
+
+	PROFILE_SCOPE("texture upload");
+	const auto start = std::chrono::steady_clock::now();
+	for (;;) {
+		std::shared_ptr<Request> request;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mDecoded.empty())
+				break;
+			request = mDecoded.front();
+			mDecoded.pop_front();
+		}
+
+		upload(*request);
+		mRequests.erase(std::find(mRequests.begin(), mRequests.end(), request));
+		if (mRequests.empty())
+			Log::info("Textures loaded");
+
+		// at least one upload per frame, so a large file can't stall the loading
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= mBudgetMs)
+			break;
+	}
+}
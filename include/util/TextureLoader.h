@@ -0,0 +1,83 @@
+#ifndef GAMEDEV3D_TEXTURE_LOADER_H
+#define GAMEDEV3D_TEXTURE_LOADER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../app/Interfaces.h"
+#include "CompressedImage.h"
+
+class Texture;
+
+/**
+ * Image files decoded on the workers of the job system and uploaded on the GL thread by
+ * update(), through a pixel buffer object, until the time budget of the frame is spent.
+ * The texture shows a 1x1 placeholder meanwhile (grey, transparent so alpha tested
+ * vegetation stays hidden). Without a job system the files are decoded on the caller.
+ *
+ * An image converted by gamedev3d_texconv (foo.jpg -> foo.ktx) is read instead of the image
+ * when the driver has its format, and uploaded as it is: the .ktx must be converted again
+ * when the image changes.
+ */
+
+class TextureLoader {
+	typedef struct {
+		Texture* texture; // nullptr once the texture is deleted, GL thread only
+		std::string fileName;
+		int colorCount;
+		GLenum format;
+		unsigned int width;
+		unsigned int height;
+		std::vector<Uint32> pixels;
+		CompressedImage compressed; // instead of the pixels
+		bool failed;
+	} Request;
+
+	IJobSystem* mJobSystem;
+	float mBudgetMs;
+	GLuint mPbo;
+	// of the driver, read by the workers once set by the first load()
+	std::vector<GLint> mCompressedFormats;
+
+	// not uploaded yet, GL thread only
+	std::vector<std::shared_ptr<Request>> mRequests;
+	// decoded by the workers, guarded by mMutex
+	std::mutex mMutex;
+	std::deque<std::shared_ptr<Request>> mDecoded;
+
+	TextureLoader();
+	void queryCompressedFormats();
+	bool isSupported(GLenum compressedFormat) const;
+	void decode(Request& request) const;
+	void upload(Request& request);
+
+public:
+	static constexpr const float DEFAULT_BUDGET_MS = 2.f;
+
+	static TextureLoader& get();
+
+	/** nullptr: the files are decoded and handed to the texture right away */
+	void setJobSystem(IJobSystem* jobSystem);
+	void setBudget(float ms);
+	float getBudget() const noexcept;
+
+	/** GL thread, the texture must show its placeholder until the upload */
+	void load(Texture* texture, const std::string& fileName);
+	void cancel(const Texture* texture);
+
+	/** GL thread, once per frame: uploads the decoded files within the budget */
+	void update();
+	size_t getPendingCount() const noexcept;
+};
+
+//-----------------------------------------------------------------------------
+
+inline float TextureLoader::getBudget() const noexcept
+{ return mBudgetMs; }
+
+inline size_t TextureLoader::getPendingCount() const noexcept
+{ return mRequests.size(); }
+
+#endif
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <cstring>
+#include "UniformBlock.h"
+#include "Log.h"
+#include "GLState.h"
+#include "RenderStats.h"
+
+
+UniformBlock::UniformBlock(Binding binding):
+	mBinding(binding),
+	mBuffer(0),
+	mSize(0)
+{}
+
+
+bool UniformBlock::isSupported() {
+	static const bool supported = [] {
+		int major = 0, minor = 0;
+		const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		bool hasBuffers = version && std::sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 3 || (major == 3 && minor >= 1));
+		if (!hasBuffers) {
+			// only legacy contexts get here, they still have the extension string
+			const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+			hasBuffers = extensions && std::strstr(extensions, "GL_ARB_uniform_buffer_object");
+		}
+		Log::info("Uniform buffers %s (GL %s)", hasBuffers? "enabled" : "not available", version? version : "?");
+		return hasBuffers;
+	}();
+	return supported;
+}
+
+
+UniformBlock& UniformBlock::get(Binding binding) {
+	// the buffers are not deleted, the GL context is gone when static objects are destroyed
+	static UniformBlock blocks[BINDING_COUNT] = {
+		UniformBlock(VIEW), UniformBlock(SKY), UniformBlock(SHADOW), UniformBlock(REFLECTION)
+	};
+	return blocks[binding];
+}
+
+
+const char* UniformBlock::getName(Binding binding) noexcept {
+	static constexpr const char* names[BINDING_COUNT] = { "ViewBlock", "SkyBlock", "ShadowBlock", "ReflectionBlock" };
+	return names[binding];
+}
+
+
+unsigned int UniformBlock::bindProgram(GLuint program) {
+	if (!isSupported())
+		return 0;
+
+	unsigned int mask = 0;
+	for (GLuint i = 0; i < BINDING_COUNT; i++) {
+		const Binding binding = static_cast<Binding>(i);
+		const GLuint index = glGetUniformBlockIndex(program, getName(binding));
+		if (index == GL_INVALID_INDEX)
+			continue;
+		glUniformBlockBinding(program, index, binding);
+		mask |= 1u << binding;
+	}
+	return mask;
+}
+
+
+void UniformBlock::update(const void* data, size_t size) {
+	if (!isSupported())
+		return;
+
+	if (mBuffer == 0 || size != mSize) {
+		if (mBuffer == 0)
+			glGenBuffers(1, &mBuffer);
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		GLState::get().bindBufferBase(GL_UNIFORM_BUFFER, mBinding, mBuffer);
+		mSize = size;
+	} else {
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	}
+	GLState::get().bindBuffer(GL_UNIFORM_BUFFER, 0);
+	RENDER_STATS_UPLOAD(size);
+}
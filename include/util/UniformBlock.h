@@ -0,0 +1,139 @@
+#ifndef GAMEDEV3D_UNIFORM_BLOCK_H
+#define GAMEDEV3D_UNIFORM_BLOCK_H
+
+#include "GLHeaders.h"
+#include <cstddef>
+
+/**
+ * Uniform buffer with the parameters shared by the programs of a pass (camera matrices, sky,
+ * shadow cascades, reflection) in std140 layout. The owner of the data updates it once per
+ * pass, every program declaring the block reads it from the same binding point.
+ *
+ * The *_CODE declarations fall back to plain uniforms when the driver has no uniform
+ * buffers, IShader::hasUniformBlock() is then false and the owners set them per program.
+ * The shadow block is declared in ShadowMap::getFragmentShaderCode().
+ * GL thread only.
+ */
+
+class UniformBlock {
+public:
+	enum Binding: GLuint {
+		VIEW,
+		SKY,
+		SHADOW,
+		REFLECTION,
+		BINDING_COUNT
+	};
+
+	// std140: a vec3 takes 16 bytes, unless a float fills the gap
+	typedef struct {
+		float V[16];
+		float P[16];
+	} ViewData;
+
+	typedef struct {
+		float cameraPosition[3];
+		float planetRadius;
+		float sunPosition[3];
+		float dotOriginToSun;
+		float dotOriginToHorizon;
+		float dotOriginToWaterLevel;
+		float ambientLight;
+		float diffuseLight;
+	} SkyData;
+
+	typedef struct {
+		float shadowMVP[4][16];
+		float cascadeSplits[4];
+		float shadowCameraPosition[3];
+		float shadowSize;
+		float shadowCameraDirection[3];
+		float shadowDistance;
+		float shadowTileScale;
+		float padding[3];
+	} ShadowData;
+
+	typedef struct {
+		GLint isRenderingReflection;
+		float waterLevel;
+		float distanceToHorizon;
+		float padding;
+	} ReflectionData;
+
+	// prepended to every shader by Shader, blocks need the extension before GLSL 1.40
+	static constexpr const char* EXTENSION_CODE =
+		"#extension GL_ARB_uniform_buffer_object : enable\n";
+
+	static constexpr const char* VIEW_CODE =
+		"\n#ifdef GL_ARB_uniform_buffer_object\n"
+		"layout(std140) uniform ViewBlock {"
+			"mat4 V;"
+			"mat4 P;"
+		"};"
+		"\n#else\n"
+		"uniform mat4 V;"
+		"uniform mat4 P;"
+		"\n#endif\n";
+
+	static constexpr const char* SKY_CODE =
+		"\n#ifdef GL_ARB_uniform_buffer_object\n"
+		"layout(std140) uniform SkyBlock {"
+			"vec3 cameraPosition;"
+			"float planetRadius;"
+			"vec3 sunPosition;"
+			"float dotOriginToSun;"
+			"float dotOriginToHorizon;"
+			"float dotOriginToWaterLevel;"
+			"float ambientLight;"
+			"float diffuseLight;"
+		"};"
+		"\n#else\n"
+		"uniform vec3 cameraPosition;"
+		"uniform float planetRadius;"
+		"uniform vec3 sunPosition;"
+		"uniform float dotOriginToSun;"
+		"uniform float dotOriginToHorizon;"
+		"uniform float dotOriginToWaterLevel;"
+		"uniform float ambientLight;"
+		"uniform float diffuseLight;"
+		"\n#endif\n";
+
+	static constexpr const char* REFLECTION_CODE =
+		"\n#ifdef GL_ARB_uniform_buffer_object\n"
+		"layout(std140) uniform ReflectionBlock {"
+			"bool isRenderingReflection;"
+			"float waterLevel;"
+			"float distanceToHorizon;"
+		"};"
+		"\n#else\n"
+		"uniform bool isRenderingReflection;"
+		"uniform float waterLevel;"
+		"uniform float distanceToHorizon;"
+		"\n#endif\n";
+
+private:
+	Binding mBinding;
+	GLuint mBuffer;
+	size_t mSize;
+
+	explicit UniformBlock(Binding binding);
+
+public:
+	/** GL 3.1 or GL_ARB_uniform_buffer_object, needs a current context */
+	static bool isSupported();
+	static UniformBlock& get(Binding binding);
+	static const char* getName(Binding binding) noexcept;
+
+	/** binds the blocks declared by the linked program, returns their mask (1 << binding) */
+	static unsigned int bindProgram(GLuint program);
+
+	void update(const void* data, size_t size);
+	template <typename T> void update(const T& data);
+};
+
+//-----------------------------------------------------------------------------
+
+template <typename T> inline void UniformBlock::update(const T& data)
+{ update(&data, sizeof(T)); }
+
+#endif
@@ -0,0 +1,60 @@
+#include "VertexArray.h"
+
+
+VertexArray::VertexArray():
+	mVao(0)
+{}
+
+
+VertexArray::~VertexArray() {
+	reset();
+}
+
+
+VertexArray::VertexArray(VertexArray&& other) noexcept:
+	mVao(other.mVao)
+{
+	other.mVao = 0;
+}
+
+
+VertexArray& VertexArray::operator=(VertexArray&& other) noexcept {
+	if (this != &other) {
+		reset();
+		mVao = other.mVao;
+		other.mVao = 0;
+	}
+	return *this;
+}
+
+
+void VertexArray::reset() {
+	if (mVao != 0) {
+		GLState::get().deleteVertexArrays(1, &mVao);
+		mVao = 0;
+	}
+}
+
+
+void VertexArray::begin() {
+	if (mVao == 0)
+		glGenVertexArrays(1, &mVao);
+	GLState::get().bindVertexArray(mVao);
+}
+
+
+void VertexArray::end() {
+	// the element buffer stays recorded, only the array buffer binding is global state
+	GLState::get().bindVertexArray(0);
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+void VertexArray::attribute(GLuint index, GLuint buffer, GLint size, GLsizei stride, size_t offset, GLuint divisor) {
+	GLState::get().bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const GLvoid*>(offset));
+	if (divisor != 0)
+		glVertexAttribDivisor(index, divisor);
+}
@@ -0,0 +1,55 @@
+#ifndef GAMEDEV3D_VERTEX_ARRAY_H
+#define GAMEDEV3D_VERTEX_ARRAY_H
+
+#include "GLHeaders.h"
+#include <cstddef>
+#include "GLState.h"
+
+/**
+ * Vertex array object: the attribute pointers, enabled arrays, divisors and element buffer
+ * of a mesh, recorded once when the mesh is bound. A draw is then bind() and glDraw*().
+ *
+ * The object is created by the first begin(), so meshes can be built off the GL thread
+ * and bound later. Buffers are bound for the duration of the recording only, an element
+ * buffer must not be unbound while the array is bound (it would be recorded as 0).
+ */
+
+class VertexArray {
+	GLuint mVao;
+
+public:
+	VertexArray();
+	~VertexArray();
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
+	VertexArray(VertexArray&& other) noexcept;
+	VertexArray& operator=(VertexArray&& other) noexcept;
+
+	bool isCreated() const noexcept;
+
+	/** binds the array, attribute() and the element buffer binding are recorded until end() */
+	void begin();
+	static void end();
+
+	/** enables the array and points it to the buffer, the buffer is left bound */
+	static void attribute(GLuint index, GLuint buffer, GLint size, GLsizei stride, size_t offset, GLuint divisor = 0);
+
+	void bind() const;
+	static void unbind();
+
+	/** deletes the object, the next begin() creates a new one */
+	void reset();
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool VertexArray::isCreated() const noexcept
+{ return mVao != 0; }
+
+inline void VertexArray::bind() const
+{ GLState::get().bindVertexArray(mVao); }
+
+inline void VertexArray::unbind()
+{ GLState::get().bindVertexArray(0); }
+
+#endif
@@ -16,6 +16,11 @@ Matrix4x4 &Matrix4x4::operator=(const btTransform& transform) {
 }
 
 
+btTransform Matrix4x4::getTransform() const {
+	return btTransform(btMatrix3x3(getRow(0), getRow(1), getRow(2)), getOrigin());
+}
+
+
 void Matrix4x4::identity() noexcept {
 	mData[0] = mData[5] = mData[10] = mData[15] = 1.0f;
 	mData[1] = mData[2] = mData[3] = 0.f;
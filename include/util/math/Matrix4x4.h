@@ -26,6 +26,7 @@ public:
 	Matrix4x4& operator=(const Matrix4x4&) = default;
 	Matrix4x4& operator=(Matrix4x4&&) = default;
 	Matrix4x4& operator=(const btTransform&);
+	btTransform getTransform() const;
 
 	template<unsigned int N>
 	Matrix4x4& operator=(const float (&m)[N]) {
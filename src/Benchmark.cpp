@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/app/Serializer.h"
+#include "../include/scene/planet/Planet.h"
+#include "../include/scene/planet/PlanetPage.h"
+#include "../include/util/BvhAnimation.h"
+#include "../include/util/IoUtils.h"
+#include "../include/util/ModelOBJ.h"
+#include "../include/util/math/FieldOfView.h"
+#include "../include/util/math/Line.h"
+#include "../include/util/math/Matrix4x4.h"
+#include "../include/util/math/Triangle.h"
+
+/**
+ * CPU microbenchmarks of the hot paths, no window or GL context is created.
+ *
+ * Each case is calibrated until a sample lasts at least --min-time ms, then runs --samples
+ * samples of that many iterations. Compare the medians: --json <file> writes them for a
+ * diff between commits. The engine logs go to /dev/null unless --verbose is given.
+ *
+ * gamedev3d_benchmark [--filter <text>] [--samples <n>] [--min-time <ms>] [--json <file>] [--verbose]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr const float PLANET_RADIUS = 6000.f; // same planet as Main
+static constexpr const float WATER_LEVEL = PLANET_RADIUS - 0.2f;
+static constexpr const unsigned int FACE_DIVISIONS = 9;
+static constexpr const unsigned int PAGE_DIVISIONS = 32;
+static constexpr const size_t INPUT_COUNT = 1024; // power of 2, inputs are cycled with a mask
+
+// the compiler can't drop a computation whose result is kept
+template <typename T> inline void keep(const T& value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+typedef struct {
+	std::string name;
+	unsigned long iterations; // per sample
+	unsigned int samples;
+	double medianNs; // per iteration
+	double minNs;
+	double meanNs;
+	double stddevNs;
+} Result;
+
+class Benchmark {
+	struct Case {
+		std::string name;
+		std::function<void(unsigned long)> run; // runs n iterations
+		std::function<void()> cleanup; // after the samples, not timed
+	};
+
+	std::vector<Case> mCases;
+	std::vector<Result> mResults;
+	unsigned int mSamples;
+	double mMinTimeNs;
+
+	double time(const Case& c, unsigned long iterations) const {
+		const Clock::time_point start = Clock::now();
+		c.run(iterations);
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+public:
+	Benchmark(unsigned int samples, double minTimeMs):
+		mSamples(samples),
+		mMinTimeNs(minTimeMs * 1e6)
+	{}
+
+	void add(const std::string& name, std::function<void(unsigned long)> run, std::function<void()> cleanup = nullptr) {
+		mCases.push_back({ name, std::move(run), std::move(cleanup) });
+	}
+
+	void run(const std::string& filter) {
+		for (const Case& c : mCases) {
+			if (!filter.empty() && c.name.find(filter) == std::string::npos)
+				continue;
+
+			// warm up (caches, lazy setup), then grow the iterations until a sample is long enough
+			time(c, 1);
+			unsigned long iterations = 1;
+			double ns = time(c, iterations);
+			while (ns < mMinTimeNs) {
+				const double factor = ns < mMinTimeNs / 10.0? 10.0 : 1.2 * mMinTimeNs / ns;
+				iterations = static_cast<unsigned long>(std::ceil(iterations * factor));
+				ns = time(c, iterations);
+			}
+
+			std::vector<double> samples(mSamples);
+			for (double& sample : samples)
+				sample = time(c, iterations) / iterations;
+			std::sort(samples.begin(), samples.end());
+			if (c.cleanup)
+				c.cleanup();
+
+			double sum = 0.0;
+			for (double sample : samples)
+				sum += sample;
+			const double mean = sum / samples.size();
+			double variance = 0.0;
+			for (double sample : samples)
+				variance += (sample - mean) * (sample - mean);
+
+			Result result = { c.name, iterations, mSamples, samples[samples.size() / 2], samples.front(), mean,
+							  std::sqrt(variance / samples.size()) };
+			mResults.push_back(result);
+			fprintf(stderr, "%-45s %12.1f ns  (min %.1f, stddev %.1f%%, %lu x %u)\n", result.name.c_str(), result.medianNs,
+					result.minNs, 100.0 * result.stddevNs / result.meanNs, result.iterations, result.samples);
+		}
+	}
+
+	void writeJson(const std::string& fileName) const {
+		std::ofstream file(fileName);
+		if (!file)
+			throw std::runtime_error("Can't write benchmark results: " + fileName);
+
+		file << "{\"benchmarks\":[\n";
+		for (size_t i = 0; i < mResults.size(); i++) {
+			const Result& r = mResults[i];
+			file << (i > 0? ",\n" : "") << "{\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations
+				 << ",\"samples\":" << r.samples << ",\"median_ns\":" << r.medianNs << ",\"min_ns\":" << r.minNs
+				 << ",\"mean_ns\":" << r.meanNs << ",\"stddev_ns\":" << r.stddevNs << "}";
+		}
+		file << "\n]}\n";
+		fprintf(stderr, "Results written to %s\n", fileName.c_str());
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+// same inputs on every run
+static std::vector<btVector3> randomDirections(size_t count, unsigned int seed) {
+	std::mt19937 random(seed);
+	std::normal_distribution<float> normal;
+	std::vector<btVector3> directions;
+	directions.reserve(count);
+	while (directions.size() < count) {
+		btVector3 v(normal(random), normal(random), normal(random));
+		if (v.length2() > 1e-6f)
+			directions.push_back(v.normalized());
+	}
+	return directions;
+}
+
+
+// in the temporary folder, the benchmark leaves nothing behind
+static std::string tempFileName(const char* name) {
+	const char* folder = std::getenv("TMPDIR");
+	return std::string(folder && *folder? folder : "/tmp") + "/" + name;
+}
+
+
+static std::unique_ptr<PlanetPage> makePage() {
+	static const float step = 10.f / FACE_DIVISIONS;
+	return std::make_unique<PlanetPage>(1, "+zx", PLANET_RADIUS, WATER_LEVEL, -step / 2.f, -step / 2.f, step, 5.f, PAGE_DIVISIONS);
+}
+
+
+static void addPlanetCases(Benchmark& benchmark) {
+	// built on first use, the filter may skip them all
+	static std::shared_ptr<Planet> planet;
+	static const auto getPlanet = []() -> Planet& {
+		if (!planet)
+			planet = std::make_shared<Planet>(std::shared_ptr<btDynamicsWorld>(), PLANET_RADIUS, WATER_LEVEL, FACE_DIVISIONS, PAGE_DIVISIONS);
+		return *planet;
+	};
+	static const std::vector<btVector3> directions = randomDirections(INPUT_COUNT, 1);
+
+	benchmark.add("Planet::getHeightAt", [](unsigned long n){
+		const Planet& p = getPlanet();
+		for (unsigned long i = 0; i < n; i++)
+			keep(p.getHeightAt(directions[i & (INPUT_COUNT - 1)]));
+	});
+	benchmark.add("Planet::getPageId", [](unsigned long n){
+		const Planet& p = getPlanet();
+		for (unsigned long i = 0; i < n; i++)
+			keep(p.getPageId(PLANET_RADIUS * directions[i & (INPUT_COUNT - 1)]));
+	});
+	benchmark.add("PlanetPage::PlanetPage", [](unsigned long n){
+		for (unsigned long i = 0; i < n; i++)
+			keep(makePage());
+	});
+	benchmark.add("PlanetPage::calculateNormals", [](unsigned long n){
+		static std::unique_ptr<PlanetPage> page = makePage();
+		for (unsigned long i = 0; i < n; i++) {
+			page->calculateNormals(true);
+			keep(*page);
+		}
+	});
+	// the Serializer works on files only, the round trip goes through the temporary folder
+	static const std::string serializerFile = tempFileName("gamedev3d_benchmark.bin");
+	benchmark.add("Serializer/PlanetPage round trip", [](unsigned long n){
+		static std::unique_ptr<PlanetPage> page = makePage();
+		const std::string& fileName = serializerFile;
+		for (unsigned long i = 0; i < n; i++) {
+			Serializer serializer(fileName);
+			serializer.open(true);
+			page->write(&serializer);
+			serializer.close();
+			serializer.open();
+			keep(PlanetPage::create(&serializer, std::weak_ptr<btDynamicsWorld>()));
+			serializer.close();
+		}
+	}, [](){
+		std::remove(serializerFile.c_str());
+	});
+}
+
+
+static void addMathCases(Benchmark& benchmark) {
+	benchmark.add("Triangle::isInterceptedBy", [](unsigned long n){
+		// a triangle on the planet surface, about half of the lines go through it
+		static const Triangle triangle(btVector3(-1.f, -1.f, 10.f), btVector3(1.f, -1.f, 10.f), btVector3(0.f, 1.f, 10.f));
+		static std::vector<Line> lines;
+		if (lines.empty()) {
+			std::mt19937 random(2);
+			std::uniform_real_distribution<float> offset(-1.5f, 1.5f);
+			for (size_t i = 0; i < INPUT_COUNT; i++)
+				lines.emplace_back(btVector3(0.f, 0.f, 0.f), btVector3(offset(random), offset(random), 10.f));
+		}
+		btVector3 point;
+		for (unsigned long i = 0; i < n; i++) {
+			keep(triangle.isInterceptedBy(lines[i & (INPUT_COUNT - 1)], point));
+			keep(point);
+		}
+	});
+	benchmark.add("FieldOfView::isVisible", [](unsigned long n){
+		static const FieldOfView fov(btVector3(0.f, 0.f, 0.f), btVector3(-1.f, -1.f, 5.f), btVector3(-1.f, 1.f, 5.f),
+									 btVector3(1.f, 1.f, 5.f), btVector3(1.f, -1.f, 5.f));
+		static const std::vector<btVector3> directions = randomDirections(INPUT_COUNT, 3);
+		for (unsigned long i = 0; i < n; i++)
+			keep(fov.isVisible(directions[i & (INPUT_COUNT - 1)]));
+	});
+	benchmark.add("Matrix4x4::multiplyRight", [](unsigned long n){
+		Matrix4x4 m;
+		Matrix4x4 r;
+		r.rotate(0.01f, 0.f, 1.f, 0.f).translate(btVector3(1.f, 2.f, 3.f));
+		for (unsigned long i = 0; i < n; i++)
+			m.multiplyRight(r);
+		keep(m);
+	});
+	benchmark.add("Matrix4x4::rotate", [](unsigned long n){
+		Matrix4x4 m;
+		for (unsigned long i = 0; i < n; i++)
+			m.rotate(0.01f, 0.f, 1.f, 0.f);
+		keep(m);
+	});
+	benchmark.add("Matrix4x4::lookAt+perspective", [](unsigned long n){
+		static const std::vector<btVector3> directions = randomDirections(INPUT_COUNT, 4);
+		for (unsigned long i = 0; i < n; i++) {
+			Matrix4x4 v;
+			v.lookAt(btVector3(0.f, 0.f, 0.f), directions[i & (INPUT_COUNT - 1)], btVector3(0.f, 1.f, 0.f));
+			Matrix4x4 p;
+			p.perspective(45.f, 1.5f, 1.f, 10000.f).multiplyRight(v);
+			keep(p);
+		}
+	});
+	benchmark.add("Matrix4x4::Matrix4x4(btTransform)", [](unsigned long n){
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(btVector3(1.f, 2.f, 3.f));
+		for (unsigned long i = 0; i < n; i++) {
+			Matrix4x4 m(transform);
+			keep(m);
+		}
+	});
+}
+
+
+static void addFileCases(Benchmark& benchmark) {
+	static const char* models[] = {
+		"/model/soccer/soccerball.obj",
+		"/model/capsule/capsule.obj",
+		"/model/house/Farmhouse.obj",
+		"/model/soldier/soldier.obj",
+		"/model/vegetation/treeA.obj",
+		"/model/vehicle/pickup_lowpoly.obj"
+	};
+	for (const char* model : models) {
+		const std::string fileName = IoUtils::resource(model);
+		if (!IoUtils::fileExists(fileName)) {
+			fprintf(stderr, "Skipping %s: not found\n", fileName.c_str());
+			continue;
+		}
+		benchmark.add(std::string("ModelOBJ::import") + model, [fileName](unsigned long n){
+			for (unsigned long i = 0; i < n; i++) {
+				ModelOBJ obj;
+				if (!obj.import(fileName.c_str()))
+					throw std::runtime_error("Can't import " + fileName);
+				keep(obj.getNumberOfVertices());
+			}
+		});
+	}
+
+	static const char* animations[] = { "/bvh/Walk.bvh", "/bvh/Run.bvh", "/bvh/02_07.bvh" };
+	for (const char* animation : animations) {
+		const std::string fileName = IoUtils::resource(animation);
+		if (!IoUtils::fileExists(fileName)) {
+			fprintf(stderr, "Skipping %s: not found\n", fileName.c_str());
+			continue;
+		}
+		benchmark.add(std::string("BvhAnimation::parse") + animation, [fileName](unsigned long n){
+			for (unsigned long i = 0; i < n; i++) {
+				BvhAnimation bvh(fileName);
+				keep(bvh.getFrameCount());
+			}
+		});
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	std::string jsonFile;
+	unsigned int samples = 15;
+	double minTimeMs = 50.0;
+	bool verbose = false;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--filter" && hasValue)
+			filter = argv[++i];
+		else if (arg == "--samples" && hasValue)
+			samples = static_cast<unsigned int>(std::max(1, ::atoi(argv[++i])));
+		else if (arg == "--min-time" && hasValue)
+			minTimeMs = std::max(0.0, ::atof(argv[++i]));
+		else if (arg == "--json" && hasValue)
+			jsonFile = argv[++i];
+		else if (arg == "--verbose")
+			verbose = true;
+		else {
+			fprintf(stderr, "Usage: %s [--filter <text>] [--samples <n>] [--min-time <ms>] [--json <file>] [--verbose]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	// the loaders log every node and page, that would be timed too
+	if (!verbose && !freopen("/dev/null", "w", stdout))
+		fprintf(stderr, "Can't silence the logs\n");
+
+	try {
+		Benchmark benchmark(samples, minTimeMs);
+		addPlanetCases(benchmark);
+		addMathCases(benchmark);
+		addFileCases(benchmark);
+		benchmark.run(filter);
+
+		if (!jsonFile.empty())
+			benchmark.writeJson(jsonFile);
+	} catch (const std::runtime_error& e) {
+		Log::error(e.what());
+		return -1;
+	}
+	return 0;
+}
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
 
@@ -11,6 +12,9 @@
 
 #include "../include/app/Interfaces.h"
 #include "../include/app/Window.h"
+#ifdef GAMEDEV3D_HEADLESS
+#include "../include/app/HeadlessWindow.h"
+#endif
 #include "../include/app/Application.h"
 #include "../include/app/Serializer.h"
 #include "../include/scene/planet/Planet.h"
@@ -28,6 +32,7 @@
 #include "../include/scene/vegetation/Grass.h"
 #include "../include/scene/character/OBJCharacter.h"
 #include "../include/scene/character/KeyboardCharacterControl.h"
+#include "../include/util/TextureCache.h"
 
 static constexpr const char* WINDOW_TITLE = "Gamedev3d";
 
@@ -48,6 +53,7 @@ void loadFromFile(ISerializer* serializer, std::shared_ptr<IWindow> window) {
 	serializer->addFactory(Tree::factory());
 	serializer->addFactory(Grass::factory());
 
+	PROFILE_SCOPE("load");
 	serializer->open();
 
 	std::string className;
@@ -81,14 +87,16 @@ void buildNewScene(IGameScene* app, std::shared_ptr<IWindow> window) {
 
 	// SurfaceReflection
 	{
-		std::shared_ptr<ISurfaceReflection> surfaceReflection = std::make_shared<SurfaceReflection>(planetRadius, waterLevel, window->getWidth(), window->getHeight());
+		std::shared_ptr<SurfaceReflection> surfaceReflection = std::make_shared<SurfaceReflection>(planetRadius, waterLevel, window->getWidth(), window->getHeight());
 		app->setSurfaceReflection(surfaceReflection);
 		app->addSerializable(surfaceReflection);
+		app->addCommands(surfaceReflection->getCommands());
 	}
 
 	// ShadowMap
 	{
-		std::shared_ptr<ShadowMap> shadowMap = std::make_shared<ShadowMap>(0, 8192);
+		// 3 cascades of 2048x2048 in a 4096x4096 atlas
+		std::shared_ptr<ShadowMap> shadowMap = std::make_shared<ShadowMap>(0, 4096, 3);
 		app->setShadowMap(shadowMap);
 		app->addSerializable(shadowMap);
 	}
@@ -106,20 +114,20 @@ void buildNewScene(IGameScene* app, std::shared_ptr<IWindow> window) {
 //	std::shared_ptr<Planet> planet = std::make_shared<Planet>(app->getDynamicsWorld(), planetRadius, waterLevel, 17, 32);
 	std::shared_ptr<Planet> planet = std::make_shared<Planet>(app->getDynamicsWorld(), planetRadius, waterLevel, 9, 32);
 
-	std::unique_ptr<ITexture> mat0 = std::make_unique<Texture>(2, IoUtils::resource("/texture/grass.jpg"));
-	mat0->mipmap()->repeat()->scaleFactor(325.f);
+	std::unique_ptr<ITexture> mat0 = TextureCache::get().load(2, IoUtils::resource("/texture/grass.jpg"));
+	mat0->scaleFactor(325.f);
 	planet->setTexture(0, std::move(mat0));
 
-	std::unique_ptr<ITexture> mat1 = std::make_unique<Texture>(3, IoUtils::resource("/texture/dirt.jpg"));
-	mat1->mipmap()->repeat()->scaleFactor(200.f);
+	std::unique_ptr<ITexture> mat1 = TextureCache::get().load(3, IoUtils::resource("/texture/dirt.jpg"));
+	mat1->scaleFactor(200.f);
 	planet->setTexture(1, std::move(mat1));
 
-	std::unique_ptr<ITexture> mat2 = std::make_unique<Texture>(4, IoUtils::resource("/texture/stone.jpg"));
-	mat2->mipmap()->repeat()->scaleFactor(100.f);
+	std::unique_ptr<ITexture> mat2 = TextureCache::get().load(4, IoUtils::resource("/texture/stone.jpg"));
+	mat2->scaleFactor(100.f);
 	planet->setTexture(2, std::move(mat2));
 
-	std::unique_ptr<ITexture> mat3 = std::make_unique<Texture>(5, IoUtils::resource("/texture/sidewalk.jpg"));
-	mat3->mipmap()->repeat()->scaleFactor(100.f);
+	std::unique_ptr<ITexture> mat3 = TextureCache::get().load(5, IoUtils::resource("/texture/sidewalk.jpg"));
+	mat3->scaleFactor(100.f);
 	planet->setTexture(3, std::move(mat3));
 
 	planet->initPhysics(btTransform::getIdentity());
@@ -145,11 +153,11 @@ void buildNewScene(IGameScene* app, std::shared_ptr<IWindow> window) {
 
 	// Roads
 	{
-		auto roadMat0 = std::make_unique<Texture>(2, IoUtils::resource("/texture/asphalt.jpg"));
-		roadMat0->mipmap()->repeat()->scaleFactor(1500.f);
+		auto roadMat0 = TextureCache::get().load(2, IoUtils::resource("/texture/asphalt.jpg"));
+		roadMat0->scaleFactor(1500.f);
 
-		auto blockMat0 = std::make_unique<Texture>(2, IoUtils::resource("/texture/sidewalk.jpg"));
-		blockMat0->mipmap()->repeat()->scaleFactor(100.f);
+		auto blockMat0 = TextureCache::get().load(2, IoUtils::resource("/texture/sidewalk.jpg"));
+		blockMat0->scaleFactor(100.f);
 
 		std::shared_ptr<Road> road = std::make_shared<Road>(app->getDynamicsWorld(), planet, std::move(roadMat0), std::move(blockMat0));
 		road->initPhysics(btTransform::getIdentity());
@@ -265,23 +273,53 @@ void addExtraFeatures(std::shared_ptr<IGameScene> app, std::shared_ptr<IWindow>
 
 #define IS_FULLSCREEN false
 #define LOAD_FROM_FILE false
+#define SIMULATION_RATE 60
+#define TARGET_FRAME_RATE 120 // 0 = uncapped
+#define PIPELINED_SIMULATION true // false runs simulation and rendering serially (debugging)
 
 
 int main(int argc, char** argv)
 {
+	// --headless <frames>: offscreen performance run, see HeadlessWindow
+	// --replay <file>: plays back a session recorded with the "record" command
+	unsigned int headlessFrames = 0;
+	std::string replayFile;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string(argv[i]) == "--headless") {
+			const int frames = ::atoi(argv[i + 1]);
+			if (frames <= 0) {
+				Log::error("Invalid frame count for --headless: %s", argv[i + 1]);
+				return -1;
+			}
+			headlessFrames = static_cast<unsigned int>(frames);
+		} else if (std::string(argv[i]) == "--replay")
+			replayFile = argv[i + 1];
+	}
+
 	std::shared_ptr<IWindow> window;
 	try {
-		window = std::make_shared<Window>(WINDOW_TITLE, 1200, 800, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-		if (IS_FULLSCREEN) {
-			window->setFullScreen();
+		if (headlessFrames > 0) {
+#ifdef GAMEDEV3D_HEADLESS
+			window = std::make_shared<HeadlessWindow>(1200, 800, headlessFrames);
+#else
+			throw std::runtime_error("Built without headless support (cmake -DHEADLESS=ON)");
+#endif
+		} else {
+			window = std::make_shared<Window>(WINDOW_TITLE, 1200, 800, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+			if (IS_FULLSCREEN) {
+				window->setFullScreen();
+			}
+			window->setTargetFrameRate(TARGET_FRAME_RATE);
+			SDL_ShowCursor(SDL_DISABLE);
 		}
 	} catch (const std::runtime_error& e) {
 		Log::error(e.what());
 		return -1;
 	}
-	SDL_ShowCursor(SDL_DISABLE);
 
 	std::shared_ptr<IGameScene> app = std::make_shared<Application>();
+	app->setSimulationRate(SIMULATION_RATE);
+	app->setPipelined(PIPELINED_SIMULATION);
 	window->setGameScene(app);
 
 	std::shared_ptr<ISerializer> serializer = std::make_shared<Serializer>("/Users/hugo/planet0.bin");
@@ -294,6 +332,15 @@ int main(int argc, char** argv)
 	}
 	addExtraFeatures(app, window);
 
+	if (!replayFile.empty()) {
+		try {
+			app->startReplay(replayFile);
+		} catch (const std::runtime_error& e) {
+			Log::error(e.what());
+			return -1;
+		}
+	}
+
 	window->loop();
 
 	Log::debug("The End");
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#if defined(__APPLE__)
+#include <SDL2_image/SDL_image.h>
+#else
+#include <SDL2/SDL_image.h>
+#endif
+
+#include "../include/util/CompressedImage.h"
+
+/**
+ * Converts images to the block compressed textures read by the TextureLoader, each written
+ * next to its image (res/texture/grass.jpg -> res/texture/grass.ktx) with its mip chain.
+ *
+ * The format is BC3 for the images with transparent texels, BC1 otherwise. --bc5 keeps the
+ * red and green channels only, for normal maps whose shader rebuilds the third component.
+ *
+ * gamedev3d_texconv [--bc1 | --bc3 | --bc5] [--no-mipmaps] <image>...
+ */
+
+static const int AUTO = -1;
+
+
+/** the texels of the file as RGBA bytes, rows packed */
+static std::vector<uint8_t> readImage(const std::string& fileName, unsigned int& width, unsigned int& height, bool& hasAlpha) {
+	SDL_Surface* image = IMG_Load(fileName.c_str());
+	if (!image)
+		throw std::runtime_error("Can't read " + fileName + ": " + IMG_GetError());
+	SDL_Surface* surface = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(image);
+	if (!surface)
+		throw std::runtime_error("Can't convert " + fileName + ": " + SDL_GetError());
+
+	width = static_cast<unsigned int>(surface->w);
+	height = static_cast<unsigned int>(surface->h);
+	const size_t rowSize = width * 4;
+	std::vector<uint8_t> rgba(rowSize * height);
+	const uint8_t* src = static_cast<const uint8_t*>(surface->pixels);
+	for (unsigned int y = 0; y < height; y++)
+		std::memcpy(rgba.data() + y * rowSize, src + y * surface->pitch, rowSize);
+	SDL_FreeSurface(surface);
+
+	hasAlpha = false;
+	for (size_t i = 3; i < rgba.size() && !hasAlpha; i += 4)
+		hasAlpha = rgba[i] != 255;
+	return rgba;
+}
+
+
+static void convert(const std::string& fileName, int format, bool mipmaps) {
+	unsigned int width, height;
+	bool hasAlpha;
+	const std::vector<uint8_t>& rgba = readImage(fileName, width, height, hasAlpha);
+	if (format == AUTO)
+		format = hasAlpha? CompressedImage::BC3 : CompressedImage::BC1;
+
+	const CompressedImage& image = CompressedImage::encode(static_cast<CompressedImage::Format>(format), rgba.data(), width, height, mipmaps);
+	const std::string& outputName = CompressedImage::getFileName(fileName);
+	image.write(outputName);
+
+	const size_t size = image.getMemorySize(image.getLevelCount());
+	printf("%s: %ux%u %s, %zu levels, %zu KB (%zu KB as RGBA)\n", outputName.c_str(), width, height,
+		   CompressedImage::getFormatName(image.getInternalFormat()), image.getLevelCount(), size / 1024,
+		   (mipmaps? rgba.size() + rgba.size() / 3 : rgba.size()) / 1024);
+}
+
+
+static int usage(const char* program) {
+	fprintf(stderr, "Usage: %s [--bc1 | --bc3 | --bc5] [--no-mipmaps] <image>...\n", program);
+	return -1;
+}
+
+
+int main(int argc, char** argv)
+{
+	int format = AUTO;
+	bool mipmaps = true;
+	std::vector<std::string> fileNames;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		if (arg == "--bc1")
+			format = CompressedImage::BC1;
+		else if (arg == "--bc3")
+			format = CompressedImage::BC3;
+		else if (arg == "--bc5")
+			format = CompressedImage::BC5;
+		else if (arg == "--no-mipmaps")
+			mipmaps = false;
+		else if (arg.compare(0, 2, "--") != 0 && !CompressedImage::isFileName(arg))
+			fileNames.push_back(arg);
+		else
+			return usage(argv[0]);
+	}
+	if (fileNames.empty())
+		return usage(argv[0]);
+
+	int result = 0;
+	for (const std::string& fileName : fileNames) {
+		try {
+			convert(fileName, format, mipmaps);
+		} catch (const std::runtime_error& e) {
+			fprintf(stderr, "%s\n", e.what());
+			result = -1;
+		}
+	}
+	return result;
+}